@@ -6,6 +6,10 @@ DebugeeCreate()
     debugee Result = { };
 
     Result.Arena = ArenaCreate(Kilobytes(4));
+    Result.MemoryFD = -1;
+    Result.Threads = (debugee_thread *)calloc(MAX_DEBUGEE_THREADS, sizeof(debugee_thread));
+    Result.Image = (image_mapping *)calloc(MAX_IMAGE_MAPPINGS, sizeof(image_mapping));
+    Result.ImageRejected = (image_rejected *)calloc(MAX_IMAGE_MAPPINGS, sizeof(image_rejected));
 
     // Query info about scalar register on the running processor
     // @Redundant: What if we do not have this?, can we just leave this as is?
@@ -68,27 +72,242 @@ DebugeeStart(debugee *Debugee)
     }
     else
     {
-        Debugee->PID = ProcessID;
+        __atomic_store_n(&Debugee->PID, ProcessID, __ATOMIC_RELEASE);
+        Debugee->TID = ProcessID;
+        Debugee->ThreadCount = 0;
+        DebugeeThreadAdd(Debugee, ProcessID);
         Debugee->Flags.Running = true;
         DebugeeWaitForSignal(Debugee);
         assert(chdir(BaseDir) == 0);
+
+        // Every thread the debugee creates is traced from its first instruction
+        ptrace(PTRACE_SETOPTIONS, ProcessID, 0x0, PTRACE_O_TRACECLONE);
+
+        // NOTE(mateusz): Has to be opened after the exec stop, before that
+        // the file refers to the address space of the forked debager.
+        char MemPath[64] = {};
+        sprintf(MemPath, "/proc/%d/mem", ProcessID);
+        Debugee->MemoryFD = open(MemPath, O_RDWR);
+        assert(Debugee->MemoryFD != -1);
+        Debugee->Flags.ImageStale = true;
     }
 }
 
 static void
 DebugeeKill(debugee *Debugee)
 {
-    ptrace(PTRACE_KILL, Debugee->PID, 0x0, 0x0);
+    kill(Debugee->PID, SIGKILL);
+
+    // NOTE(mateusz): Reap every thread, otherwise their exit notifications would
+    // show up in the waitpid of the next session.
+    for(;;)
+    {
+        i32 WaitStatus = 0;
+        i32 TID = waitpid(-1, &WaitStatus, __WALL);
+        if(TID == -1 || (TID == Debugee->PID && (WIFEXITED(WaitStatus) || WIFSIGNALED(WaitStatus))))
+        {
+            break;
+        }
+    }
+
+    Debugee->ThreadCount = 0;
     Debugee->Flags.Running = !Debugee->Flags.Running;
 }
 
+static void
+DebugeeAttach(debugee *Debugee, i32 PID)
+{
+    char ExeLink[64] = {};
+    sprintf(ExeLink, "/proc/%d/exe", PID);
+    ssize_t Length = readlink(ExeLink, Debugee->ProgramPath, sizeof(Debugee->ProgramPath) - 1);
+    
+    // A process stopped by job control before we came stays stopped after we leave
+    Debugee->Flags.JobStopped = DebugeeProcessState(PID) == 'T';
+    
+    Debugee->ThreadCount = 0;
+    if(Length == -1 || !DebugeeSeizeThreads(Debugee, PID))
+    {
+        Tracer.StopReason = STOP_REASON_ATTACH_FAILED;
+        return;
+    }
+    Debugee->ProgramPath[Length] = '\0';
+
+    __atomic_store_n(&Debugee->PID, PID, __ATOMIC_RELEASE);
+    Debugee->TID = PID;
+    Debugee->Flags.Running = true;
+    Debugee->Flags.Attached = true;
+
+    // NOTE(mateusz): A seized process keeps on running, so the symbols are read
+    // before it gets stopped and the process is only paused for the time it takes
+    // to stop its threads.
+    Debugee->LoadAddress = DebugeeGetLoadAddress(Debugee);
+    LOG_MAIN("LoadAddress = %lx\n", Debugee->LoadAddress);
+    Debugee->Flags.PIE = DwarfIsExectuablePIE();
+    
+    DwarfModulesInit();
+
+    char MemPath[64] = {};
+    sprintf(MemPath, "/proc/%d/mem", PID);
+    Debugee->MemoryFD = open(MemPath, O_RDWR);
+    if(Debugee->MemoryFD == -1)
+    {
+        DebugeeReleaseThreads(Debugee);
+        __atomic_store_n(&Debugee->PID, 0, __ATOMIC_RELEASE);
+        Debugee->Flags.Running = false;
+        Debugee->Flags.Attached = false;
+        Tracer.StopReason = STOP_REASON_ATTACH_FAILED;
+        return;
+    }
+    Debugee->Flags.ImageStale = true;
+
+    DebugeeStopAllThreads(Debugee);
+    
+    Debugee->Regs = DebugeePeekRegisters(Debugee);
+    Debuger.UnwindRemoteArg = _UPT_create(Debugee->TID);
+    Debugee->Flags.Steped = true;
+    Tracer.StopReason = STOP_REASON_ATTACHED;
+}
+
+// NOTE(mateusz): Threads can be created while we are going through the task
+// list, it is walked until a pass does not find anything new. Threads cloned by
+// an already seized thread are attached by the kernel, those are seen here as
+// EPERM and are stopped for us.
+static bool
+DebugeeSeizeThreads(debugee *Debugee, i32 PID)
+{
+    if(ptrace(PTRACE_SEIZE, PID, 0x0, PTRACE_O_TRACECLONE) == -1)
+    {
+        return false;
+    }
+    DebugeeThreadAdd(Debugee, PID);
+
+    char TaskPath[64] = {};
+    sprintf(TaskPath, "/proc/%d/task", PID);
+
+    bool FoundNew = true;
+    while(FoundNew)
+    {
+        FoundNew = false;
+
+        // The process is gone, the threads seized so far are let go of
+        DIR *TaskDir = opendir(TaskPath);
+        if(!TaskDir)
+        {
+            DebugeeReleaseThreads(Debugee);
+            return false;
+        }
+
+        struct dirent *Entry = 0x0;
+        while((Entry = readdir(TaskDir)))
+        {
+            i32 TID = atoi(Entry->d_name);
+            if(TID <= 0 || DebugeeThreadFind(Debugee, TID))
+            {
+                continue;
+            }
+
+            if(ptrace(PTRACE_SEIZE, TID, 0x0, PTRACE_O_TRACECLONE) == 0)
+            {
+                DebugeeThreadAdd(Debugee, TID);
+                FoundNew = true;
+            }
+            else if(errno == EPERM)
+            {
+                DebugeeThreadAdd(Debugee, TID)->Flags.Starting = true;
+            }
+        }
+
+        closedir(TaskDir);
+    }
+
+    return true;
+}
+
+static void
+DebugeeReleaseThreads(debugee *Debugee)
+{
+    for(u32 I = 0; I < Debugee->ThreadCount; I++)
+    {
+        debugee_thread *Thread = &Debugee->Threads[I];
+        ptrace(PTRACE_DETACH, Thread->TID, 0x0, (void *)(size_t)Thread->PendingSignal);
+    }
+    
+    Debugee->ThreadCount = 0;
+}
+
+// NOTE(mateusz): The state letter in /proc/pid/stat comes after the command name,
+// which is in parentheses and can have spaces and parentheses of its own.
+static char
+DebugeeProcessState(i32 PID)
+{
+    char Path[64] = {};
+    sprintf(Path, "/proc/%d/stat", PID);
+    
+    char Stat[512] = {};
+    FILE *FileHandle = fopen(Path, "r");
+    if(!FileHandle)
+    {
+        return 0;
+    }
+    
+    size_t Read = fread(Stat, 1, sizeof(Stat) - 1, FileHandle);
+    fclose(FileHandle);
+    Stat[Read] = '\0';
+    
+    char *NameEnd = strrchr(Stat, ')');
+    return NameEnd && NameEnd[1] == ' ' ? NameEnd[2] : 0;
+}
+
+static void
+DebugeeDetach(debugee *Debugee)
+{
+    if(!Debugee->Flags.Running || !Debugee->Flags.Attached)
+    {
+        return;
+    }
+
+    // ptrace only lets go of stopped threads
+    DebugeeStopAllThreads(Debugee);
+
+    for(u32 I = 0; I < BreakpointCount; I++)
+    {
+        if(BreakpointEnabled(&Breakpoints[I]))
+        {
+            BreakpointDisable(&Breakpoints[I]);
+        }
+    }
+    for(u32 I = 0; I < TempBreakpointsCount; I++)
+    {
+        if(BreakpointEnabled(&TempBreakpoints[I]))
+        {
+            BreakpointDisable(&TempBreakpoints[I]);
+        }
+    }
+    TempBreakpointsCount = 0;
+
+    DebugeeReleaseThreads(Debugee);
+
+    // NOTE(mateusz): A SIGSTOP of an interrupt that came late is still queued,
+    // without the tracer it would freeze the whole process. One that was stopped
+    // before we attached is left stopped.
+    if(!Debugee->Flags.JobStopped)
+    {
+        kill(Debugee->PID, SIGCONT);
+    }
+
+    __atomic_store_n(&Debugee->PID, 0, __ATOMIC_RELEASE);
+    Debugee->ThreadCount = 0;
+    Debugee->Flags.Running = false;
+    Debugee->Flags.Attached = false;
+    Tracer.StopReason = STOP_REASON_DETACHED;
+    DebugerDeallocTransient(&Debuger);
+}
+
 static void
 DebugeeContinueOrStart(debugee *Debugee)
 {
     if(IsFile(Debugee->ProgramPath))
     {
-        GuiClearStatusText();
-        
         //Continue or start program
         if(!Debugee->Flags.Running)
         {
@@ -98,29 +317,24 @@ DebugeeContinueOrStart(debugee *Debugee)
             LOG_MAIN("LoadAddress = %lx\n", Debugee->LoadAddress);
             Debugee->Flags.PIE = DwarfIsExectuablePIE();
             
-            DwarfRead();
+            DwarfModulesInit();
             
-            Debuger.UnwindRemoteArg = _UPT_create(Debugee->PID);
+            Debuger.UnwindRemoteArg = _UPT_create(Debugee->TID);
 
             BreakAtMain();
         }
     
         DebugeeContinueProgram(Debugee);
-        DebugerUpdateTransient(&Debuger);
     }
     else
     {
         if(StringEmpty(Debugee->ProgramPath))
         {
-            GuiSetStatusText("No program path given");
+            Tracer.StopReason = STOP_REASON_NO_PROGRAM_PATH;
         }
         else
         {
-            char Buff[2*PATH_MAX] = {};
-
-            sprintf(Buff, "File at [%s] does not exist", Debugee->ProgramPath);
-
-            GuiSetStatusText(Buff);
+            Tracer.StopReason = STOP_REASON_NO_PROGRAM_FILE;
         }
     }
 }
@@ -128,7 +342,9 @@ DebugeeContinueOrStart(debugee *Debugee)
 static void
 DebugeeRestart(debugee *Debugee)
 {
-    if(Debugee->Flags.Running)
+    // NOTE(mateusz): An attached process was not started by us, there is
+    // nothing we could restart it with.
+    if(Debugee->Flags.Running && !Debugee->Flags.Attached)
     {
         DebugeeKill(Debugee);
         DebugerDeallocTransient(&Debuger);
@@ -140,23 +356,145 @@ DebugeeRestart(debugee *Debugee)
 static void
 DebugeeWaitForSignal(debugee *Debugee)
 {
-    i32 WaitStatus;
-    i32 Options = 0;
-    i32 PID = Debugee->PID;
-    waitpid(PID, &WaitStatus, Options);
+    i32 WaitStatus = 0;
+    i32 TID = 0;
+
+    // NOTE(mateusz): Every thread of the debugee reports here, the events that
+    // are only bookkeeping are handled in place and we keep on waiting.
+    for(;;)
+    {
+        TID = waitpid(-1, &WaitStatus, __WALL);
+        if(TID == -1)
+        {
+            break;
+        }
+
+        if(WIFEXITED(WaitStatus) || WIFSIGNALED(WaitStatus))
+        {
+            if(TID == Debugee->PID)
+            {
+                break;
+            }
+
+            debugee_thread *Exited = DebugeeThreadFind(Debugee, TID);
+            if(Exited)
+            {
+                Exited->Flags.Exited = true;
+                DebugeeThreadsCompact(Debugee);
+            }
+
+            if(TID == Debugee->TID)
+            {
+                Debugee->TID = Debugee->PID;
+            }
+
+            continue;
+        }
+
+        debugee_thread *Thread = DebugeeThreadFind(Debugee, TID);
+        if(!Thread)
+        {
+            // The new thread reported before the clone event of its parent
+            Thread = DebugeeThreadAdd(Debugee, TID);
+            Thread->Flags.Starting = true;
+        }
+
+        Thread->Flags.Stopped = true;
+        Thread->Flags.RegsValid = false;
+
+        i32 StopSignal = WSTOPSIG(WaitStatus);
+        // Threads of a seized process report their first stop as an event stop
+        bool EventStop = (WaitStatus >> 16) == PTRACE_EVENT_STOP;
+        if((WaitStatus >> 16) == PTRACE_EVENT_CLONE)
+        {
+            unsigned long NewTID = 0;
+            ptrace(PTRACE_GETEVENTMSG, TID, 0x0, &NewTID);
+            if(!DebugeeThreadFind(Debugee, NewTID))
+            {
+                DebugeeThreadAdd(Debugee, NewTID)->Flags.Starting = true;
+            }
+
+            DebugeeThreadResume(Thread, Thread->LastRequest);
+            continue;
+        }
+
+        if((StopSignal == SIGSTOP || EventStop) && Thread->Flags.Starting)
+        {
+            Thread->Flags.Starting = false;
+            DebugeeThreadResume(Thread, PTRACE_CONT);
+            continue;
+        }
+
+        // NOTE(mateusz): Leftovers from DebugeeStopAllThreads or from an interrupt that
+        // came late. Any other SIGSTOP (kill -STOP, raise) stops the program like other
+        // signals do.
+        bool OwnStop = StopSignal == SIGSTOP && Thread->Flags.SigStopPending;
+        bool LateInterrupt = StopSignal == SIGSTOP && !OwnStop && !TracerInterrupted() &&
+                             TracerConsumeInterruptStop();
+        if(EventStop || OwnStop || LateInterrupt)
+        {
+            Thread->Flags.SigStopPending = false;
+            DebugeeThreadResume(Thread, Thread->LastRequest);
+            continue;
+        }
+
+        if(TID != Debugee->TID)
+        {
+            bool PassSignal = StopSignal != SIGTRAP && StopSignal != SIGSTOP &&
+                              StopSignal != SIGSEGV && StopSignal != SIGABRT;
+            if(PassSignal)
+            {
+                Thread->PendingSignal = StopSignal;
+                DebugeeThreadResume(Thread, PTRACE_CONT);
+                continue;
+            }
+
+            // NOTE(mateusz): The temporary breakpoints belong to the command of the
+            // current thread, other threads that hit them wait there until it is done.
+            bool AtTempBreakpoint = false;
+            if(StopSignal == SIGTRAP)
+            {
+                size_t TrapAddress = DebugeeThreadGetRegisters(Thread).RIP - 1;
+                AtTempBreakpoint = BreakpointFind(TrapAddress, TempBreakpoints, TempBreakpointsCount) &&
+                                   !BreakpointFind(TrapAddress, Breakpoints, BreakpointCount);
+            }
+
+            if((Debuger.NonStop || AtTempBreakpoint) && StopSignal == SIGTRAP)
+            {
+                // NOTE(mateusz): The thread waits at the breakpoint until the user
+                // picks it from the thread list, the current one keeps going.
+                DebugeeThreadRewindBreakpoint(Thread);
+                continue;
+            }
+
+            DebugeeThreadSwitch(Debugee, TID);
+        }
+
+        break;
+    }
     
-    if(WIFEXITED(WaitStatus))
+    if(TID == -1 || (TID == Debugee->PID && (WIFEXITED(WaitStatus) || WIFSIGNALED(WaitStatus))))
     {
-        GuiSetStatusText("Program finished it's execution");
+        Tracer.StopReason = STOP_REASON_EXITED;
+        Debugee->ThreadCount = 0;
         Debugee->Flags.Running = !Debugee->Flags.Running;
         DebugerDeallocTransient(&Debuger);
+        return;
+    }
+
+    if(!Debuger.NonStop)
+    {
+        DebugeeStopAllThreads(Debugee);
     }
     
     siginfo_t SigInfo;
-    ptrace(PTRACE_GETSIGINFO, PID, nullptr, &SigInfo);
+    ptrace(PTRACE_GETSIGINFO, TID, nullptr, &SigInfo);
+    Tracer.StopSignal = SigInfo.si_signo;
     
     if(SigInfo.si_signo == SIGTRAP)
     {
+        Tracer.StopReason = STOP_REASON_TRAP;
+
         switch (SigInfo.si_code)
         {
             case SI_KERNEL:
@@ -177,18 +515,25 @@ DebugeeWaitForSignal(debugee *Debugee)
     }
     else if(SigInfo.si_signo == SIGSEGV)
     {
-        GuiSetStatusText("Program seg faulted");
+        Tracer.StopReason = STOP_REASON_SEGFAULT;
         DebugeeKill(Debugee);
         DebugerDeallocTransient(&Debuger);
     }
     else if(SigInfo.si_signo == SIGABRT)
     {
         DebugeeKill(Debugee);
-        GuiSetStatusText("Program aborted");
+        Tracer.StopReason = STOP_REASON_ABORTED;
         DebugerDeallocTransient(&Debuger);
     }
+    else if(SigInfo.si_signo == SIGSTOP && TracerInterrupted())
+    {
+        TracerConsumeInterruptStop();
+        Tracer.StopReason = STOP_REASON_INTERRUPTED;
+    }
     else
     {
+        Tracer.StopReason = STOP_REASON_SIGNAL;
+
         // TODO(radomski): Logging, sane data route
         // LOG_FLOW("Unhandled signal = [%s]", strsignal(SigInfo.si_signo));
     }
@@ -197,25 +542,56 @@ DebugeeWaitForSignal(debugee *Debugee)
 static void
 DebugeeToNextLine(debugee *Debugee, bool StepIntoFunctions)
 {
-    address_range Range = DwarfGetAddressRangeUntilNextLine(DebugeeGetProgramCounter(Debugee));
-    // TODO(radomski): Logging, sane data route
-    // LOG_FLOW("Regs.RIP = %lX, Range.Start = %lX, Range.End = %lX\n", DebugeeGetProgramCounter(), Range.Start, Range.End);
+    size_t StartPC = DebugeeGetProgramCounter(Debugee);
+    di_function *StartFunc = DwarfFindFunctionByAddress(StartPC);
+    u32 StartDepth = DwarfGetInlinedDepth(StartPC);
 
-    BreakAtCurcialInstrsInRange(Range, StepIntoFunctions, TempBreakpoints, &TempBreakpointsCount);
-    
-    DebugeeContinueProgram(Debugee);
-    
-    // TODO(radomski): Logging, sane data route
-    // LOG_FLOW("TempBreakpointsCount = %d\n", TempBreakpointsCount);
-    for(u32 I = 0; I < TempBreakpointsCount; I++)
+    // NOTE(mateusz): Calls inlined into the function are virtual frames, stepping over a line
+    // keeps going while the debugee is inside of a call inlined deeper than where it started.
+    for(u32 Step = 0; Step < MAX_INLINED_STEPS; Step++)
     {
+        // NOTE(mateusz): Code without lines (libc after an interrupt) is left through
+        // its return address, stepping into it only goes one instruction.
+        size_t PC = DebugeeGetProgramCounter(Debugee);
+        if(!DwarfFindLineByAddress(PC))
+        {
+            size_t SymbolOffset = 0;
+            if(StepIntoFunctions || StartFunc || !DwarfFindElfSymbolByAddress(PC, &SymbolOffset))
+            {
+                DebugeeStepInstruction(Debugee);
+            }
+            else
+            {
+                DebugeeStepOutOfFunction(Debugee);
+            }
+            break;
+        }
+        
+        address_range Range = DwarfGetAddressRangeUntilNextLine(PC);
         // TODO(radomski): Logging, sane data route
-        // LOG_FLOW("Breakpoint[%d] at %lX\n", I, TempBreakpoints[I].Address);
-        BreakpointDisable(&TempBreakpoints[I]);
-    }
+        // LOG_FLOW("Regs.RIP = %lX, Range.Start = %lX, Range.End = %lX\n", DebugeeGetProgramCounter(), Range.Start, Range.End);
 
-    memset(TempBreakpoints, 0, sizeof(TempBreakpoints[0]) * TempBreakpointsCount);
-    TempBreakpointsCount = 0;
+        BreakAtCurcialInstrsInRange(Range, StepIntoFunctions, TempBreakpoints, &TempBreakpointsCount);
+        
+        DebugeeContinueProgram(Debugee);
+        
+        BreakpointClearTemp();
+
+        if(StepIntoFunctions || !StartFunc || !Debugee->Flags.Running || TracerInterrupted())
+        {
+            break;
+        }
+
+        Debugee->Regs = DebugeePeekRegisters(Debugee);
+        PC = DebugeeGetProgramCounter(Debugee);
+        bool KeepStepping = !BreakpointEnabled(BreakpointFind(PC)) &&
+                            DwarfAddressConfinedByFunction(StartFunc, PC) &&
+                            DwarfGetInlinedDepth(PC) > StartDepth;
+        if(!KeepStepping)
+        {
+            break;
+        }
+    }
     
     Debugee->Flags.Steped = true;
 }
@@ -223,12 +599,11 @@ DebugeeToNextLine(debugee *Debugee, bool StepIntoFunctions)
 static void
 DebugeeStepInstruction(debugee *Debugee)
 {
-    i32 PID = Debugee->PID;
     breakpoint *BP = BreakpointFind(DebugeeGetProgramCounter(Debugee));
     bool EnabledAtEntry = BreakpointEnabled(BP);
     if(BP && EnabledAtEntry && !BP->State.ExectuedSavedOpCode) { BreakpointDisable(BP); }
     
-    ptrace(PTRACE_SINGLESTEP, PID, 0x0, 0x0);
+    DebugeeThreadResume(DebugeeCurrentThread(Debugee), PTRACE_SINGLESTEP);
     DebugeeWaitForSignal(Debugee);
     
     if(BP && EnabledAtEntry && !BP->State.ExectuedSavedOpCode) { BreakpointEnable(BP); }
@@ -294,30 +669,27 @@ DebugeeToNextInstruction(debugee *Debugee, bool StepIntoFunctions)
             else
             {
                 size_t NextInstrAddress = PC + Instruction->size;
-
-                breakpoint BP = BreakpointCreate(NextInstrAddress);
-                BreakpointEnable(&BP);
+                BreakpointPushTemp(NextInstrAddress);
 
                 DebugeeContinueProgram(Debugee);
 
-                BreakpointDisable(&BP);
+                BreakpointClearTemp();
             }
         }
         else
         {
             size_t NextInstrAddress = PC + Instruction->size;
-        
-            breakpoint BP = BreakpointCreate(NextInstrAddress);
-            BreakpointEnable(&BP);
+            BreakpointPushTemp(NextInstrAddress);
 
             DebugeeContinueProgram(Debugee);
 
-            BreakpointDisable(&BP);
+            BreakpointClearTemp();
         }
     }
     else if(Type & INST_TYPE_RET)
     {
-        size_t ReturnAddress = DebugeeGetReturnAddress(Debugee, PC);
+        size_t ReturnAddress = 0x0;
+        DebugeeGetReturnAddress(Debugee, PC, &ReturnAddress);
 
         bool AddressInAnyCompileUnit = DwarfFindCompileUnitByAddress(ReturnAddress) != 0x0;
         if(AddressInAnyCompileUnit)
@@ -339,6 +711,9 @@ DebugeeToNextInstruction(debugee *Debugee, bool StepIntoFunctions)
     Debugee->Flags.Steped = true;
 }
 
+// NOTE(mateusz): In the all stop mode the other threads run too, also while stepping
+// over a line or out of a function, otherwise a step over pthread_join or a contended
+// mutex would never finish. They are stopped again once the debugee stops.
 static void
 DebugeeContinueProgram(debugee *Debugee)
 {
@@ -362,10 +737,18 @@ DebugeeContinueProgram(debugee *Debugee)
     {
         return;
     }
+    else if(TracerInterrupted())
+    {
+        return;
+    }
     else
     {
-        i32 PID = Debugee->PID;
-        ptrace(PTRACE_CONT, PID, 0x0, 0x0);
+        if(!Debuger.NonStop)
+        {
+            DebugeeResumeOtherThreads(Debugee);
+        }
+
+        DebugeeThreadResume(DebugeeCurrentThread(Debugee), PTRACE_CONT);
         DebugeeWaitForSignal(Debugee);
     }
     
@@ -398,296 +781,1818 @@ static void
 DebugeeStepOutOfFunction(debugee *Debugee)
 {
     di_function *Func = DwarfFindFunctionByAddress(DebugeeGetProgramCounter(Debugee));
+    if(!Func)
+    {
+        // NOTE(mateusz): Code without DWARF is left through its return address as
+        // long as the ELF symbols say which function the debugee is in.
+        size_t SymbolOffset = 0;
+        size_t PC = DebugeeGetProgramCounter(Debugee);
+        size_t ReturnAddress = 0x0;
+        if(DwarfFindElfSymbolByAddress(PC, &SymbolOffset) && !DebugeeGetReturnAddress(Debugee, PC, &ReturnAddress))
+        {
+            Tracer.StopReason = STOP_REASON_NO_FRAME_INFO;
+        }
+        else if(ReturnAddress)
+        {
+            BreakpointPushTemp(ReturnAddress);
+            DebugeeContinueProgram(Debugee);
+            BreakpointClearTemp();
+        }
+        
+        Debugee->Flags.Steped = true;
+        return;
+    }
+
+    di_inlined_call *Inlined[MAX_INLINED_DEPTH] = {};
+    u32 InlinedCount = DwarfFindInlinedCallsByAddress(Func, DebugeeGetProgramCounter(Debugee), Inlined, ARRAY_LENGTH(Inlined));
+    if(InlinedCount)
+    {
+        // NOTE(mateusz): An inlined call has no return address to break at, the
+        // lines are stepped over until the debugee leaves the innermost call.
+        di_inlined_call *Call = Inlined[0];
+        for(u32 Step = 0; Step < MAX_INLINED_STEPS; Step++)
+        {
+            DebugeeToNextLine(Debugee, false);
+            if(!Debugee->Flags.Running || TracerInterrupted())
+            {
+                break;
+            }
+            
+            DebugerUpdateTransient(&Debuger);
+            
+            size_t PC = DebugeeGetProgramCounter(Debugee);
+            if(BreakpointEnabled(BreakpointFind(PC)) || !DwarfAddressConfinedByLexicalScope(&Call->LexScope, PC))
+            {
+                break;
+            }
+        }
+        
+        Debugee->Flags.Steped = true;
+        return;
+    }
 
     DebugeeToNextLine(Debugee, false);
     DebugerUpdateTransient(&Debuger);
 
     size_t PC = DebugeeGetProgramCounter(Debugee);
-    if(DwarfAddressConfinedByFunction(Func, PC))
+    if(!TracerInterrupted() && DwarfAddressConfinedByFunction(Func, PC))
     {
-        size_t PC = DebugeeGetProgramCounter(Debugee);
-        size_t ReturnAddress = DebugeeGetReturnAddress(Debugee, PC);
-        bool OwnBreakpoint = false;
-        breakpoint BP = {};
-
-        if(!BreakpointFind(ReturnAddress))
+        size_t ReturnAddress = 0x0;
+        if(!DebugeeGetReturnAddress(Debugee, PC, &ReturnAddress))
         {
-            BP = BreakpointCreate(ReturnAddress);
-            BreakpointEnable(&BP);
-            OwnBreakpoint = true;
+            Tracer.StopReason = STOP_REASON_NO_FRAME_INFO;
+            Debugee->Flags.Steped = true;
+            return;
         }
-    
+        
+        BreakpointPushTemp(ReturnAddress);
         DebugeeContinueProgram(Debugee);
-        if(OwnBreakpoint)
-        {
-            BreakpointDisable(&BP);
-        }
+        BreakpointClearTemp();
     }
     
     Debugee->Flags.Steped = true;
 }
 
-static x64_registers
-DebugeePeekRegisters(debugee *Debugee)
+// NOTE(mateusz): One temporary breakpoint and one continue, other breakpoints hit
+// before the address stop the debugee there like a continue would. A disabled user
+// breakpoint at the address is enabled for the run. The temporary one is in the
+// TempBreakpoints so that other threads hitting it in non stop mode are rewound.
+static void
+DebugeeRunToAddress(debugee *Debugee, size_t Address)
 {
-    x64_registers Result = {};
+    breakpoint *BP = BreakpointFind(Address);
+    bool WasEnabled = BreakpointEnabled(BP);
+    bool OwnBreakpoint = !BP && TempBreakpointsCount < MAX_TEMP_BREAKPOINT_COUNT;
+    if(OwnBreakpoint)
+    {
+        BP = &TempBreakpoints[TempBreakpointsCount++];
+        (*BP) = BreakpointCreate(Address);
+    }
     
-    user_regs_struct USR = {};
-    ptrace(PTRACE_GETREGS, Debugee->PID, 0x0, &USR);
+    if(BP && !WasEnabled)
+    {
+        BreakpointEnable(BP);
+    }
     
-    Result = RegistersFromUSR(USR);
-    return Result;
+    DebugeeContinueProgram(Debugee);
+    
+    if(BP && !WasEnabled && BreakpointEnabled(BP))
+    {
+        BreakpointDisable(BP);
+    }
+    
+    if(OwnBreakpoint)
+    {
+        memset(TempBreakpoints, 0, sizeof(TempBreakpoints[0]) * TempBreakpointsCount);
+        TempBreakpointsCount = 0;
+    }
+    
+    Debugee->Flags.Steped = true;
 }
 
+// NOTE(mateusz): Only inside of the current function, anywhere else the stack frame
+// wouldn't be the one the code expects.
 static void
-DebugeePeekXSave(debugee *Debugee)
+DebugeeSetNextStatement(debugee *Debugee, size_t Address)
 {
-    struct iovec IO = { Debugee->XSaveBuffer, Debugee->XSaveSize };
-    ptrace(PTRACE_GETREGSET, Debugee->PID, NT_X86_XSTATE, &IO);
-
-    u64 XStateBV = *((u64 *)(&Debugee->XSaveBuffer[512]));
-
-    Debugee->RegsFlags.EnabledSSE = (XStateBV & (1 << 1)) ? 1 : 0;
-    Debugee->RegsFlags.EnabledAVX = (XStateBV & (1 << 2)) ? 1 : 0;
+    di_function *Func = DwarfFindFunctionByAddress(DebugeeGetProgramCounter(Debugee));
+    if(!Func || !DwarfAddressConfinedByFunction(Func, Address))
+    {
+        return;
+    }
+    
+    Debugee->Regs = DebugeePeekRegisters(Debugee);
+    Debugee->Regs.RIP = Address;
+    DebugeeSetRegisters(Debugee, Debugee->Regs);
+    
+    Debugee->Flags.Steped = true;
 }
 
+// NOTE(mateusz): Steps over up to Count lines. Between the steps only the registers
+// are read and the module of the program counter is selected, everything the GUI
+// shows is built once after the last step. A breakpoint, a signal or a condition
+// that isn't zero stop it early.
 static void
-DebugeeSetRegisters(debugee *Debugee, x64_registers Regs)
+DebugeeStepLines(debugee *Debugee, u32 Count, char *Condition)
 {
-    user_regs_struct USR = RegistersToUSR(Regs);
-    ptrace(PTRACE_SETREGS, Debugee->PID, 0x0, &USR);
-}
+    watch_plan Plan = {};
+    Plan.Src = Condition;
+    
+    struct timespec Start = {};
+    clock_gettime(CLOCK_MONOTONIC, &Start);
+    
+    u32 Steps = 0;
+    while(Steps < Count)
+    {
+        DebugeeToNextLine(Debugee, false);
+        Steps++;
+        
+        bool Signaled = Tracer.StopReason != STOP_REASON_NONE && Tracer.StopReason != STOP_REASON_TRAP;
+        if(!Debugee->Flags.Running || Signaled || TracerInterrupted())
+        {
+            break;
+        }
+        
+        Debugee->Regs = DebugeePeekRegisters(Debugee);
+        size_t PC = DebugeeGetProgramCounter(Debugee);
+        DwarfSelectModuleByAddress(PC);
+        if(BreakpointEnabled(BreakpointFind(PC)))
+        {
+            break;
+        }
+        
+        // Out of the scope of its variables the condition just doesn't hold
+        scratch_arena Scratch;
+        char *Error = 0x0;
+        bool Holds = false;
+        if(!StringEmpty(Condition) && WLangEvalCondition(&Plan, &Holds, &Error, Scratch) && Holds)
+        {
+            break;
+        }
+    }
+    
+    struct timespec End = {};
+    clock_gettime(CLOCK_MONOTONIC, &End);
+    f64 Seconds = (End.tv_sec - Start.tv_sec) + (End.tv_nsec - Start.tv_nsec) / 1e9;
+    
+    Tracer.Steps = Steps;
+    Tracer.StepsPerSecond = Seconds > 0.0 ? Steps / Seconds : 0.0;
+    if(Tracer.StopReason == STOP_REASON_NONE || Tracer.StopReason == STOP_REASON_TRAP)
+    {
+        Tracer.StopReason = STOP_REASON_STEPPED;
+    }
+    
+    Debugee->Flags.Steped = true;
+}
+
+static debugee_thread *
+DebugeeThreadFind(debugee *Debugee, i32 TID)
+{
+    for(u32 I = 0; I < Debugee->ThreadCount; I++)
+    {
+        if(Debugee->Threads[I].TID == TID)
+        {
+            return &Debugee->Threads[I];
+        }
+    }
+
+    return 0x0;
+}
+
+static debugee_thread *
+DebugeeThreadAdd(debugee *Debugee, i32 TID)
+{
+    assert(Debugee->ThreadCount < MAX_DEBUGEE_THREADS);
+
+    debugee_thread *Thread = &Debugee->Threads[Debugee->ThreadCount++];
+    *Thread = {};
+    Thread->TID = TID;
+    Thread->LastRequest = PTRACE_CONT;
+
+    return Thread;
+}
+
+static void
+DebugeeThreadsCompact(debugee *Debugee)
+{
+    u32 Alive = 0;
+    for(u32 I = 0; I < Debugee->ThreadCount; I++)
+    {
+        if(!Debugee->Threads[I].Flags.Exited)
+        {
+            Debugee->Threads[Alive++] = Debugee->Threads[I];
+        }
+    }
+
+    Debugee->ThreadCount = Alive;
+}
+
+static debugee_thread *
+DebugeeCurrentThread(debugee *Debugee)
+{
+    debugee_thread *Result = DebugeeThreadFind(Debugee, Debugee->TID);
+    assert(Result);
+
+    return Result;
+}
+
+static x64_registers
+DebugeeThreadGetRegisters(debugee_thread *Thread)
+{
+    if(!Thread->Flags.RegsValid)
+    {
+        user_regs_struct USR = {};
+        ptrace(PTRACE_GETREGS, Thread->TID, 0x0, &USR);
+
+        Thread->Regs = RegistersFromUSR(USR);
+        Thread->Flags.RegsValid = true;
+    }
+
+    return Thread->Regs;
+}
+
+static void
+DebugeeThreadResume(debugee_thread *Thread, i32 Request)
+{
+    ptrace((__ptrace_request)Request, Thread->TID, 0x0, (void *)(size_t)Thread->PendingSignal);
+
+    Thread->PendingSignal = 0;
+    Thread->LastRequest = Request;
+    Thread->Flags.Stopped = false;
+    Thread->Flags.RegsValid = false;
+}
+
+// NOTE(mateusz): A thread that stopped on an int3 has its RIP one past it, put
+// it back so that the breakpoint is hit (or stepped over) once it is resumed.
+static void
+DebugeeThreadRewindBreakpoint(debugee_thread *Thread)
+{
+    x64_registers Regs = DebugeeThreadGetRegisters(Thread);
+
+    breakpoint *BP = BreakpointFind(Regs.RIP - 1);
+    if(BreakpointEnabled(BP))
+    {
+        Regs.RIP -= 1;
+
+        user_regs_struct USR = RegistersToUSR(Regs);
+        ptrace(PTRACE_SETREGS, Thread->TID, 0x0, &USR);
+        Thread->Regs = Regs;
+    }
+}
+
+static void
+DebugeeThreadSwitch(debugee *Debugee, i32 TID)
+{
+    debugee_thread *Thread = DebugeeThreadFind(Debugee, TID);
+    if(!Thread || !Thread->Flags.Stopped)
+    {
+        return;
+    }
+
+    Debugee->TID = TID;
+    Debugee->Regs = DebugeeThreadGetRegisters(Thread);
+
+    // NOTE(mateusz): The ptrace accessors of libunwind are bound to a single thread
+    if(Debuger.UnwindRemoteArg)
+    {
+        _UPT_destroy(Debuger.UnwindRemoteArg);
+        Debuger.UnwindRemoteArg = _UPT_create(TID);
+    }
+}
+
+static void
+DebugeeStopAllThreads(debugee *Debugee)
+{
+    for(u32 I = 0; I < Debugee->ThreadCount; I++)
+    {
+        debugee_thread *Thread = &Debugee->Threads[I];
+        if(!Thread->Flags.Stopped && !Thread->Flags.Starting)
+        {
+            syscall(SYS_tgkill, Debugee->PID, Thread->TID, SIGSTOP);
+            Thread->Flags.SigStopPending = true;
+        }
+    }
+
+    // NOTE(mateusz): ThreadCount can grow while we wait, the threads cloned in
+    // the meantime are waited for as well.
+    for(u32 I = 0; I < Debugee->ThreadCount; I++)
+    {
+        debugee_thread *Thread = &Debugee->Threads[I];
+        while(!Thread->Flags.Stopped)
+        {
+            i32 WaitStatus = 0;
+            if(waitpid(Thread->TID, &WaitStatus, __WALL) == -1 ||
+               WIFEXITED(WaitStatus) || WIFSIGNALED(WaitStatus))
+            {
+                Thread->Flags.Exited = true;
+                break;
+            }
+
+            Thread->Flags.Stopped = true;
+
+            i32 StopSignal = WSTOPSIG(WaitStatus);
+            bool EventStop = (WaitStatus >> 16) == PTRACE_EVENT_STOP;
+            if((WaitStatus >> 16) == PTRACE_EVENT_CLONE)
+            {
+                unsigned long NewTID = 0;
+                ptrace(PTRACE_GETEVENTMSG, Thread->TID, 0x0, &NewTID);
+                if(!DebugeeThreadFind(Debugee, NewTID))
+                {
+                    DebugeeThreadAdd(Debugee, NewTID)->Flags.Starting = true;
+                }
+            }
+            else if((StopSignal == SIGSTOP || EventStop) && Thread->Flags.Starting)
+            {
+                Thread->Flags.Starting = false;
+            }
+            else if(EventStop)
+            {
+            }
+            else if(StopSignal == SIGSTOP && Thread->Flags.SigStopPending)
+            {
+                Thread->Flags.SigStopPending = false;
+            }
+            else if(StopSignal == SIGSTOP && TracerConsumeInterruptStop())
+            {
+            }
+            else if(StopSignal == SIGTRAP)
+            {
+                DebugeeThreadRewindBreakpoint(Thread);
+            }
+            else
+            {
+                Thread->PendingSignal = StopSignal;
+            }
+        }
+    }
+
+    DebugeeThreadsCompact(Debugee);
+}
+
+static void
+DebugeeResumeOtherThreads(debugee *Debugee)
+{
+    for(u32 I = 0; I < Debugee->ThreadCount; I++)
+    {
+        debugee_thread *Thread = &Debugee->Threads[I];
+        if(Thread->TID != Debugee->TID && Thread->Flags.Stopped)
+        {
+            DebugeeThreadResume(Thread, PTRACE_CONT);
+        }
+    }
+}
+
+static void
+TracerCreate()
+{
+    assert(sem_init(&Tracer.Wakeup, 0, 0) == 0);
+    assert(pthread_mutex_init(&Tracer.IdleLock, 0x0) == 0);
+    assert(pthread_cond_init(&Tracer.Idle, 0x0) == 0);
+    assert(pthread_create(&Tracer.Thread, 0x0, TracerMain, 0x0) == 0);
+}
+
+static void
+TracerDestroy()
+{
+    if(TracerBusy())
+    {
+        TracerInterrupt();
+    }
+
+    TracerPush(TRACER_CMD_QUIT);
+    pthread_join(Tracer.Thread, 0x0);
+    sem_destroy(&Tracer.Wakeup);
+    pthread_cond_destroy(&Tracer.Idle);
+    pthread_mutex_destroy(&Tracer.IdleLock);
+}
+
+static void *
+TracerMain(void *Arg)
+{
+    (void)Arg;
+
+    for(;;)
+    {
+        sem_wait(&Tracer.Wakeup);
+
+        tracer_command Cmd = {};
+        if(!TracerPop(&Cmd))
+        {
+            continue;
+        }
+
+        if(Cmd.Type == TRACER_CMD_QUIT)
+        {
+            // Leaving the breakpoints in a process we did not start would crash it
+            DebugeeDetach(&Debugee);
+
+            __atomic_store_n(&Tracer.Executing, 0, __ATOMIC_RELEASE);
+            TracerSignalIdle();
+            break;
+        }
+
+        TracerExecute(&Cmd);
+        TracerPublishStop();
+
+        __atomic_store_n(&Tracer.Executing, 0, __ATOMIC_RELEASE);
+        TracerSignalIdle();
+        glfwPostEmptyEvent();
+    }
+
+    return 0x0;
+}
+
+static bool
+TracerPush(tracer_command Cmd)
+{
+    u32 Write = Tracer.QueueWrite;
+    u32 Read = __atomic_load_n(&Tracer.QueueRead, __ATOMIC_ACQUIRE);
+    if(Write - Read >= TRACER_QUEUE_SIZE)
+    {
+        return false;
+    }
+
+    Tracer.Queue[Write % TRACER_QUEUE_SIZE] = Cmd;
+    __atomic_store_n(&Tracer.QueueWrite, Write + 1, __ATOMIC_RELEASE);
+    sem_post(&Tracer.Wakeup);
+
+    return true;
+}
+
+static bool
+TracerPush(tracer_command_type Type)
+{
+    tracer_command Cmd = {};
+    Cmd.Type = Type;
+
+    return TracerPush(Cmd);
+}
+
+static bool
+TracerPop(tracer_command *Cmd)
+{
+    u32 Read = Tracer.QueueRead;
+    u32 Write = __atomic_load_n(&Tracer.QueueWrite, __ATOMIC_ACQUIRE);
+    if(Read == Write)
+    {
+        return false;
+    }
+
+    *Cmd = Tracer.Queue[Read % TRACER_QUEUE_SIZE];
+
+    // NOTE(mateusz): Executing has to be visible before the slot is released,
+    // otherwise the GUI could see an empty queue and an idle tracer at once.
+    __atomic_store_n(&Tracer.Executing, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&Tracer.InterruptRequested, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&Tracer.QueueRead, Read + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+static void
+TracerExecute(tracer_command *Cmd)
+{
+    Tracer.StopReason = STOP_REASON_NONE;
+    Tracer.StopSignal = 0;
+
+    switch(Cmd->Type)
+    {
+        case TRACER_CMD_CONTINUE_OR_START:
+        {
+            DebugeeContinueOrStart(&Debugee);
+        }break;
+        case TRACER_CMD_RESTART:
+        {
+            DebugeeRestart(&Debugee);
+        }break;
+        case TRACER_CMD_STEP_OUT:
+        {
+            DebugeeStepOutOfFunction(&Debugee);
+        }break;
+        case TRACER_CMD_NEXT_LINE:
+        {
+            DebugeeToNextLine(&Debugee, false);
+        }break;
+        case TRACER_CMD_STEP_LINE:
+        {
+            DebugeeToNextLine(&Debugee, true);
+        }break;
+        case TRACER_CMD_NEXT_INSTRUCTION:
+        {
+            DebugeeToNextInstruction(&Debugee, false);
+        }break;
+        case TRACER_CMD_STEP_INSTRUCTION:
+        {
+            DebugeeToNextInstruction(&Debugee, true);
+        }break;
+        case TRACER_CMD_RUN_TO_ADDRESS:
+        {
+            DebugeeRunToAddress(&Debugee, Cmd->Address);
+        }break;
+        case TRACER_CMD_SET_NEXT_STATEMENT:
+        {
+            DebugeeSetNextStatement(&Debugee, Cmd->Address);
+        }break;
+        case TRACER_CMD_STEP_LINES:
+        {
+            DebugeeStepLines(&Debugee, Cmd->Count, Cmd->Text);
+        }break;
+        case TRACER_CMD_BREAK_AT_ADDRESS:
+        {
+            if(Cmd->Address)
+            {
+                BreakAtAddress(Cmd->Address);
+            }
+            else
+            {
+                BreakAtAddress(Cmd->Text);
+            }
+        }break;
+        case TRACER_CMD_BREAK_AT_FUNCTION:
+        {
+            BreakAtFunctionName(Cmd->Text, &Tracer.BreakpointsDropped);
+        }break;
+        case TRACER_CMD_TOGGLE_SOURCE_LINE:
+        {
+            BreakpointToggleAtSourceLine(Cmd->SrcFileIndex, Cmd->LineNum);
+        }break;
+        case TRACER_CMD_SELECT_THREAD:
+        {
+            DebugeeThreadSwitch(&Debugee, Cmd->ThreadID);
+        }break;
+        case TRACER_CMD_ATTACH:
+        {
+            DebugeeAttach(&Debugee, Cmd->ProcessID);
+        }break;
+        case TRACER_CMD_DETACH:
+        {
+            DebugeeDetach(&Debugee);
+        }break;
+        default:
+        {
+            assert(false && "Unknown tracer command");
+        }break;
+    }
+
+    if(Debugee.Flags.Running)
+    {
+        DebugerUpdateTransient(&Debuger);
+    }
+}
+
+static void
+TracerPublishStop()
+{
+    stop_snapshot *Snapshot = &Tracer.Snapshot;
+
+    // NOTE(mateusz): Commands that did not move the debugee keep the frames unwound before
+    bool StackMoved = Snapshot->TID != Debugee.TID || Snapshot->PC != Debugee.Regs.RIP ||
+                      Snapshot->Regs.RSP != Debugee.Regs.RSP || !Snapshot->Running;
+
+    Snapshot->Running = Debugee.Flags.Running;
+    Snapshot->Reason = Tracer.StopReason;
+    Snapshot->Signal = Tracer.StopSignal;
+    Snapshot->Regs = Debugee.Flags.Running ? Debugee.Regs : x64_registers{};
+    Snapshot->PC = Snapshot->Regs.RIP;
+    Snapshot->TID = Debugee.TID;
+    Snapshot->Steps = Tracer.Steps;
+    Snapshot->StepsPerSecond = Tracer.StepsPerSecond;
+
+    // NOTE(mateusz): libunwind reads the registers through ptrace so the
+    // stack can only be unwound here.
+    if(!Debugee.Flags.Running)
+    {
+        Snapshot->FrameCount = 0;
+    }
+    else if(StackMoved)
+    {
+        DebugeeUnwindStack(&Debugee, Snapshot);
+    }
+
+    u32 Sequence = Tracer.SnapshotPublished + 1;
+    __atomic_store_n(&Tracer.SnapshotPublished, Sequence, __ATOMIC_RELEASE);
+}
+
+static bool
+TracerBusy()
+{
+    u32 Write = Tracer.QueueWrite;
+    u32 Read = __atomic_load_n(&Tracer.QueueRead, __ATOMIC_ACQUIRE);
+    u32 Executing = __atomic_load_n(&Tracer.Executing, __ATOMIC_ACQUIRE);
+
+    return Read != Write || Executing;
+}
+
+// NOTE(mateusz): Only for commands that do not resume the debugee, they finish
+// in microseconds and the GUI wants to see the result in the same frame.
+// NOTE(mateusz): Broadcast under the lock after Executing is cleared, so a waiter
+// that saw a busy tracer is already waiting on the condition when it is signalled.
+static void
+TracerSignalIdle()
+{
+    pthread_mutex_lock(&Tracer.IdleLock);
+    pthread_cond_broadcast(&Tracer.Idle);
+    pthread_mutex_unlock(&Tracer.IdleLock);
+}
+
+static void
+TracerWaitIdle()
+{
+    pthread_mutex_lock(&Tracer.IdleLock);
+    while(TracerBusy())
+    {
+        pthread_cond_wait(&Tracer.Idle, &Tracer.IdleLock);
+    }
+    pthread_mutex_unlock(&Tracer.IdleLock);
+}
+
+static void
+TracerInterrupt()
+{
+    i32 PID = __atomic_load_n(&Debugee.PID, __ATOMIC_ACQUIRE);
+    if(PID > 0 && TracerBusy())
+    {
+        __atomic_store_n(&Tracer.InterruptRequested, 1, __ATOMIC_RELEASE);
+        __atomic_add_fetch(&Tracer.InterruptStops, 1, __ATOMIC_ACQ_REL);
+        kill(PID, SIGSTOP);
+    }
+}
+
+static bool
+TracerInterrupted()
+{
+    return __atomic_load_n(&Tracer.InterruptRequested, __ATOMIC_ACQUIRE) != 0;
+}
+
+static bool
+TracerConsumeInterruptStop()
+{
+    u32 Stops = __atomic_load_n(&Tracer.InterruptStops, __ATOMIC_ACQUIRE);
+    while(Stops > 0)
+    {
+        if(__atomic_compare_exchange_n(&Tracer.InterruptStops, &Stops, Stops - 1, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+static bool
+TracerConsumeSnapshot(stop_snapshot *Snapshot)
+{
+    u32 Published = __atomic_load_n(&Tracer.SnapshotPublished, __ATOMIC_ACQUIRE);
+    if(Published == Tracer.SnapshotConsumed)
+    {
+        return false;
+    }
+
+    *Snapshot = Tracer.Snapshot;
+    Tracer.SnapshotConsumed = Published;
+
+    return true;
+}
+
+static x64_registers
+DebugeePeekRegisters(debugee *Debugee)
+{
+    x64_registers Result = {};
+    
+    user_regs_struct USR = {};
+    ptrace(PTRACE_GETREGS, Debugee->TID, 0x0, &USR);
+    
+    Result = RegistersFromUSR(USR);
+    return Result;
+}
+
+static void
+DebugeePeekXSave(debugee *Debugee)
+{
+    struct iovec IO = { Debugee->XSaveBuffer, Debugee->XSaveSize };
+    ptrace(PTRACE_GETREGSET, Debugee->TID, NT_X86_XSTATE, &IO);
+
+    u64 XStateBV = *((u64 *)(&Debugee->XSaveBuffer[512]));
+
+    Debugee->RegsFlags.EnabledSSE = (XStateBV & (1 << 1)) ? 1 : 0;
+    Debugee->RegsFlags.EnabledAVX = (XStateBV & (1 << 2)) ? 1 : 0;
+}
+
+static void
+DebugeeSetRegisters(debugee *Debugee, x64_registers Regs)
+{
+    user_regs_struct USR = RegistersToUSR(Regs);
+    ptrace(PTRACE_SETREGS, Debugee->TID, 0x0, &USR);
+}
+
+static inline size_t
+DebugeeGetProgramCounter(debugee *Debugee)
+{
+    return Debugee->Regs.RIP;
+}
+
+// NOTE(mateusz): Fails for code without frame information, Result is left as 0x0
+static inline bool
+DebugeeGetReturnAddress(debugee *Debugee, size_t Address, size_t *Result)
+{
+    *Result = 0x0;
+    size_t CFA = 0x0;
+    if(!DwarfGetCanonicalFrameAddress(Address, &CFA))
+    {
+        return false;
+    }
+    
+    *Result = DebugeePeekMemory(Debugee, CFA - 8);
+
+    return true;
+}
+
+// NOTE(mateusz): Memory goes through /proc/pid/mem and not PEEKDATA/POKEDATA,
+// ptrace requests are only accepted from the tracer thread and the GUI has to
+// be able to read (and edit) variables of a stopped debugee.
+static void
+DebugeePokeMemory(debugee *Debugee, size_t Address, size_t MachineWord)
+{
+    pwrite(Debugee->MemoryFD, &MachineWord, sizeof(MachineWord), Address);
+}
+
+static size_t
+DebugeePeekMemory(debugee *Debugee, size_t Address)
+{
+    size_t MachineWord = 0;
+
+    DebugeeReadMemory(Debugee, Address, (u8 *)&MachineWord, sizeof(MachineWord));
+    
+    return MachineWord;
+}
+
+// Out array has be a multiple of 8 sized 
+static void
+DebugeePeekMemoryArray(debugee *Debugee, size_t StartAddress, size_t EndAddress, u8 *OutArray, u32 BytesToRead)
+{
+    // Whole words up to the one EndAddress is in
+    size_t WordsSize = (EndAddress - StartAddress + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1);
+    DebugeeReadMemory(Debugee, StartAddress, OutArray, MIN((size_t)BytesToRead, WordsSize));
+}
+
+// NOTE(mateusz): One read for the whole range, the part that could not be read
+// is left as it was in OutArray. Read only segments of the files come from the
+// mappings of these files, they have the original bytes where our breakpoints are.
+static size_t
+DebugeeReadMemory(debugee *Debugee, size_t Address, u8 *OutArray, size_t BytesToRead)
+{
+    image_mapping *Mapping = DebugeeFindImageMapping(Debugee, Address);
+    if(Mapping && Address + BytesToRead <= Mapping->End)
+    {
+        memcpy(OutArray, &Mapping->Bytes[Address - Mapping->Start], BytesToRead);
+        return BytesToRead;
+    }
+    
+    ssize_t Result = pread(Debugee->MemoryFD, OutArray, BytesToRead, Address);
+
+    return Result > 0 ? Result : 0;
+}
+
+static size_t
+DebugeeGetLoadAddress(debugee *Debugee)
+{
+    i32 PID = Debugee->PID;
+
+    // NOTE(mateusz): The link keeps pointing at the running image even if the
+    // file on the disk was replaced in the meantime.
+    char Path[64] = {};
+    char ExePath[PATH_MAX] = {};
+    sprintf(Path, "/proc/%d/exe", PID);
+    readlink(Path, ExePath, sizeof(ExePath) - 1);
+    
+    sprintf(Path, "/proc/%d/maps", PID);
+    LOG_DWARF("Load Path is %s\n", Path);
+    
+    FILE *FileHandle = fopen(Path, "r");
+    assert(FileHandle);
+
+    size_t Result = 0x0;
+    size_t FirstMapping = 0x0;
+    char Line[PATH_MAX + 128] = {};
+    while(fgets(Line, sizeof(Line), FileHandle))
+    {
+        size_t Start = 0x0;
+        size_t Offset = 0x0;
+        char MappedPath[PATH_MAX] = {};
+        i32 Fields = sscanf(Line, "%lx-%*x %*s %lx %*s %*s %[^\n]", &Start, &Offset, MappedPath);
+
+        if(!FirstMapping)
+        {
+            FirstMapping = Start;
+        }
+
+        if(Fields == 3 && Offset == 0x0 && StringMatches(MappedPath, ExePath))
+        {
+            Result = Start;
+            break;
+        }
+    }
+
+    fclose(FileHandle);
+
+    return Result ? Result : FirstMapping;
+}
+
+static u32
+DebugeeGetMemoryRegions(debugee *Debugee, memory_region *Regions, u32 MaxRegions, bool *Truncated)
+{
+    char Path[64] = {};
+    sprintf(Path, "/proc/%d/maps", Debugee->PID);
+
+    FILE *FileHandle = fopen(Path, "r");
+    if(!FileHandle)
+    {
+        return 0;
+    }
+
+    u32 Result = 0;
+    char Line[PATH_MAX + 128] = {};
+    while(Result < MaxRegions && fgets(Line, sizeof(Line), FileHandle))
+    {
+        memory_region *Region = &Regions[Result];
+        char Perms[8] = {};
+        if(sscanf(Line, "%lx-%lx %7s %lx", &Region->Start, &Region->End, Perms, &Region->Offset) != 4)
+        {
+            continue;
+        }
+
+        Region->Readable = Perms[0] == 'r';
+        Region->Writable = Perms[1] == 'w';
+        Region->Executable = Perms[2] == 'x';
+        Result += 1;
+    }
+
+    if(Truncated)
+    {
+        (*Truncated) = Result == MaxRegions && fgets(Line, sizeof(Line), FileHandle) != 0x0;
+    }
+
+    fclose(FileHandle);
+
+    return Result;
+}
+
+// NOTE(mateusz): Segments that are not writable in the ELF file. The RELRO part of
+// the writable segment is read only in the maps too but it was relocated before
+// that so it is not the same as the file. Objects with text relocations get their
+// read only segments written by the loader, none of them are the file.
+static bool
+DebugeeImageReadOnly(i32 Fd, size_t Offset, size_t Size)
+{
+    Elf64_Ehdr Header = {};
+    if(pread(Fd, &Header, sizeof(Header), 0) != sizeof(Header) ||
+       memcmp(Header.e_ident, ELFMAG, SELFMAG) != 0 || Header.e_ident[EI_CLASS] != ELFCLASS64)
+    {
+        return false;
+    }
+    
+    bool Result = false;
+    bool TextRelocations = false;
+    for(u32 I = 0; I < Header.e_phnum; I++)
+    {
+        Elf64_Phdr Segment = {};
+        size_t SegmentOffset = Header.e_phoff + I * sizeof(Elf64_Phdr);
+        if(pread(Fd, &Segment, sizeof(Segment), SegmentOffset) != sizeof(Segment))
+        {
+            return false;
+        }
+        
+        size_t PageMask = sysconf(_SC_PAGESIZE) - 1;
+        size_t SegmentStart = Segment.p_offset & ~PageMask;
+        size_t SegmentEnd = (Segment.p_offset + Segment.p_filesz + PageMask) & ~PageMask;
+        if(Segment.p_type == PT_LOAD && Offset >= SegmentStart && Offset + Size <= SegmentEnd)
+        {
+            Result = !(Segment.p_flags & PF_W);
+        }
+        else if(Segment.p_type == PT_DYNAMIC)
+        {
+            Elf64_Dyn Entries[64] = {};
+            size_t DynamicEnd = Segment.p_offset + Segment.p_filesz;
+            bool Done = false;
+            for(size_t At = Segment.p_offset; At < DynamicEnd && !Done; At += sizeof(Entries))
+            {
+                ssize_t Read = pread(Fd, Entries, MIN(sizeof(Entries), DynamicEnd - At), At);
+                u32 EntriesCount = Read > 0 ? Read / sizeof(Elf64_Dyn) : 0;
+                Done = EntriesCount == 0;
+                for(u32 J = 0; J < EntriesCount && !Done; J++)
+                {
+                    Elf64_Dyn *Entry = &Entries[J];
+                    TextRelocations |= Entry->d_tag == DT_TEXTREL;
+                    TextRelocations |= Entry->d_tag == DT_FLAGS && (Entry->d_un.d_val & DF_TEXTREL);
+                    Done = Entry->d_tag == DT_NULL;
+                }
+            }
+        }
+    }
+    
+    return Result && !TextRelocations;
+}
+
+static bool
+DebugeeImageRejected(debugee *Debugee, image_mapping *Mapping)
+{
+    for(u32 I = 0; I < Debugee->ImageRejectedCount; I++)
+    {
+        image_rejected *Rejected = &Debugee->ImageRejected[I];
+        if(Rejected->Inode == Mapping->Inode && Rejected->Offset == Mapping->Offset)
+        {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+// NOTE(mateusz): Done after the stops where the file mappings changed, mappings that
+// didn't change since the last time are kept. Reads that miss it go to the process.
+static void
+DebugeeMapImage(debugee *Debugee)
+{
+    Debugee->Flags.ImageStale = false;
+    
+    char Path[64] = {};
+    sprintf(Path, "/proc/%d/maps", Debugee->PID);
+
+    FILE *FileHandle = fopen(Path, "r");
+    if(!FileHandle)
+    {
+        return;
+    }
+    
+    image_mapping Mapped[MAX_IMAGE_MAPPINGS] = {};
+    u32 MappedCount = 0;
+    char Line[PATH_MAX + 128] = {};
+    while(MappedCount < MAX_IMAGE_MAPPINGS && fgets(Line, sizeof(Line), FileHandle))
+    {
+        image_mapping Mapping = {};
+        char Perms[8] = {};
+        char MappedPath[PATH_MAX] = {};
+        i32 Fields = sscanf(Line, "%lx-%lx %7s %lx %*s %lu %[^\n]", &Mapping.Start, &Mapping.End,
+                            Perms, &Mapping.Offset, &Mapping.Inode, MappedPath);
+        if(Fields != 6 || Perms[0] != 'r' || Perms[1] == 'w' || MappedPath[0] != '/')
+        {
+            continue;
+        }
+        
+        bool Kept = false;
+        for(u32 I = 0; I < Debugee->ImageCount && !Kept; I++)
+        {
+            image_mapping *Old = &Debugee->Image[I];
+            if(Old->Bytes && Old->Start == Mapping.Start && Old->Offset == Mapping.Offset &&
+               Old->Inode == Mapping.Inode)
+            {
+                Mapped[MappedCount++] = *Old;
+                Old->Bytes = 0x0;
+                Kept = true;
+            }
+        }
+        
+        if(Kept || DebugeeImageRejected(Debugee, &Mapping))
+        {
+            continue;
+        }
+        
+        // Files replaced on disk since they were mapped are read from the process
+        i32 Fd = open(MappedPath, O_RDONLY);
+        struct stat Stat = {};
+        if(Fd != -1 && fstat(Fd, &Stat) == 0 && Stat.st_ino == Mapping.Inode &&
+           (size_t)Stat.st_size > Mapping.Offset &&
+           DebugeeImageReadOnly(Fd, Mapping.Offset, Mapping.End - Mapping.Start))
+        {
+            // Past the end of the file the pages can't be read
+            size_t Size = MIN(Mapping.End - Mapping.Start, Stat.st_size - Mapping.Offset);
+            void *Bytes = mmap(0x0, Size, PROT_READ, MAP_PRIVATE, Fd, Mapping.Offset);
+            if(Bytes != MAP_FAILED)
+            {
+                Mapping.End = Mapping.Start + Size;
+                Mapping.Bytes = (u8 *)Bytes;
+                Mapped[MappedCount++] = Mapping;
+            }
+        }
+        
+        if(!Mapping.Bytes && Debugee->ImageRejectedCount < MAX_IMAGE_MAPPINGS)
+        {
+            image_rejected *Rejected = &Debugee->ImageRejected[Debugee->ImageRejectedCount++];
+            Rejected->Inode = Mapping.Inode;
+            Rejected->Offset = Mapping.Offset;
+        }
+        
+        if(Fd != -1)
+        {
+            close(Fd);
+        }
+    }
+    
+    fclose(FileHandle);
+    
+    DebugeeUnmapImage(Debugee);
+    memcpy(Debugee->Image, Mapped, MappedCount * sizeof(image_mapping));
+    Debugee->ImageCount = MappedCount;
+}
+
+static void
+DebugeeUnmapImage(debugee *Debugee)
+{
+    for(u32 I = 0; I < Debugee->ImageCount; I++)
+    {
+        image_mapping *Mapping = &Debugee->Image[I];
+        if(Mapping->Bytes)
+        {
+            munmap(Mapping->Bytes, Mapping->End - Mapping->Start);
+        }
+    }
+    
+    Debugee->ImageCount = 0;
+}
+
+static image_mapping *
+DebugeeFindImageMapping(debugee *Debugee, size_t Address)
+{
+    // The maps are sorted by address
+    u32 Low = 0;
+    u32 High = Debugee->ImageCount;
+    while(Low < High)
+    {
+        u32 Middle = Low + (High - Low) / 2;
+        image_mapping *Mapping = &Debugee->Image[Middle];
+        if(Address < Mapping->Start)
+        {
+            High = Middle;
+        }
+        else if(Address >= Mapping->End)
+        {
+            Low = Middle + 1;
+        }
+        else
+        {
+            return Mapping;
+        }
+    }
+    
+    return 0x0;
+}
+
+// NOTE(mateusz): Pushes the virtual frames of the calls inlined at Address,
+// innermost first, and then the frame of the function itself.
+static void
+DebugeeBacktracePushFrames(unwind_functions_bucket **Bucket, di_function *Func, size_t Address, size_t CFA)
+{
+    unwind_function UnwoundFunction = 0x0;
+    for(u32 I = 0; I < Gui->Transient.FuncRepresentationCount; I++)
+    {
+        if(Gui->Transient.FuncRepresentation[I].ActualFunction == Func)
+        {
+            UnwoundFunction = &Gui->Transient.FuncRepresentation[I];
+        }
+    }
+    assert(UnwoundFunction);
+
+    di_inlined_call *Inlined[MAX_INLINED_DEPTH] = {};
+    u32 InlinedCount = DwarfFindInlinedCallsByAddress(Func, Address, Inlined, ARRAY_LENGTH(Inlined));
+    
+    for(u32 I = 0; I <= InlinedCount; I++)
+    {
+        unwind_frame *Frame = DebugeeBacktraceNextFrame(Bucket);
+        Frame->Function = UnwoundFunction;
+        Frame->Inlined = I < InlinedCount ? Inlined[I] : 0x0;
+        Frame->CFA = CFA;
+    }
+}
+
+static unwind_frame *
+DebugeeBacktraceNextFrame(unwind_functions_bucket **Bucket)
+{
+    if((*Bucket)->Count >= ARRAY_LENGTH((*Bucket)->Frames))
+    {
+        SLL_QUEUE_PUSH(Debuger.Unwind.FuncList.Head, Debuger.Unwind.FuncList.Tail, *Bucket);
+        *Bucket = (unwind_functions_bucket *)calloc(1, sizeof(unwind_functions_bucket));
+    }
+    
+    return &(*Bucket)->Frames[(*Bucket)->Count++];
+}
+
+// NOTE(mateusz): Code without DWARF gets a frame named after its ELF symbol, the
+// backtrace ends at the first address that has neither.
+static bool
+DebugeeBacktracePushAddress(unwind_functions_bucket **Bucket, size_t Address, size_t CFA)
+{
+    di_function *Func = DwarfFindFunctionByAddress(Address);
+    if(Func)
+    {
+        DebugeeBacktracePushFrames(Bucket, Func, Address, CFA);
+        return true;
+    }
+    
+    size_t SymbolOffset = 0;
+    char *Symbol = DwarfFindElfSymbolByAddress(Address, &SymbolOffset);
+    if(Symbol)
+    {
+        unwind_frame *Frame = DebugeeBacktraceNextFrame(Bucket);
+        Frame->Symbol = Symbol;
+        Frame->SymbolOffset = SymbolOffset;
+        Frame->CFA = CFA;
+        return true;
+    }
+    
+    return false;
+}
+
+// NOTE(mateusz): The CFA of a frame is the stack pointer of its caller after the
+// return, the last frame gets 0x0 when libunwind can't go any further.
+static void
+DebugeeUnwindStack(debugee *Debugee, stop_snapshot *Snapshot)
+{
+    unw_context_t UnwindCtx = {};
+    unw_getcontext(&UnwindCtx);
+    unw_addr_space_t UnwindAddressSpace = unw_create_addr_space(&_UPT_accessors, __LITTLE_ENDIAN);
+    assert(UnwindAddressSpace);
+    
+    unw_cursor_t UnwindCursor = {};
+    assert(unw_init_remote(&UnwindCursor, UnwindAddressSpace, Debuger.UnwindRemoteArg) == 0);
+
+    Snapshot->FrameCount = 0;
+    size_t Address = DebugeeGetProgramCounter(Debugee);
+    
+    while(Snapshot->FrameCount < MAX_UNWIND_FRAMES)
+    {
+        u32 I = Snapshot->FrameCount++;
+        Snapshot->FramePCs[I] = Address;
+        Snapshot->FrameCFAs[I] = 0x0;
+
+        if(unw_step(&UnwindCursor) <= 0)
+        {
+            break;
+        }
+
+        unw_word_t StackPointer = 0x0;
+        unw_get_reg(&UnwindCursor, UNW_REG_SP, &StackPointer);
+        Snapshot->FrameCFAs[I] = StackPointer;
+
+        // NOTE(mateusz): The return address can be the first instruction after an
+        // inlined call or after a call that doesn't return, the call instruction
+        // itself is still inside of the caller
+        Address = DebugeePeekMemory(Debugee, StackPointer - 8) - 1;
+    }
+
+    unw_destroy_addr_space(UnwindAddressSpace);
+}
+
+// NOTE(mateusz): Runs on the GUI thread, the labels of the functions live in the GUI arena
+static void
+DebugeeBuildBacktrace(stop_snapshot *Snapshot)
+{
+    if(Debuger.Unwind.FuncList.Head)
+    {
+        unwind_functions_bucket *Bucket = Debuger.Unwind.FuncList.Head;
+
+        while(Bucket)
+        {
+            unwind_functions_bucket *ToDelete = Bucket;
+            Bucket = Bucket->Next;
+
+            free(ToDelete);
+        }
+        Debuger.Unwind.FuncList.Head = 0x0;
+    }
+    
+    if(!Snapshot->Running || Snapshot->FrameCount == 0)
+    {
+        return;
+    }
+    
+    if(!Gui->Transient.FuncRepresentation)
+    {
+        GuiBuildFunctionRepresentation();
+    }
+    
+    unwind_functions_bucket *Bucket = (unwind_functions_bucket *)calloc(1, sizeof(unwind_functions_bucket));
+    
+    for(u32 I = 0; I < Snapshot->FrameCount; I++)
+    {
+        if(!DebugeeBacktracePushAddress(&Bucket, Snapshot->FramePCs[I], Snapshot->FrameCFAs[I]))
+        {
+            break;
+        }
+    }
+
+    SLL_QUEUE_PUSH(Debuger.Unwind.FuncList.Head, Debuger.Unwind.FuncList.Tail, Bucket);
+}
+
+static void
+DisassembleAroundAddress(address_range AddrRange)
+{
+    LOG_MAIN("AddrRange = %lx - %lx\n", AddrRange.Start, AddrRange.End);
+    u32 InstCount = 0;
+    cs_option(DisAsmHandle, CS_OPT_DETAIL, CS_OPT_OFF); 
+
+    cs_insn *Instruction = {};
+    size_t InstructionAddress = AddrRange.Start;
+    while(InstructionAddress < AddrRange.End)
+    {
+        u8 InstrInMemory[16] = {};
+        DebugeePeekMemoryArray(&Debugee, InstructionAddress, AddrRange.End, InstrInMemory, sizeof(InstrInMemory));
+        
+        {
+            breakpoint *BP = 0x0; ;
+            if((BP = BreakpointFind(InstructionAddress)) && BreakpointEnabled(BP))
+            {
+                InstrInMemory[0] = (u8)(BP->SavedOpCodes & 0xff);
+            }
+        }
+        
+        int Count = cs_disasm(DisAsmHandle, InstrInMemory, sizeof(InstrInMemory),
+                              InstructionAddress, 1, &Instruction);
+        
+        if(Count == 0) { break; }
+
+        InstCount++;
+        InstructionAddress += Instruction->size;
+        
+        cs_free(Instruction, 1);
+    }
+    cs_option(DisAsmHandle, CS_OPT_DETAIL, CS_OPT_ON);
+
+    DisasmInstCount = 0;
+    
+    InstructionAddress = AddrRange.Start;
+    di_function *LastTarget = 0x0;
+    ArenaClear(&DisasmArena);
+    DisasmInst = ArrayPush(&DisasmArena, disasm_inst, InstCount);
+    for(u32 I = 0; I < InstCount; I++)
+    {
+        u8 InstrInMemory[16] = {};
+        DebugeePeekMemoryArray(&Debugee, InstructionAddress, AddrRange.End, InstrInMemory, sizeof(InstrInMemory));
+        
+        {
+            breakpoint *BP = 0x0; ;
+            if((BP = BreakpointFind(InstructionAddress)) && BreakpointEnabled(BP))
+            {
+                InstrInMemory[0] = (u8)(BP->SavedOpCodes & 0xff);
+            }
+        }
+        
+        int Count = cs_disasm(DisAsmHandle, InstrInMemory, sizeof(InstrInMemory),
+                              InstructionAddress, 1, &Instruction);
+        
+        if(Count == 0) { break; }
+        
+        DisassembleFillInst(&DisasmInst[I], Instruction, &DisasmArena, &LastTarget);
+        InstructionAddress += Instruction->size;
+        DisasmInstCount++;
+        
+        cs_free(Instruction, 1);
+    }
+    
+    DisasmRange.Start = AddrRange.Start;
+    DisasmRange.End = InstructionAddress;
+    DisassembleMapLines();
+}
+
+static void
+DisassembleFillInst(disasm_inst *Inst, cs_insn *Instruction, arena *Arena, di_function **LastTarget)
+{
+    Inst->Address = Instruction->address;
+    Inst->Mnemonic = StringDuplicate(Arena, Instruction->mnemonic);
+    Inst->Operation = DisassembleAnnotateOperation(Instruction, Arena, LastTarget);
+    
+    // Mnemonics are aligned to the longest one of 11 characters, the table has 10 entries
+    i32 PaddingLength = 11 - StringLength(Instruction->mnemonic);
+    Inst->Padding = Gui->SpacesArray[PaddingLength < 0 ? 0 : MIN(PaddingLength, (i32)ARRAY_LENGTH(Gui->SpacesArray) - 1)];
+}
+
+// NOTE(mateusz): Maps the instructions to their source lines and to the rows of the
+// interleaved view, and every byte of the range to its instruction. Going back,
+// every source line gets the runs of instructions under it. Nothing has to be
+// searched when the disassembly is drawn.
+static void
+DisassembleMapLines()
+{
+    size_t RangeSize = DisasmRange.End - DisasmRange.Start;
+    DisasmInstByOffset = ArrayPush(&DisasmArena, u32, RangeSize);
+    
+    // Every instruction can start a new line
+    DisasmRows = ArrayPush(&DisasmArena, disasm_row, DisasmInstCount * 2);
+    DisasmRowsCount = 0;
+    DisasmLineRuns = ArrayPush(&DisasmArena, disasm_line_run, DisasmInstCount);
+    DisasmLineRunsCount = 0;
+    
+    di_src_line *PrevLine = 0x0;
+    for(u32 I = 0; I < DisasmInstCount; I++)
+    {
+        disasm_inst *Inst = &DisasmInst[I];
+        size_t InstEnd = I + 1 < DisasmInstCount ? DisasmInst[I + 1].Address : DisasmRange.End;
+        for(size_t Address = Inst->Address; Address < InstEnd; Address++)
+        {
+            DisasmInstByOffset[Address - DisasmRange.Start] = I;
+        }
+        
+        Inst->Line = DwarfFindLineByAddress(Inst->Address);
+        if(Inst->Line && Inst->Line != PrevLine)
+        {
+            disasm_line_run *Run = &DisasmLineRuns[DisasmLineRunsCount++];
+            Run->Line = Inst->Line;
+            Run->Row = DisasmRowsCount;
+            Run->FirstInst = I;
+
+            disasm_row *LineRow = &DisasmRows[DisasmRowsCount++];
+            LineRow->InstIndex = I;
+            LineRow->Line = Inst->Line;
+            PrevLine = Inst->Line;
+        }
 
-static inline size_t
-DebugeeGetProgramCounter(debugee *Debugee)
+        // Instructions without a line stay under the last one, like in the rows
+        if(DisasmLineRunsCount)
+        {
+            DisasmLineRuns[DisasmLineRunsCount - 1].InstCount += 1;
+        }
+        
+        Inst->Row = DisasmRowsCount;
+        disasm_row *InstRow = &DisasmRows[DisasmRowsCount++];
+        InstRow->InstIndex = I;
+        InstRow->Line = 0x0;
+    }
+
+    DisasmRunsByLineCapacity = 16;
+    while(DisasmRunsByLineCapacity < DisasmLineRunsCount * 2)
+    {
+        DisasmRunsByLineCapacity *= 2;
+    }
+    DisasmRunsByLine = ArrayPush(&DisasmArena, u32, DisasmRunsByLineCapacity);
+    memset(DisasmRunsByLine, 0, DisasmRunsByLineCapacity * sizeof(u32));
+
+    u32 Mask = DisasmRunsByLineCapacity - 1;
+    for(u32 I = 0; I < DisasmLineRunsCount; I++)
+    {
+        disasm_line_run *Run = &DisasmLineRuns[I];
+        Run->Next = 0;
+
+        u32 Slot = DisasmLineHash(Run->Line->SrcFileIndex, Run->Line->LineNum) & Mask;
+        for(; DisasmRunsByLine[Slot]; Slot = (Slot + 1) & Mask)
+        {
+            disasm_line_run *First = &DisasmLineRuns[DisasmRunsByLine[Slot] - 1];
+            if(First->Line->SrcFileIndex == Run->Line->SrcFileIndex && First->Line->LineNum == Run->Line->LineNum)
+            {
+                break;
+            }
+        }
+
+        if(!DisasmRunsByLine[Slot])
+        {
+            DisasmRunsByLine[Slot] = I + 1;
+            continue;
+        }
+
+        disasm_line_run *Last = &DisasmLineRuns[DisasmRunsByLine[Slot] - 1];
+        while(Last->Next)
+        {
+            Last = &DisasmLineRuns[Last->Next - 1];
+        }
+        Last->Next = I + 1;
+    }
+}
+
+static u32
+DisasmLineHash(u32 SrcFileIndex, u32 LineNum)
 {
-    return Debugee->Regs.RIP;
+    return (LineNum * 2654435761u) ^ (SrcFileIndex * 40503u);
 }
 
-static inline size_t
-DebugeeGetReturnAddress(debugee *Debugee, size_t Address)
+// NOTE(mateusz): The first run of instructions of a source line in the current
+// disassembly, the others follow through Next.
+static disasm_line_run *
+DisasmFindLineRun(u32 SrcFileIndex, u32 LineNum)
 {
-    size_t CFA = DwarfGetCanonicalFrameAddress(Address);
-    size_t MachineWord = DebugeePeekMemory(Debugee, CFA - 8);
+    if(!DisasmRunsByLine)
+    {
+        return 0x0;
+    }
 
-    return MachineWord;
+    u32 Mask = DisasmRunsByLineCapacity - 1;
+    for(u32 Slot = DisasmLineHash(SrcFileIndex, LineNum) & Mask; DisasmRunsByLine[Slot]; Slot = (Slot + 1) & Mask)
+    {
+        disasm_line_run *Run = &DisasmLineRuns[DisasmRunsByLine[Slot] - 1];
+        if(Run->Line->SrcFileIndex == SrcFileIndex && Run->Line->LineNum == LineNum)
+        {
+            return Run;
+        }
+    }
+
+    return 0x0;
 }
 
-static void
-DebugeePokeMemory(debugee *Debugee, size_t Address, size_t MachineWord)
+static i32
+DisasmFindInstByAddress(size_t Address)
 {
-    ptrace(PTRACE_POKEDATA, Debugee->PID, Address, MachineWord);
+    if(!DisasmInstByOffset || Address < DisasmRange.Start || Address >= DisasmRange.End)
+    {
+        return -1;
+    }
+    
+    u32 Index = DisasmInstByOffset[Address - DisasmRange.Start];
+    
+    // Addresses in the middle of an instruction
+    return DisasmInst[Index].Address == Address ? (i32)Index : -1;
 }
 
-static size_t
-DebugeePeekMemory(debugee *Debugee, size_t Address)
+// NOTE(mateusz): Direct calls and jumps get the name of their target, from DWARF when
+// it describes the target and from the ELF symbols otherwise. Jumps mostly stay in
+// the same function, so the last function found is tried first.
+static char *
+DisassembleAnnotateOperation(cs_insn *Instruction, arena *Arena, di_function **LastTarget)
 {
-    size_t MachineWord = 0;
-
-    MachineWord = ptrace(PTRACE_PEEKDATA, Debugee->PID, Address, 0x0);
+    cs_x86_op *Operand = &Instruction->detail->x86.operands[0];
+    bool DirectBranch = (AsmInstructionGetType(Instruction) & (INST_TYPE_CALL | INST_TYPE_JUMP)) &&
+        Instruction->detail->x86.op_count == 1 && Operand->type == X86_OP_IMM;
+    if(!DirectBranch)
+    {
+        return StringDuplicate(Arena, Instruction->op_str);
+    }
     
-    return MachineWord;
+    size_t Target = Operand->imm;
+    di_function *Func = *LastTarget;
+    if(!Func || !DwarfAddressConfinedByFunction(Func, Target))
+    {
+        Func = DwarfFindFunctionByAddress(Target);
+    }
+    
+    char *Name = 0x0;
+    size_t Offset = 0;
+    if(Func && Func->Name)
+    {
+        *LastTarget = Func;
+        Name = Func->Name;
+        Offset = Target - Func->FuncLexScope.LowPC;
+    }
+    else
+    {
+        Name = DwarfFindElfSymbolByAddress(Target, &Offset);
+    }
+    
+    if(!Name)
+    {
+        return StringDuplicate(Arena, Instruction->op_str);
+    }
+    
+    char Operation[256] = {};
+    if(Offset)
+    {
+        snprintf(Operation, sizeof(Operation), "%s <%s+0x%lx>", Instruction->op_str, Name, Offset);
+    }
+    else
+    {
+        snprintf(Operation, sizeof(Operation), "%s <%s>", Instruction->op_str, Name);
+    }
+    
+    return StringDuplicate(Arena, Operation);
 }
 
-// Out array has be a multiple of 8 sized 
-static void
-DebugeePeekMemoryArray(debugee *Debugee, size_t StartAddress, u32 EndAddress, u8 *OutArray, u32 BytesToRead)
+static bool
+DisasmStreamOpen(address_range Range)
 {
-    size_t *MemoryPtr = (size_t *)OutArray;
+    DisasmStreamClose();
+    if(Range.End <= Range.Start)
+    {
+        return false;
+    }
+    
+    disasm_stream *Stream = &DisasmStream;
+    Stream->FileFd = -1;
+    if(cs_open(CS_ARCH_X86, CS_MODE_64, &Stream->Handle) != CS_ERR_OK)
+    {
+        return false;
+    }
+    cs_option(Stream->Handle, CS_OPT_DETAIL, CS_OPT_ON);
     
-    size_t TempAddress = StartAddress;
-    for(u32 I = 0; I < BytesToRead / sizeof(size_t); I++)
+    // NOTE(mateusz): Breakpoints are never in the file so nothing has to be restored
+    // in what is read from it and the debugee doesn't have to be stopped.
+    di_module *Module = DwarfFindModuleByAddress(Range.Start);
+    address_range Section = {};
+    size_t FileOffset = 0;
+    if(Module && DwarfModuleCodeSection(Module, Range.Start, 0x0, &Section, &FileOffset) &&
+       Range.End <= Section.End)
     {
-        *MemoryPtr = DebugeePeekMemory(Debugee, TempAddress);
-        MemoryPtr += 1;
-        TempAddress += 8;
-        if(TempAddress >= EndAddress)
+        i32 Fd = open(Module->Path, O_RDONLY);
+        if(Fd != -1)
         {
-            break;
+            Stream->FileFd = Fd;
+            Stream->FileDelta = Section.Start - FileOffset;
         }
     }
+    
+    Stream->Range = Range;
+    Stream->ChunksCount = (u32)((Range.End - Range.Start + DISASM_CHUNK_SIZE - 1) / DISASM_CHUNK_SIZE);
+    Stream->ChunkRows = (u32 *)malloc(Stream->ChunksCount * sizeof(u32));
+    Stream->ChunkFirstRow = (u32 *)malloc((Stream->ChunksCount + 1) * sizeof(u32));
+    for(u32 I = 0; I < Stream->ChunksCount; I++)
+    {
+        Stream->ChunkRows[I] = DISASM_ESTIMATED_ROWS;
+    }
+    DisasmStreamCountRows(0);
+    
+    for(u32 I = 0; I < DISASM_RESIDENT_CHUNKS; I++)
+    {
+        Stream->Resident[I].Arena = ArenaCreate(Kilobytes(64));
+    }
+    
+    Stream->Active = true;
+    LOG_MAIN("Streaming %lx - %lx in %u chunks from the %s\n", Range.Start, Range.End,
+             Stream->ChunksCount, Stream->FileFd != -1 ? "file" : "memory");
+    
+    return true;
 }
 
-static size_t
-DebugeeGetLoadAddress(debugee *Debugee)
+static bool
+DisasmStreamOpenSection(size_t Address, char *Name)
 {
-    i32 PID = Debugee->PID;
-
-    char Path[PATH_MAX] = {};
-    sprintf(Path, "/proc/%d/maps", PID);
-    LOG_DWARF("Load Path is %s\n", Path);
-    
-    char AddrStr[16] = {};
-    FILE *FileHandle = fopen(Path, "r");
-    assert(FileHandle);
-    fread(AddrStr, sizeof(AddrStr), 1, FileHandle);
+    di_module *Module = DwarfFindModuleByAddress(Address);
+    address_range Section = {};
+    size_t FileOffset = 0;
+    if(!Module || !DwarfModuleCodeSection(Module, Address, Name, &Section, &FileOffset))
+    {
+        return false;
+    }
     
-    u32 Length = sizeof(AddrStr);
-    for(u32 I = 0; I < sizeof(AddrStr); I++)
+    return DisasmStreamOpen(Section);
+}
+
+static void
+DisasmStreamClose()
+{
+    disasm_stream *Stream = &DisasmStream;
+    if(!Stream->Active)
     {
-        if(AddrStr[I] == '-')
-        {
-            Length = I;
-            break;
-        }
+        return;
     }
     
-    size_t Result = 0x0;
+    for(u32 I = 0; I < DISASM_RESIDENT_CHUNKS; I++)
+    {
+        free(Stream->Resident[I].Insts);
+        ArenaDestroy(&Stream->Resident[I].Arena);
+    }
     
-    for(u32 I = 0; I < Length; I++)
+    if(Stream->FileFd != -1)
     {
-        size_t HexToDec = (AddrStr[I] - '0') > 10 ? (AddrStr[I] - 'a') + 10 : (AddrStr[I] - '0');
-        Result += HexToDec << (4 * (Length - I - 1));
+        close(Stream->FileFd);
     }
     
-    return Result;
+    cs_close(&Stream->Handle);
+    free(Stream->ChunkRows);
+    free(Stream->ChunkFirstRow);
+    memset(Stream, 0, sizeof(disasm_stream));
+    Stream->FileFd = -1;
 }
 
 static void
-DebugeeBuildBacktrace(debugee *Debugee)
+DisasmStreamCountRows(u32 FromChunk)
 {
-    if(Debuger.Unwind.FuncList.Head)
+    disasm_stream *Stream = &DisasmStream;
+    if(FromChunk == 0)
     {
-        unwind_functions_bucket *Bucket = Debuger.Unwind.FuncList.Head;
+        Stream->ChunkFirstRow[0] = 0;
+    }
+    
+    for(u32 I = FromChunk; I < Stream->ChunksCount; I++)
+    {
+        Stream->ChunkFirstRow[I + 1] = Stream->ChunkFirstRow[I] + Stream->ChunkRows[I];
+    }
+    Stream->RowsCount = Stream->ChunkFirstRow[Stream->ChunksCount];
+}
 
-        while(Bucket)
+static disasm_chunk *
+DisasmStreamFindChunk(u32 Index)
+{
+    for(u32 I = 0; I < DISASM_RESIDENT_CHUNKS; I++)
+    {
+        disasm_chunk *Chunk = &DisasmStream.Resident[I];
+        if(Chunk->Valid && Chunk->Index == Index)
         {
-            unwind_functions_bucket *ToDelete = Bucket;
-            Bucket = Bucket->Next;
-
-            free(ToDelete);
+            return Chunk;
         }
-        Debuger.Unwind.FuncList.Head = 0x0;
     }
     
-    unw_context_t UnwindCtx = {};
-    unw_getcontext(&UnwindCtx);
-    unw_addr_space_t UnwindAddressSpace = unw_create_addr_space(&_UPT_accessors, __LITTLE_ENDIAN);
-    assert(UnwindAddressSpace);
-    
-    unw_cursor_t UnwindCursor = {};
-    assert(unw_init_remote(&UnwindCursor, UnwindAddressSpace, Debuger.UnwindRemoteArg) == 0);
+    return 0x0;
+}
 
-    Debuger.Unwind.Address = DebugeeGetProgramCounter(Debugee);
+static disasm_inst *
+DisasmChunkPushInst(disasm_chunk *Chunk)
+{
+    if(Chunk->InstsCount == Chunk->InstsMax)
+    {
+        Chunk->InstsMax = Chunk->InstsMax ? Chunk->InstsMax * 2 : DISASM_ESTIMATED_ROWS;
+        Chunk->Insts = (disasm_inst *)realloc(Chunk->Insts, Chunk->InstsMax * sizeof(disasm_inst));
+    }
     
-    di_function *Func = DwarfFindFunctionByAddress(DebugeeGetProgramCounter(Debugee));
-    if(!Func) { return; }
-
-    unwind_functions_bucket *Bucket = (unwind_functions_bucket *)calloc(1, sizeof(unwind_functions_bucket));
+    disasm_inst *Result = &Chunk->Insts[Chunk->InstsCount++];
+    memset(Result, 0, sizeof(disasm_inst));
+    
+    return Result;
+}
 
-    if(!Gui->Transient.FuncRepresentation)
+static size_t
+DisasmStreamReadCode(size_t Address, u8 *Buffer, size_t Size)
+{
+    disasm_stream *Stream = &DisasmStream;
+    if(Stream->FileFd != -1)
     {
-        GuiBuildFunctionRepresentation();
+        ssize_t Read = pread(Stream->FileFd, Buffer, Size, Address - Stream->FileDelta);
+        return Read > 0 ? Read : 0;
     }
     
-    unwind_function UnwoundFunction = 0x0;
-    for(u32 I = 0; I < Gui->Transient.FuncRepresentationCount; I++)
+    size_t Read = DebugeeReadMemory(&Debugee, Address, Buffer, Size);
+    for(u32 I = 0; I < BreakpointCount; I++)
     {
-        if(Gui->Transient.FuncRepresentation[I].ActualFunction == Func)
+        breakpoint *BP = &Breakpoints[I];
+        if(BreakpointEnabled(BP) && BP->Address >= Address && BP->Address < Address + Read)
         {
-            UnwoundFunction = &Gui->Transient.FuncRepresentation[I];
+            Buffer[BP->Address - Address] = (u8)(BP->SavedOpCodes & 0xff);
         }
     }
-    assert(UnwoundFunction);
-    Bucket->Functions[Bucket->Count++] = UnwoundFunction;
     
-    while(unw_step(&UnwindCursor) > 0)
-    {
-        unw_word_t StackPointer = 0x0;
-        unw_get_reg(&UnwindCursor, UNW_REG_SP, &StackPointer);
-        size_t ReturnAddress = DebugeePeekMemory(Debugee, StackPointer - 8);
-
-        di_function *Func = DwarfFindFunctionByAddress(ReturnAddress);
-        if(!Func) { break; }
+    return Read;
+}
 
-        unwind_function UnwoundFunction = 0x0;
-        for(u32 I = 0; I < Gui->Transient.FuncRepresentationCount; I++)
+// NOTE(mateusz): An instruction that crosses the end of a chunk belongs to it, the next
+// chunk starts where that instruction ends when the previous chunk is resident. Chunks
+// decoded from a guessed start are decoded again once the previous one is known.
+static void
+DisasmStreamDecode(disasm_chunk *Chunk, u32 Index)
+{
+    disasm_stream *Stream = &DisasmStream;
+    size_t Start = Stream->Range.Start + (size_t)Index * DISASM_CHUNK_SIZE;
+    size_t End = MIN(Start + DISASM_CHUNK_SIZE, Stream->Range.End);
+    
+    disasm_chunk *Prev = Index > 0 ? DisasmStreamFindChunk(Index - 1) : 0x0;
+    if(Prev && Prev->DecodedEnd > Start)
+    {
+        Start = MIN(Prev->DecodedEnd, End);
+    }
+    
+    // Longest x86 instruction is 15 bytes
+    u8 Buffer[DISASM_CHUNK_SIZE + 16] = {};
+    size_t BufferSize = MIN(End - Start + 15, Stream->Range.End - Start);
+    size_t Read = DisasmStreamReadCode(Start, Buffer, BufferSize);
+    
+    ArenaClear(&Chunk->Arena);
+    Chunk->Valid = true;
+    Chunk->Index = Index;
+    Chunk->Start = Start;
+    Chunk->InstsCount = 0;
+    
+    const u8 *Code = Buffer;
+    size_t CodeSize = Read;
+    u64 Address = Start;
+    di_function *LastTarget = 0x0;
+    cs_insn *Instruction = cs_malloc(Stream->Handle);
+    while(Address < End)
+    {
+        if(CodeSize == 0)
         {
-            if(Gui->Transient.FuncRepresentation[I].ActualFunction == Func)
-            {
-                UnwoundFunction = &Gui->Transient.FuncRepresentation[I];
-            }
+            disasm_inst *Inst = DisasmChunkPushInst(Chunk);
+            Inst->Address = Address;
+            Inst->Mnemonic = "??";
+            Inst->Padding = "";
+            Inst->Operation = "";
+            Address = End;
         }
-        assert(UnwoundFunction);
-
-        if(Bucket->Count >= ARRAY_LENGTH(Bucket->Functions))
+        else if(cs_disasm_iter(Stream->Handle, &Code, &CodeSize, &Address, Instruction))
         {
-            SLL_QUEUE_PUSH(Debuger.Unwind.FuncList.Head, Debuger.Unwind.FuncList.Tail, Bucket);
-            Bucket = (unwind_functions_bucket *)calloc(1, sizeof(unwind_functions_bucket));
+            DisassembleFillInst(DisasmChunkPushInst(Chunk), Instruction, &Chunk->Arena, &LastTarget);
         }
-        
-        Bucket->Functions[Bucket->Count++] = UnwoundFunction;
-    } 
-
-    SLL_QUEUE_PUSH(Debuger.Unwind.FuncList.Head, Debuger.Unwind.FuncList.Tail, Bucket);
+        else
+        {
+            // Bytes that aren't an instruction take a row each, like in objdump
+            disasm_inst *Inst = DisasmChunkPushInst(Chunk);
+            Inst->Address = Address;
+            Inst->Mnemonic = "(bad)";
+            Inst->Padding = Gui->SpacesArray[6];
+            Inst->Operation = "";
+            Code++;
+            CodeSize--;
+            Address++;
+        }
+    }
+    cs_free(Instruction, 1);
+    Chunk->DecodedEnd = Address;
+    
+    disasm_chunk *Next = DisasmStreamFindChunk(Index + 1);
+    if(Next && Next->Start != Chunk->DecodedEnd)
+    {
+        Next->Valid = false;
+    }
+    
+    if(Stream->ChunkRows[Index] != Chunk->InstsCount)
+    {
+        Stream->ChunkRows[Index] = Chunk->InstsCount;
+        DisasmStreamCountRows(Index);
+    }
 }
 
-static void
-DisassembleAroundAddress(address_range AddrRange)
+static disasm_chunk *
+DisasmStreamGetChunk(u32 Index)
 {
-    LOG_MAIN("AddrRange = %lx - %lx\n", AddrRange.Start, AddrRange.End);
-    u32 InstCount = 0;
-    cs_option(DisAsmHandle, CS_OPT_DETAIL, CS_OPT_OFF); 
-
-    cs_insn *Instruction = {};
-    size_t InstructionAddress = AddrRange.Start;
-    while(InstructionAddress < AddrRange.End)
+    disasm_stream *Stream = &DisasmStream;
+    disasm_chunk *Chunk = DisasmStreamFindChunk(Index);
+    if(!Chunk)
     {
-        u8 InstrInMemory[16] = {};
-        DebugeePeekMemoryArray(&Debugee, InstructionAddress, AddrRange.End, InstrInMemory, sizeof(InstrInMemory));
-        
+        // The least recently drawn chunk is evicted
+        Chunk = &Stream->Resident[0];
+        for(u32 I = 0; I < DISASM_RESIDENT_CHUNKS && Chunk->Valid; I++)
         {
-            breakpoint *BP = 0x0; ;
-            if((BP = BreakpointFind(InstructionAddress)) && BreakpointEnabled(BP))
+            disasm_chunk *Resident = &Stream->Resident[I];
+            if(!Resident->Valid || Resident->LastUsed < Chunk->LastUsed)
             {
-                InstrInMemory[0] = (u8)(BP->SavedOpCodes & 0xff);
+                Chunk = Resident;
             }
         }
         
-        int Count = cs_disasm(DisAsmHandle, InstrInMemory, sizeof(InstrInMemory),
-                              InstructionAddress, 1, &Instruction);
-        
-        if(Count == 0) { break; }
+        DisasmStreamDecode(Chunk, Index);
+    }
+    
+    Chunk->LastUsed = ++Stream->UseCounter;
+    return Chunk;
+}
 
-        InstCount++;
-        InstructionAddress += Instruction->size;
-        
-        cs_free(Instruction, 1);
+static u32
+DisasmStreamChunkOfRow(u32 Row)
+{
+    disasm_stream *Stream = &DisasmStream;
+    u32 Low = 0;
+    u32 High = Stream->ChunksCount;
+    while(High - Low > 1)
+    {
+        u32 Middle = Low + (High - Low) / 2;
+        if(Stream->ChunkFirstRow[Middle] <= Row)
+        {
+            Low = Middle;
+        }
+        else
+        {
+            High = Middle;
+        }
     }
-    cs_option(DisAsmHandle, CS_OPT_DETAIL, CS_OPT_ON);
+    
+    return Low;
+}
 
-    DisasmInstCount = 0;
+// NOTE(mateusz): Rows past the instructions of a chunk are there only when the chunk
+// had more rows estimated than it decoded to, they are drawn empty for one frame.
+static disasm_inst *
+DisasmStreamGetRow(u32 Row)
+{
+    u32 Index = DisasmStreamChunkOfRow(Row);
+    disasm_chunk *Chunk = DisasmStreamGetChunk(Index);
+    u32 InChunk = Row - DisasmStream.ChunkFirstRow[Index];
     
-    InstructionAddress = AddrRange.Start;
-    ArenaClear(&DisasmArena);
-    DisasmInst = ArrayPush(&DisasmArena, disasm_inst, InstCount);
-    for(u32 I = 0; I < InstCount; I++)
+    return InChunk < Chunk->InstsCount ? &Chunk->Insts[InChunk] : 0x0;
+}
+
+static i32
+DisasmStreamFindRow(size_t Address)
+{
+    disasm_stream *Stream = &DisasmStream;
+    if(Address < Stream->Range.Start || Address >= Stream->Range.End)
     {
-        u8 InstrInMemory[16] = {};
-        DebugeePeekMemoryArray(&Debugee, InstructionAddress, AddrRange.End, InstrInMemory, sizeof(InstrInMemory));
-        
+        return -1;
+    }
+    
+    u32 Index = (u32)((Address - Stream->Range.Start) / DISASM_CHUNK_SIZE);
+    disasm_chunk *Chunk = DisasmStreamGetChunk(Index);
+    for(u32 I = 0; I < Chunk->InstsCount; I++)
+    {
+        if(Chunk->Insts[I].Address >= Address)
         {
-            breakpoint *BP = 0x0; ;
-            if((BP = BreakpointFind(InstructionAddress)) && BreakpointEnabled(BP))
-            {
-                InstrInMemory[0] = (u8)(BP->SavedOpCodes & 0xff);
-            }
+            return Stream->ChunkFirstRow[Index] + I;
         }
-        
-        int Count = cs_disasm(DisAsmHandle, InstrInMemory, sizeof(InstrInMemory),
-                              InstructionAddress, 1, &Instruction);
-        
-        if(Count == 0) { break; }
-        
-        DisasmInst[I].Address = InstructionAddress;
-        InstructionAddress += Instruction->size;
-        
-        DisasmInst[I].Mnemonic = StringDuplicate(&DisasmArena, Instruction->mnemonic);
-        DisasmInst[I].Operation = StringDuplicate(&DisasmArena, Instruction->op_str);
-        DisasmInstCount++;
-        
-        cs_free(Instruction, 1);
     }
+    
+    // Past the last instruction the chunk decoded to
+    return Stream->ChunkFirstRow[Index] + (Chunk->InstsCount ? Chunk->InstsCount - 1 : 0);
 }
 
 static dbg
@@ -712,14 +2617,33 @@ DebugerUpdateTransient(dbg *Debuger)
     (void)(Debuger);
     Debugee.Regs = DebugeePeekRegisters(&Debugee);
     DebugeePeekXSave(&Debugee);
+    DwarfSelectModuleByAddress(DebugeeGetProgramCounter(&Debugee));
+    
+    // NOTE(mateusz): The image is mapped again only when the file mappings changed
+    // (a library was loaded or unloaded), never because a read missed it.
+    u32 Generation = DwarfModulesGeneration();
+    if(Debugee.Flags.ImageStale || Debugee.ImageGeneration != Generation)
+    {
+        Debugee.ImageGeneration = Generation;
+        DebugeeMapImage(&Debugee);
+    }
     
     di_function *Func = DwarfFindFunctionByAddress(DebugeeGetProgramCounter(&Debugee));
     if(Func)
     {
-        assert(Func->FuncLexScope.RangesCount == 0);
+        // A function split into parts is disassembled around the part the debugee is in
+        di_lexical_scope *LexScope = &Func->FuncLexScope;
         address_range LexScopeRange = {};
-        LexScopeRange.Start = Func->FuncLexScope.LowPC;
-        LexScopeRange.End = Func->FuncLexScope.HighPC;
+        LexScopeRange.Start = LexScope->LowPC;
+        LexScopeRange.End = LexScope->HighPC;
+        for(u32 I = 0; I < LexScope->RangesCount; I++)
+        {
+            if(AddressBetween(DebugeeGetProgramCounter(&Debugee), LexScope->RangesLowPCs[I], LexScope->RangesHighPCs[I]))
+            {
+                LexScopeRange.Start = LexScope->RangesLowPCs[I];
+                LexScopeRange.End = LexScope->RangesHighPCs[I];
+            }
+        }
         LOG_MAIN("LexScope of %s is %lx-%lx\n", Func->Name, LexScopeRange.Start, LexScopeRange.End);
         
         DisassembleAroundAddress(LexScopeRange);
@@ -737,6 +2661,20 @@ DebugerDeallocTransient(dbg *Debuger)
 #endif
 
     _UPT_destroy(Debuger->UnwindRemoteArg);
+    Debuger->UnwindRemoteArg = 0x0;
+
+    if(Debugee.MemoryFD != -1)
+    {
+        close(Debugee.MemoryFD);
+        Debugee.MemoryFD = -1;
+    }
+    DebugeeUnmapImage(&Debugee);
+    Debugee.ImageRejectedCount = 0;
+    // Interrupts that were sent to the process that is gone
+    __atomic_store_n(&Tracer.InterruptStops, 0, __ATOMIC_RELEASE);
+
+    // The stream reads the module files of this session
+    DisasmStreamClose();
     
     ArenaDestroy(&Debugee.Arena);
 
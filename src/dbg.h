@@ -1,6 +1,10 @@
 #ifndef DBG_H
 #define DBG_H
 
+struct disasm_inst;
+struct disasm_chunk;
+struct disasm_line_run;
+
 union x64_registers
 {
     struct
@@ -24,13 +28,27 @@ struct logging_switches
     bool LangLogs;
 };
 struct function_representation;
+struct di_inlined_call;
+struct di_function;
 
 typedef function_representation* unwind_function;
 
+// NOTE(mateusz): Calls inlined into a function get virtual frames, Inlined is set
+// for them and Function is the function they were inlined into. Frames of code
+// without DWARF only have the ELF Symbol they are in.
+struct unwind_frame
+{
+    unwind_function Function;
+    di_inlined_call *Inlined;
+    size_t CFA;
+    char *Symbol;
+    size_t SymbolOffset;
+};
+
 struct unwind_functions_bucket
 {
     unwind_functions_bucket *Next;
-    unwind_function Functions[8];
+    unwind_frame Frames[8];
     u32 Count;
 };
 
@@ -40,16 +58,43 @@ struct unwind_functions_list
     u32 Count;
 };
 
+// NOTE(mateusz): Upper bound on the lines stepped over to get out of inlined calls
+#define MAX_INLINED_STEPS 1024
+
 struct debugee_flags
 {
     u8 Running  : 1;
     u8 Steped   : 1;
     u8 PIE      : 1;
+    u8 Attached : 1;
+    u8 ImageStale : 1;
+    u8 JobStopped : 1;
+};
+
+struct debugee_thread_flags
+{
+    u8 Stopped        : 1;
+    u8 RegsValid      : 1;
+    u8 Starting       : 1;
+    u8 SigStopPending : 1;
+    u8 Exited         : 1;
 };
 
+// NOTE(mateusz): Registers of a thread are only fetched when somebody asks for
+// them, a stop of a process with hundreds of threads only reads the current one.
+struct debugee_thread
+{
+    i32 TID;
+    debugee_thread_flags Flags;
+    i32 PendingSignal;
+    i32 LastRequest;
+    x64_registers Regs;
+};
+
+#define MAX_DEBUGEE_THREADS 1024
+
 struct unwind_info
 {
-    size_t Address;
     unwind_functions_list FuncList;
 };
 
@@ -71,14 +116,58 @@ struct cpu_registers_enabled_flags
     // u8 EnabledAVX512 : 1;
 };
 
+struct memory_region
+{
+    size_t Start;
+    size_t End;
+    size_t Offset;
+    u8 Readable : 1;
+    u8 Writable : 1;
+    u8 Executable : 1;
+};
+
+#define MAX_MEMORY_REGIONS 1024
+
+// NOTE(mateusz): A read only mapping of a file in the debugee, mapped from the same
+// file into the debuger. Reads from it don't need the debugee at all.
+struct image_mapping
+{
+    size_t Start;
+    size_t End;
+    size_t Offset;
+    u64 Inode;
+    u8 *Bytes;
+};
+
+#define MAX_IMAGE_MAPPINGS 512
+
+// NOTE(mateusz): Mappings that can't come from their file (written to, text relocations,
+// replaced on the disk), remembered so the file is not opened again on every refresh.
+struct image_rejected
+{
+    u64 Inode;
+    size_t Offset;
+};
+
 struct debugee
 {
     arena Arena;
     debugee_flags Flags;
     i32 PID;
+    i32 TID;
+    i32 MemoryFD;
     char ProgramPath[PATH_MAX];
     size_t LoadAddress;
 
+    debugee_thread *Threads;
+    u32 ThreadCount;
+
+    image_mapping *Image;
+    u32 ImageCount;
+    u32 ImageGeneration;
+    image_rejected *ImageRejected;
+    u32 ImageRejectedCount;
+
     x64_registers Regs;
     u8 *XSaveBuffer;
     u32 XSaveSize;
@@ -89,6 +178,8 @@ struct debugee
 struct dbg
 {
     bool InputChange;
+    bool NonStop;
+    i32 AttachPID;
     char ProgramArgs[128];
     char PathToRunIn[PATH_MAX];
 
@@ -102,12 +193,131 @@ struct dbg
 
 dbg Debuger;
 
+enum
+{
+    TRACER_CMD_NULL,
+    TRACER_CMD_CONTINUE_OR_START,
+    TRACER_CMD_RESTART,
+    TRACER_CMD_STEP_OUT,
+    TRACER_CMD_NEXT_LINE,
+    TRACER_CMD_STEP_LINE,
+    TRACER_CMD_NEXT_INSTRUCTION,
+    TRACER_CMD_STEP_INSTRUCTION,
+    TRACER_CMD_RUN_TO_ADDRESS,
+    TRACER_CMD_SET_NEXT_STATEMENT,
+    TRACER_CMD_STEP_LINES,
+    TRACER_CMD_BREAK_AT_ADDRESS,
+    TRACER_CMD_BREAK_AT_FUNCTION,
+    TRACER_CMD_TOGGLE_SOURCE_LINE,
+    TRACER_CMD_SELECT_THREAD,
+    TRACER_CMD_ATTACH,
+    TRACER_CMD_DETACH,
+    TRACER_CMD_QUIT,
+};
+
+typedef u8 tracer_command_type;
+
+struct tracer_command
+{
+    tracer_command_type Type;
+    size_t Address;
+    u32 SrcFileIndex;
+    u32 LineNum;
+    u32 Count;
+    i32 ThreadID;
+    i32 ProcessID;
+    char Text[128];
+};
+
+enum
+{
+    STOP_REASON_NONE,
+    STOP_REASON_TRAP,
+    STOP_REASON_INTERRUPTED,
+    STOP_REASON_SIGNAL,
+    STOP_REASON_EXITED,
+    STOP_REASON_SEGFAULT,
+    STOP_REASON_ABORTED,
+    STOP_REASON_NO_PROGRAM_PATH,
+    STOP_REASON_NO_PROGRAM_FILE,
+    STOP_REASON_ATTACHED,
+    STOP_REASON_ATTACH_FAILED,
+    STOP_REASON_DETACHED,
+    STOP_REASON_STEPPED,
+    STOP_REASON_NO_FRAME_INFO,
+};
+
+typedef u8 stop_reason;
+
+// NOTE(mateusz): What the GUI gets to see after the tracer is done with a command.
+// NOTE(mateusz): Upper bound on the frames unwound on a stop
+#define MAX_UNWIND_FRAMES 128
+
+// NOTE(mateusz): The tracer only unwinds the raw frames, the GUI thread turns
+// them into the backtrace after it consumes the snapshot.
+struct stop_snapshot
+{
+    x64_registers Regs;
+    size_t PC;
+    i32 TID;
+    stop_reason Reason;
+    i32 Signal;
+    bool Running;
+    u32 Steps;
+    f64 StepsPerSecond;
+    size_t FramePCs[MAX_UNWIND_FRAMES];
+    size_t FrameCFAs[MAX_UNWIND_FRAMES];
+    u32 FrameCount;
+};
+
+#define TRACER_QUEUE_SIZE 16
+
+// NOTE(mateusz): The queue is a single producer (GUI thread) and single consumer
+// (tracer thread) ring, QueueWrite is only stored by the producer and QueueRead
+// only by the consumer so no locks are needed. The semaphore is only used to put
+// the tracer to sleep while there is nothing to do, the condition variable to put
+// the GUI to sleep while it waits for the tracer.
+struct tracer
+{
+    pthread_t Thread;
+    sem_t Wakeup;
+    pthread_mutex_t IdleLock;
+    pthread_cond_t Idle;
+
+    tracer_command Queue[TRACER_QUEUE_SIZE];
+    u32 QueueRead;
+    u32 QueueWrite;
+    u32 Executing;
+    u32 InterruptRequested;
+    // NOTE(mateusz): SIGSTOPs sent by TracerInterrupt that were not seen yet, only
+    // these (and the ones of DebugeeStopAllThreads) are swallowed.
+    u32 InterruptStops;
+
+    stop_reason StopReason;
+    i32 StopSignal;
+    u32 Steps;
+    f64 StepsPerSecond;
+    // Read by the GUI after TracerWaitIdle
+    u32 BreakpointsDropped;
+
+    stop_snapshot Snapshot;
+    u32 SnapshotPublished;
+    u32 SnapshotConsumed;
+};
+
+tracer Tracer;
+
 /*
  * Flow Control for Debugee
  */
 static debugee          DebugeeCreate(debugee *Debugee);
 static void             DebugeeStart(debugee *Debugee);
 static void             DebugeeKill(debugee *Debugee);
+static void             DebugeeAttach(debugee *Debugee, i32 PID);
+static bool             DebugeeSeizeThreads(debugee *Debugee, i32 PID);
+static void             DebugeeReleaseThreads(debugee *Debugee);
+static char             DebugeeProcessState(i32 PID);
+static void             DebugeeDetach(debugee *Debugee);
 static void             DebugeeContinueOrStart(debugee *Debugee);
 static void             DebugeeRestart(debugee *Debugee);
 static void             DebugeeWaitForSignal(debugee *Debugee);
@@ -116,6 +326,42 @@ static void             DebugeeStepInstruction(debugee *Debugee);
 static void             DebugeeToNextInstruction(debugee *Debugee, bool StepIntoFunctions);
 static void             DebugeeContinueProgram(debugee *Debugee);
 static void             DebugeeStepOutOfFunction(debugee *Debugee);
+static void             DebugeeRunToAddress(debugee *Debugee, size_t Address);
+static void             DebugeeSetNextStatement(debugee *Debugee, size_t Address);
+static void             DebugeeStepLines(debugee *Debugee, u32 Count, char *Condition);
+
+/*
+ * Threads of the Debugee
+ */
+static debugee_thread * DebugeeThreadFind(debugee *Debugee, i32 TID);
+static debugee_thread * DebugeeThreadAdd(debugee *Debugee, i32 TID);
+static void             DebugeeThreadsCompact(debugee *Debugee);
+static debugee_thread * DebugeeCurrentThread(debugee *Debugee);
+static x64_registers    DebugeeThreadGetRegisters(debugee_thread *Thread);
+static void             DebugeeThreadResume(debugee_thread *Thread, i32 Request);
+static void             DebugeeThreadRewindBreakpoint(debugee_thread *Thread);
+static void             DebugeeThreadSwitch(debugee *Debugee, i32 TID);
+static void             DebugeeStopAllThreads(debugee *Debugee);
+static void             DebugeeResumeOtherThreads(debugee *Debugee);
+
+/*
+ * Tracer thread, the only thread allowed to issue ptrace requests
+ */
+static void             TracerCreate();
+static void             TracerDestroy();
+static void *           TracerMain(void *Arg);
+static bool             TracerPush(tracer_command Cmd);
+static bool             TracerPush(tracer_command_type Type);
+static bool             TracerPop(tracer_command *Cmd);
+static void             TracerExecute(tracer_command *Cmd);
+static void             TracerPublishStop();
+static void             TracerSignalIdle();
+static bool             TracerBusy();
+static void             TracerWaitIdle();
+static void             TracerInterrupt();
+static bool             TracerInterrupted();
+static bool             TracerConsumeInterruptStop();
+static bool             TracerConsumeSnapshot(stop_snapshot *Snapshot);
 
 /*
  * I/O with Debugee
@@ -124,21 +370,54 @@ static x64_registers    DebugeePeekRegisters(debugee *Debugee);
 static void             DebugeePeekXSave(debugee *Debugee);
 static void             DebugeeSetRegisters(debugee *Debugee, x64_registers Regs);
 static size_t           DebugeeGetProgramCounter(debugee *Debugee);
-static size_t           DebugeeGetReturnAddress(debugee *Debugee, size_t Address);
+static bool             DebugeeGetReturnAddress(debugee *Debugee, size_t Address, size_t *Result);
 static void             DebugeePokeMemory(debugee *Debugee, size_t Address, size_t MachineWord);
 static size_t           DebugeePeekMemory(debugee *Debugee, size_t Address);
-static void             DebugeePeekMemoryArray(debugee *Debugee, size_t StartAddress, u32 EndAddress, u8 *OutArray, u32 BytesToRead);
+static void             DebugeePeekMemoryArray(debugee *Debugee, size_t StartAddress, size_t EndAddress, u8 *OutArray, u32 BytesToRead);
+static size_t           DebugeeReadMemory(debugee *Debugee, size_t Address, u8 *OutArray, size_t BytesToRead);
 static size_t           DebugeeGetLoadAddress(debugee *Debugee);
+static u32              DebugeeGetMemoryRegions(debugee *Debugee, memory_region *Regions, u32 MaxRegions, bool *Truncated = 0x0);
+static bool             DebugeeImageReadOnly(i32 Fd, size_t Offset, size_t Size);
+static bool             DebugeeImageRejected(debugee *Debugee, image_mapping *Mapping);
+static void             DebugeeMapImage(debugee *Debugee);
+static void             DebugeeUnmapImage(debugee *Debugee);
+static image_mapping *  DebugeeFindImageMapping(debugee *Debugee, size_t Address);
 
 /*
  * Caching Debugee information
  */
-static void             DebugeeBuildBacktrace(debugee *Debugee);
+static void             DebugeeUnwindStack(debugee *Debugee, stop_snapshot *Snapshot);
+static void             DebugeeBuildBacktrace(stop_snapshot *Snapshot);
+static void             DebugeeBacktracePushFrames(unwind_functions_bucket **Bucket, di_function *Func, size_t Address, size_t CFA);
+static bool             DebugeeBacktracePushAddress(unwind_functions_bucket **Bucket, size_t Address, size_t CFA);
+static unwind_frame *   DebugeeBacktraceNextFrame(unwind_functions_bucket **Bucket);
 
 /*
  * Caching Debugee information
  */
 static void DisassembleAroundAddress(address_range AddrRange);
+static void DisassembleFillInst(disasm_inst *Inst, cs_insn *Instruction, arena *Arena, di_function **LastTarget);
+static char *DisassembleAnnotateOperation(cs_insn *Instruction, arena *Arena, di_function **LastTarget);
+static void DisassembleMapLines();
+static u32  DisasmLineHash(u32 SrcFileIndex, u32 LineNum);
+static disasm_line_run *DisasmFindLineRun(u32 SrcFileIndex, u32 LineNum);
+static i32  DisasmFindInstByAddress(size_t Address);
+
+/*
+ * Streamed disassembly
+ */
+static bool             DisasmStreamOpen(address_range Range);
+static bool             DisasmStreamOpenSection(size_t Address, char *Name);
+static void             DisasmStreamClose();
+static void             DisasmStreamCountRows(u32 FromChunk);
+static disasm_chunk *   DisasmStreamFindChunk(u32 Index);
+static disasm_inst *    DisasmChunkPushInst(disasm_chunk *Chunk);
+static size_t           DisasmStreamReadCode(size_t Address, u8 *Buffer, size_t Size);
+static void             DisasmStreamDecode(disasm_chunk *Chunk, u32 Index);
+static disasm_chunk *   DisasmStreamGetChunk(u32 Index);
+static u32              DisasmStreamChunkOfRow(u32 Row);
+static disasm_inst *    DisasmStreamGetRow(u32 Row);
+static i32              DisasmStreamFindRow(size_t Address);
 
 /*
  * Debuger related functions
@@ -9,19 +9,30 @@
 #include <sys/user.h>
 #include <sys/stat.h>
 #include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
 #include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
 #include <stdint.h>
 #include <err.h>
+#include <errno.h>
 #include <cctype>
+#include <cmath>
 #include <linux/limits.h>
 
 #include <cpuid.h>
+#include <immintrin.h>
 
 #include <GLFW/glfw3.h>
 #include <capstone/capstone.h>
 #include <libdwarf/dwarf.h>
 #include <libdwarf/libdwarf.h>
 #include <libelf.h>
+#include <zlib.h>
+#include <zstd.h>
 #include <libunwind-ptrace.h>
 
 #include <libs/imgui/imgui.h>
@@ -114,6 +125,35 @@ WindowSizeCallback(GLFWwindow* Window, i32 Width, i32 Height)
     
     Gui->WindowWidth = Width;
     Gui->WindowHeight = Height;
+
+    Debuger.InputChange = true;
+}
+
+static void
+WindowRefreshCallback(GLFWwindow *Window)
+{
+    (void)Window;
+
+    Debuger.InputChange = true;
+}
+
+static void
+ScrollCallback(GLFWwindow *Window, double X, double Y)
+{
+    (void)Window;
+    (void)X;
+    (void)Y;
+
+    Debuger.InputChange = true;
+}
+
+static void
+CharCallback(GLFWwindow *Window, unsigned int Codepoint)
+{
+    (void)Window;
+    (void)Codepoint;
+
+    Debuger.InputChange = true;
 }
 
 static void
@@ -795,6 +835,7 @@ DebagMain()
 
     Debuger = DebugerCreate();
     Debugee = DebugeeCreate();
+    TracerCreate();
     
     glfwInit();
     GLFWwindow *Window = glfwCreateWindow(Gui->WindowWidth, Gui->WindowHeight, "debag", NULL, NULL);
@@ -805,6 +846,10 @@ DebagMain()
     glfwSetMouseButtonCallback(Window, MouseButtonCallback);
     glfwSetCursorPosCallback(Window, MousePositionCallback);
     glfwSetWindowSizeCallback(Window, WindowSizeCallback);
+    glfwSetWindowRefreshCallback(Window, WindowRefreshCallback);
+    // NOTE(mateusz): Have to be set before ImGui installs its own, it chains them
+    glfwSetScrollCallback(Window, ScrollCallback);
+    glfwSetCharCallback(Window, CharCallback);
     
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -853,14 +898,84 @@ DebagMain()
 
     bool CenteredDissassembly = false;
     bool CenteredSourceCode = false;
+    stop_snapshot Stop = {};
+    bool WasTracerIdle = true;
+    u32 FramesToDraw = DEBAG_REDRAW_FRAMES;
+    f64 LastDrawTime = 0.0;
     
     while(!glfwWindowShouldClose(Window))
     {
-        //if(!Debuger.InputChange) { goto EndDraw; }
-        //else { Debuger.InputChange = false; }
+        // NOTE(mateusz): With nothing left to draw sleep until GLFW gets an event,
+        // the tracer thread posts an empty one after it is done with a command.
+        if(FramesToDraw == 0)
+        {
+            glfwWaitEventsTimeout(DEBAG_IDLE_WAIT_SECONDS);
+        }
+        else
+        {
+            glfwPollEvents();
+        }
+
+        // NOTE(mateusz): While the tracer thread is working on a command it owns
+        // all of the debugee state, the GUI only touches it once the tracer is idle.
+        bool TracerIdle = !TracerBusy();
+        i32 LastStopTID = Stop.TID;
+        size_t LastStopPC = Stop.PC;
+        if(TracerIdle && TracerConsumeSnapshot(&Stop))
+        {
+            GuiSetStatusFromStop(&Stop);
+            DebugeeBuildBacktrace(&Stop);
+            Debuger.InputChange = true;
+
+            // Another thread means other frames even if the PC is the same
+            if(Stop.TID != LastStopTID)
+            {
+                Gui->Transient.LocalsBuildAddress = 0x0;
+                Gui->Transient.WatchBuildAddress = 0x0;
+                Gui->Transient.VariableCnt = 0;
+            }
+
+            // NOTE(mateusz): Commands that did not run the debugee (breakpoints,
+            // picking a thread) publish a stop too, those keep the changed values.
+            if(Stop.Reason != STOP_REASON_NONE || Stop.PC != LastStopPC || Stop.TID != LastStopTID)
+            {
+                Gui->Transient.VarsSequence += 1;
+            }
+        }
+        if(TracerIdle != WasTracerIdle)
+        {
+            WasTracerIdle = TracerIdle;
+            Debuger.InputChange = true;
+        }
+
+        // Keep the text cursor blinking while typing
+        f64 Now = glfwGetTime();
+        if(IO.WantTextInput && Now - LastDrawTime >= DEBAG_IDLE_WAIT_SECONDS)
+        {
+            Debuger.InputChange = true;
+        }
+
+        // NOTE(mateusz): ImGui needs a couple of frames to settle after something
+        // changed (popups, layout, scrolling to the current line).
+        if(Debuger.InputChange)
+        {
+            Debuger.InputChange = false;
+            FramesToDraw = DEBAG_REDRAW_FRAMES;
+        }
+
+        if(FramesToDraw == 0)
+        {
+            continue;
+        }
+
+        FramesToDraw -= 1;
+        LastDrawTime = Now;
+        ButtonsUpdate(KeyboardButtons, (sizeof(KeyboardButtons)/sizeof(KeyboardButtons[0])));
+
+        bool DebugeeStopped = TracerIdle && Stop.Running;
         
         // NOTE(mateusz): This has to happen before the calls to next lines
-        if(Debugee.Flags.Steped)
+        if(TracerIdle && Debugee.Flags.Steped)
         {
             if(CenteredDissassembly && CenteredSourceCode)
             {
@@ -877,11 +992,13 @@ DebagMain()
         f64 MenuBarHeight = 0.0;
         bool BreakAtFunction = false;
         bool BreakAtAddress = false;
+        bool DisassembleRange = false;
+        bool StepLines = false;
         if (ImGui::BeginMainMenuBar())
         {
             auto MenuBarSize = ImGui::GetWindowSize();
             MenuBarHeight = MenuBarSize.y;
-            bool IsRunning = Debugee.Flags.Running;
+            bool IsRunning = DebugeeStopped;
             
             if(ImGui::BeginMenu("File"))
             {
@@ -898,50 +1015,87 @@ DebagMain()
                 {
                     GuiShowOpenFile();
                 }
+
+                ImGui::Separator();
+
+                ImGui::PushItemWidth(Gui->WindowWidth * OneThird);
+                ImGui::InputInt("Process ID", &Debuger.AttachPID);
+                ImGui::PopItemWidth();
+                
+                if(ImGui::MenuItem("Attach to process", 0x0, false,
+                                   TracerIdle && !Debugee.Flags.Running && Debuger.AttachPID > 0))
+                {
+                    tracer_command Cmd = {};
+                    Cmd.Type = TRACER_CMD_ATTACH;
+                    Cmd.ProcessID = Debuger.AttachPID;
+                    TracerPush(Cmd);
+                }
+                if(ImGui::MenuItem("Detach from process", 0x0, false, IsRunning && Debugee.Flags.Attached))
+                {
+                    TracerPush(TRACER_CMD_DETACH);
+                }
                 
                 ImGui::EndMenu();
             }
             if(ImGui::BeginMenu("Control"))
             {
-                if(ImGui::MenuItem("Start process", "F5", false, !IsRunning))
+                if(ImGui::MenuItem("Start process", "F5", false, TracerIdle && !IsRunning))
                 {
-                    DebugeeContinueOrStart(&Debugee);
+                    TracerPush(TRACER_CMD_CONTINUE_OR_START);
                 }
-                if(ImGui::MenuItem("Restart process", "Shift+F5", false, IsRunning))
+                if(ImGui::MenuItem("Restart process", "Shift+F5", false, IsRunning && !Debugee.Flags.Attached))
                 {
-                    DebugeeRestart(&Debugee);
+                    TracerPush(TRACER_CMD_RESTART);
                 }
                 
                 ImGui::Separator();
                 
                 if(ImGui::MenuItem("Continue", "F5", false, IsRunning))
                 {
-                    DebugeeContinueOrStart(&Debugee);
+                    TracerPush(TRACER_CMD_CONTINUE_OR_START);
+                }
+                if(ImGui::MenuItem("Interrupt", "F6", false, !TracerIdle))
+                {
+                    TracerInterrupt();
+                }
+                ImGui::MenuItem("Non-stop threads", 0x0, &Debuger.NonStop, TracerIdle);
+                ImGui::MenuItem("Interleave source", 0x0, &Gui->DisasmInterleaved);
+                if(ImGui::MenuItem("Disassemble range", 0x0, false, IsRunning && TracerIdle))
+                {
+                    DisassembleRange = true;
+                }
+                if(ImGui::MenuItem("Disassemble .text", 0x0, false, IsRunning && TracerIdle))
+                {
+                    DisasmStreamOpenSection(Stop.PC, ".text");
+                    DisasmStream.ScrollToAddress = Stop.PC;
+                }
+                if(ImGui::MenuItem("Disassemble function", 0x0, false, DisasmStream.Active))
+                {
+                    DisasmStreamClose();
                 }
                 if(ImGui::MenuItem("Step out", "F9", false, IsRunning))
                 {
-                    DebugeeStepOutOfFunction(&Debugee);
-                    DebugerUpdateTransient(&Debuger);
+                    TracerPush(TRACER_CMD_STEP_OUT);
                 }
                 if(ImGui::MenuItem("Step next", "F10", false, IsRunning))
                 {
-                    DebugeeToNextLine(&Debugee, false);
-                    DebugerUpdateTransient(&Debuger);
+                    TracerPush(TRACER_CMD_NEXT_LINE);
                 }
                 if(ImGui::MenuItem("Step in", "F11", false, IsRunning))
                 {
-                    DebugeeToNextLine(&Debugee, true);
-                    DebugerUpdateTransient(&Debuger);
+                    TracerPush(TRACER_CMD_STEP_LINE);
                 }
                 if(ImGui::MenuItem("Next instruction", "Shift+F10", false, IsRunning))
                 {
-                    DebugeeToNextInstruction(&Debugee, false);
-                    DebugerUpdateTransient(&Debuger);
+                    TracerPush(TRACER_CMD_NEXT_INSTRUCTION);
                 }
                 if(ImGui::MenuItem("Step instruction", "Shift+F11", false, IsRunning))
                 {
-                    DebugeeToNextInstruction(&Debugee, true);
-                    DebugerUpdateTransient(&Debuger);
+                    TracerPush(TRACER_CMD_STEP_INSTRUCTION);
+                }
+                if(ImGui::MenuItem("Step over lines", "Ctrl+F10", false, IsRunning && TracerIdle))
+                {
+                    StepLines = true;
                 }
                 
                 ImGui::Separator();
@@ -987,6 +1141,11 @@ DebagMain()
 #endif
 
             ImGui::Text("(%.1f FPS)", ImGui::GetIO().Framerate);
+
+            if(!TracerIdle)
+            {
+                ImGui::TextColored(CurrentLineColor, "Running...");
+            }
             
             if(Gui->StatusText)
             {
@@ -1006,30 +1165,34 @@ DebagMain()
             ImGui::EndMainMenuBar();
         }
         
-        if(KeyboardButtons[GLFW_KEY_F5].Pressed)
+        if(KeyboardButtons[GLFW_KEY_F5].Pressed && TracerIdle)
         {
             if(KeyMods.Shift)
             {
-                DebugeeRestart(&Debugee);
+                TracerPush(TRACER_CMD_RESTART);
             }
             else
             {
-                DebugeeContinueOrStart(&Debugee);
+                TracerPush(TRACER_CMD_CONTINUE_OR_START);
             }
         }
 
-        if(Debugee.Flags.Running)
+        if(KeyboardButtons[GLFW_KEY_F6].Pressed && !TracerIdle)
+        {
+            TracerInterrupt();
+        }
+
+        if(DebugeeStopped)
         {
             bool F9 = KeyboardButtons[GLFW_KEY_F9].Pressed || KeyboardButtons[GLFW_KEY_F9].Repeat;
             
             if(F9)
             {
-                DebugeeStepOutOfFunction(&Debugee);
-                DebugerUpdateTransient(&Debuger);
+                TracerPush(TRACER_CMD_STEP_OUT);
             }
         }
         
-        if(Debugee.Flags.Running)
+        if(DebugeeStopped)
         {
             bool F10 = KeyboardButtons[GLFW_KEY_F10].Pressed || KeyboardButtons[GLFW_KEY_F10].Repeat;
             bool F11 = KeyboardButtons[GLFW_KEY_F11].Pressed || KeyboardButtons[GLFW_KEY_F11].Repeat;
@@ -1038,26 +1201,29 @@ DebagMain()
             {
                 if(F10)
                 {
-                    DebugeeToNextInstruction(&Debugee, false);
-                    DebugerUpdateTransient(&Debuger);
+                    TracerPush(TRACER_CMD_NEXT_INSTRUCTION);
                 }
                 if(F11)
                 {
-                    DebugeeToNextInstruction(&Debugee, true);
-                    DebugerUpdateTransient(&Debuger);
+                    TracerPush(TRACER_CMD_STEP_INSTRUCTION);
+                }
+            }
+            else if(KeyMods.Control && F10)
+            {
+                if(KeyboardButtons[GLFW_KEY_F10].Pressed)
+                {
+                    GuiShowStepLines();
                 }
             }
             else
             {
                 if(F10)
                 {
-                    DebugeeToNextLine(&Debugee, false);
-                    DebugerUpdateTransient(&Debuger);
+                    TracerPush(TRACER_CMD_NEXT_LINE);
                 }
                 if(F11)
                 {
-                    DebugeeToNextLine(&Debugee, true);
-                    DebugerUpdateTransient(&Debuger);
+                    TracerPush(TRACER_CMD_STEP_LINE);
                 }
             }
             
@@ -1091,58 +1257,145 @@ DebagMain()
         {
             GuiShowBreakAtAddress();
         }
+        if(DisassembleRange)
+        {
+            GuiShowDisassembleRange();
+        }
+        if(StepLines)
+        {
+            GuiShowStepLines();
+        }
 
-        if(Gui->ModalFuncShow)
+        if(Gui->ModalFuncShow && TracerIdle)
         {
             Gui->ModalFuncShow();
         }
 
+        // NOTE(mateusz): Anything pushed above is already running on the tracer
+        TracerIdle = !TracerBusy();
+        DebugeeStopped = TracerIdle && Stop.Running;
+
         ImGui::Begin("Disassembly", 0x0, WinFlags);
 
         ImGui::SetWindowPos(ImVec2(Gui->WindowWidth / 2, MenuBarHeight));
         ImGui::SetWindowSize(ImVec2(Gui->WindowWidth / 2, (Gui->WindowHeight / 3) * 2 - MenuBarHeight));
         ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, 0));
 
-        if(Debugee.Flags.Running)
+        if(DebugeeStopped && DisasmStream.Active)
         {
+            // NOTE(mateusz): Rows are decoded only when the clipper asks for them
             ImGuiListClipper Clipper = {};
-            Clipper.Begin(DisasmInstCount);
-            size_t PC = DebugeeGetProgramCounter(&Debugee);
-
-            // @Speed: Binary search will like this one!
-            i32 PCItemIndex = -1;
-            for(u32 I = 0; I < DisasmInstCount; I++)
+            Clipper.Begin(DisasmStream.RowsCount, ImGui::GetTextLineHeight());
+            size_t PC = Stop.PC;
+            
+            if(DisasmStream.ScrollToAddress)
             {
-                if(DisasmInst[I].Address == PC)
+                i32 Row = DisasmStreamFindRow(DisasmStream.ScrollToAddress);
+                if(Row != -1)
                 {
-                    PCItemIndex = I;
-                    break;
+                    ImGui::SetScrollY(Row * ImGui::GetTextLineHeight());
+                }
+                DisasmStream.ScrollToAddress = 0x0;
+            }
+            
+            while(Clipper.Step())
+            {
+                for(int I = Clipper.DisplayStart; I < Clipper.DisplayEnd; I++)
+                {
+                    disasm_inst *Inst = DisasmStreamGetRow(I);
+                    if(!Inst)
+                    {
+                        ImGui::TextDisabled("...");
+                    }
+                    else if(Inst->Address == PC)
+                    {
+                        ImGui::TextColored(CurrentLineColor,
+                                           "0x%" PRIx64 ":\t%s%s%s\n",
+                                           Inst->Address, Inst->Mnemonic, Inst->Padding, Inst->Operation);
+                    }
+                    else
+                    {
+                        ImGui::Text("0x%" PRIx64 ":\t%s%s%s\n",
+                                    Inst->Address, Inst->Mnemonic, Inst->Padding, Inst->Operation);
+                    }
+                    
+                    if(Inst)
+                    {
+                        GuiShowCodeContextMenu(Inst->Address, PC);
+                    }
                 }
             }
+        }
+        else if(DebugeeStopped)
+        {
+            // NOTE(mateusz): The interleaved view draws rows, the plain one draws
+            // the instructions, every instruction knows its row.
+            u32 RowsCount = Gui->DisasmInterleaved ? DisasmRowsCount : DisasmInstCount;
+            ImGuiListClipper Clipper = {};
+            Clipper.Begin(RowsCount);
+            size_t PC = Stop.PC;
+
+            i32 PCItemIndex = DisasmFindInstByAddress(PC);
+            if(PCItemIndex != -1 && Gui->DisasmInterleaved)
+            {
+                PCItemIndex = DisasmInst[PCItemIndex].Row;
+            }
 
             if(Debugee.Flags.Steped && PCItemIndex != -1)
             {
                 f32 Max = ImGui::GetScrollMaxY();
-                f32 Curr = ((f32)PCItemIndex / (f32)DisasmInstCount);
+                f32 Curr = ((f32)PCItemIndex / (f32)RowsCount);
                 Curr *= Max;
 
                 ImGui::SetScrollY(Curr);
             }
 
+            disasm_line_run *ShownRun = 0x0;
+            if(Gui->DisasmShowLine)
+            {
+                ShownRun = DisasmFindLineRun(Gui->DisasmShowFileIndex, Gui->DisasmShowLineNum);
+            }
+
+            if(Gui->DisasmScrollToLine && ShownRun)
+            {
+                u32 ItemIndex = Gui->DisasmInterleaved ? ShownRun->Row : ShownRun->FirstInst;
+                f32 Max = ImGui::GetScrollMaxY();
+                f32 Curr = ((f32)ItemIndex / (f32)RowsCount);
+                Curr *= Max;
+
+                ImGui::SetScrollY(Curr);
+            }
+            Gui->DisasmScrollToLine = false;
+
             while(Clipper.Step())
             {
                 for(int I = Clipper.DisplayStart; I < Clipper.DisplayEnd; I++)
                 {
                     disasm_inst *Inst = &DisasmInst[I];
-                    u32 BaseMnemonicLength = 3; // The shortest mnenomic is of lenght 3
-                    u32 MnenomicLengthDiff = StringLength(Inst->Mnemonic) - BaseMnemonicLength;
-                    char *Spaces = Gui->SpacesArray[8 - MnenomicLengthDiff];
+                    if(Gui->DisasmInterleaved)
+                    {
+                        disasm_row *Row = &DisasmRows[I];
+                        if(Row->Line)
+                        {
+                            di_src_file *Src = &DI->SourceFiles[Row->Line->SrcFileIndex];
+                            u32 ContentIndex = Row->Line->LineNum - 1;
+                            char *Content = "";
+                            if(ContentIndex < Src->ContentLineCount)
+                            {
+                                Content = Src->Content[ContentIndex];
+                            }
+                            ImGui::TextDisabled("%5u: %s", Row->Line->LineNum, Content);
+                            continue;
+                        }
+                        
+                        Inst = &DisasmInst[Row->InstIndex];
+                    }
                 
                     if(Inst->Address == PC)
                     {
                         ImGui::TextColored(CurrentLineColor,
                                            "0x%" PRIx64 ":\t%s%s%s\n",
-                                           Inst->Address, Inst->Mnemonic, Spaces, Inst->Operation);
+                                           Inst->Address, Inst->Mnemonic, Inst->Padding, Inst->Operation);
                     
                         if(Debugee.Flags.Steped)
                         {
@@ -1150,11 +1403,20 @@ DebagMain()
                             CenteredDissassembly = true;
                         }
                     }
+                    else if(ShownRun && Inst->Line && Inst->Line->SrcFileIndex == Gui->DisasmShowFileIndex &&
+                            Inst->Line->LineNum == Gui->DisasmShowLineNum)
+                    {
+                        ImGui::TextColored(ShownLineColor,
+                                           "0x%" PRIx64 ":\t%s%s%s\n",
+                                           Inst->Address, Inst->Mnemonic, Inst->Padding, Inst->Operation);
+                    }
                     else
                     {
                         ImGui::Text("0x%" PRIx64 ":\t%s%s%s\n",
-                                    Inst->Address, Inst->Mnemonic, Spaces, Inst->Operation);
+                                    Inst->Address, Inst->Mnemonic, Inst->Padding, Inst->Operation);
                     }
+                    
+                    GuiShowCodeContextMenu(Inst->Address, PC);
                 }
             }
         }
@@ -1168,10 +1430,10 @@ DebagMain()
         
         ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, 0));
         
-        if(Debugee.Flags.Running &&
+        if(DebugeeStopped &&
            ImGui::BeginTabBar("Source lines", TBFlags | ImGuiTabBarFlags_AutoSelectNewTabs))
         {
-            di_src_line *Line = DwarfFindLineByAddress(DebugeeGetProgramCounter(&Debugee));
+            di_src_line *Line = DwarfFindLineByAddress(Stop.PC);
 
             for(u32 SrcFileIndex = 0; SrcFileIndex < DI->SourceFilesCount; SrcFileIndex++)
             {
@@ -1277,24 +1539,19 @@ DebagMain()
                                 ImGui::Text("%d%s%s", LineNum, Spaces, Src->Content[I]);
                             }
 
+                            if(DrawingLine)
+                            {
+                                GuiShowCodeContextMenu(DrawingLine->Address, Stop.PC, DrawingLine);
+                            }
+
                             if(Button && DrawingLine)
                             {
-                                if(BreakpointEnabled(BP))
-                                {
-                                    BreakpointDisable(BP);
-                                }
-                                else
-                                {
-                                    if(BP)
-                                    {
-                                        BreakpointEnable(BP);
-                                    }
-                                    else
-                                    {
-                                        BreakpointPushAtSourceLine(Src, DrawingLine->LineNum,
-                                            Breakpoints, &BreakpointCount);
-                                    }
-                                }
+                                tracer_command Cmd = {};
+                                Cmd.Type = TRACER_CMD_TOGGLE_SOURCE_LINE;
+                                Cmd.SrcFileIndex = SrcFileIndex;
+                                Cmd.LineNum = DrawingLine->LineNum;
+                                TracerPush(Cmd);
+                                TracerWaitIdle();
                             }
                         }
                     }
@@ -1319,7 +1576,7 @@ DebagMain()
         {
             if(ImGui::BeginTabItem("Locals"))
             {
-                if(Debugee.Flags.Running)
+                if(DebugeeStopped)
                 {
                     ImGui::BeginChild("locals");
                     GuiShowVariables();
@@ -1330,7 +1587,7 @@ DebagMain()
             }
             if(ImGui::BeginTabItem("Watch"))
             {
-                if(Debugee.Flags.Running)
+                if(DebugeeStopped)
                 {
                     ImGui::BeginChild("watch");
                     GuiShowWatch();
@@ -1341,7 +1598,7 @@ DebagMain()
             }
             if(ImGui::BeginTabItem("Backtrace"))
             {
-                if(Debugee.Flags.Running)
+                if(DebugeeStopped)
                 {
                     ImGui::BeginChild("regs");
                     GuiShowBacktrace();
@@ -1350,12 +1607,23 @@ DebagMain()
                 
                 ImGui::EndTabItem();
             }
+            if(ImGui::BeginTabItem("Threads"))
+            {
+                if(DebugeeStopped)
+                {
+                    ImGui::BeginChild("threads");
+                    GuiShowThreads();
+                    ImGui::EndChild();
+                }
+                
+                ImGui::EndTabItem();
+            }
             if(ImGui::BeginTabItem("x64 Registers"))
             {
-                if(Debugee.Flags.Running)
+                if(DebugeeStopped)
                 {
                     ImGui::BeginChild("regs");
-                    GuiShowRegisters(Debugee.Regs);
+                    GuiShowRegisters(Stop.Regs);
                     ImGui::EndChild();
                 }
                 
@@ -1363,7 +1631,7 @@ DebagMain()
             }
             if(ImGui::BeginTabItem("Breakpoints"))
             {
-                if(Debugee.Flags.Running)
+                if(DebugeeStopped)
                 {
                     ImGui::BeginChild("bps");
                     GuiShowBreakpoints();
@@ -1372,18 +1640,27 @@ DebagMain()
                 
                 ImGui::EndTabItem();
             }
+            if(ImGui::BeginTabItem("Memory"))
+            {
+                if(DebugeeStopped)
+                {
+                    ImGui::BeginChild("memory");
+                    GuiShowMemory();
+                    ImGui::EndChild();
+                }
+
+                ImGui::EndTabItem();
+            }
             ImGui::EndTabBar();
         }
         
         ImGui::End();
         
         GuiEndFrame();
-        //EndDraw:;
-        ButtonsUpdate(KeyboardButtons, (sizeof(KeyboardButtons)/sizeof(KeyboardButtons[0])));
-        glfwPollEvents();
         glfwSwapBuffers(Window);
     }
 
+    TracerDestroy();
     DwarfCloseSymbolsHandle(&DI->DwarfFd, &DI->Debug);
     DwarfCloseSymbolsHandle(&DI->CFAFd, &DI->CFADebug);
     ImGui::DestroyContext();
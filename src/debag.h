@@ -18,6 +18,11 @@
 
 #define CLEAR_BREAKPOINTS 1
 
+// NOTE(mateusz): Frames drawn after every input/debugee change, then the main
+// loop blocks in glfwWaitEventsTimeout for at most DEBAG_IDLE_WAIT_SECONDS.
+#define DEBAG_REDRAW_FRAMES 3
+#define DEBAG_IDLE_WAIT_SECONDS 0.5
+
 struct TimePoints
 {
     struct timespec start;
@@ -70,11 +75,78 @@ enum
 
 typedef i32 inst_type;
 
+struct di_src_line;
+
+// NOTE(mateusz): Everything the disassembly window prints is prepared once, when the
+// instructions are disassembled. Operation has the names of branch targets in it,
+// Line is the source line the instruction belongs to and Row is where the
+// instruction is in the interleaved view.
 struct disasm_inst
 {
     size_t Address;
     char *Mnemonic;
+    char *Padding;
     char *Operation;
+    di_src_line *Line;
+    u32 Row;
+};
+
+// A row of the interleaved view shows either a source line or an instruction
+struct disasm_row
+{
+    u32 InstIndex;
+    di_src_line *Line;
+};
+
+// NOTE(mateusz): The instructions under one source line row of the interleaved view.
+// The compiler can split a line into a few runs, they are chained through Next (index + 1).
+struct disasm_line_run
+{
+    di_src_line *Line;
+    u32 Row;
+    u32 FirstInst;
+    u32 InstCount;
+    u32 Next;
+};
+
+// NOTE(mateusz): Ranges too big to disassemble at once, like a whole .text section,
+// are decoded in chunks when the disassembly window scrolls to them. Only the last
+// used chunks are kept, the rows of chunks that were never decoded are estimated.
+#define DISASM_CHUNK_SIZE Kilobytes(16)
+#define DISASM_RESIDENT_CHUNKS 16
+#define DISASM_ESTIMATED_ROWS (DISASM_CHUNK_SIZE / 4)
+
+struct disasm_chunk
+{
+    bool Valid;
+    u32 Index;
+    u32 LastUsed;
+    size_t Start;
+    size_t DecodedEnd;
+    disasm_inst *Insts;
+    u32 InstsCount;
+    u32 InstsMax;
+    arena Arena;
+};
+
+struct disasm_stream
+{
+    bool Active;
+    address_range Range;
+    
+    // Code that isn't writable is read from the file, FileDelta is the difference
+    // between the addresses and the file offsets. Memory of the debugee otherwise.
+    i32 FileFd;
+    size_t FileDelta;
+    
+    csh Handle;
+    u32 ChunksCount;
+    u32 *ChunkRows;
+    u32 *ChunkFirstRow;
+    u32 RowsCount;
+    u32 UseCounter;
+    disasm_chunk Resident[DISASM_RESIDENT_CHUNKS];
+    size_t ScrollToAddress;
 };
 
 debugee Debugee;
@@ -90,6 +162,21 @@ u32 TempBreakpointsCount = 0;
 arena DisasmArena;
 disasm_inst *DisasmInst = 0x0;
 u32 DisasmInstCount = 0;
+disasm_row *DisasmRows = 0x0;
+u32 DisasmRowsCount = 0;
+
+// NOTE(mateusz): Index of the instruction for every byte of the disassembled range
+address_range DisasmRange = {};
+u32 *DisasmInstByOffset = 0x0;
+
+// NOTE(mateusz): From a source line back to its instructions, open addressing on
+// the file and the line number, slots hold the index + 1 of the first run.
+disasm_line_run *DisasmLineRuns = 0x0;
+u32 DisasmLineRunsCount = 0;
+u32 *DisasmRunsByLine = 0x0;
+u32 DisasmRunsByLineCapacity = 0;
+
+disasm_stream DisasmStream = {};
 
 csh DisAsmHandle;
 
@@ -121,6 +208,9 @@ static void KeyboardButtonCallback(GLFWwindow *Window, int Key, int Scancode, in
 static void MousePositionCallback(GLFWwindow *Window, double X, double Y);
 static void MouseButtonCallback(GLFWwindow *Window, int Key, int Action, int Mods);
 static void WindowSizeCallback(GLFWwindow *Window, i32 Width, i32 Height);
+static void WindowRefreshCallback(GLFWwindow *Window);
+static void ScrollCallback(GLFWwindow *Window, double X, double Y);
+static void CharCallback(GLFWwindow *Window, unsigned int Codepoint);
 static void ButtonsUpdate(button *Buttons, u32 Count);
 
 /*
@@ -159,13 +249,16 @@ static breakpoint   BreakpointCreate(size_t Address);
 static breakpoint   BreakpointCreateAttachSourceLine(size_t Address);
 static void         BreakpointEnable(breakpoint *BP);
 static void         BreakpointDisable(breakpoint *BP);
+static void         BreakpointPushTemp(size_t Address);
+static void         BreakpointClearTemp();
+static void         BreakpointToggleAtSourceLine(u32 SrcFileIndex, u32 LineNum);
 
 //static void BreakpointPushAtSourceLine(di_src_file *Src, u32 LineNum, breakpoint *BPs, u32 *Count);
 
 /*
  * Setting breakpoints at places
  */
-static bool         BreakAtFunctionName(char *Name);
+static bool         BreakAtFunctionName(char *Name, u32 *Dropped);
 static void         BreakAtMain();
 static bool         BreakAtAddress(char *AddressStr);
 static bool         BreakAtAddress(size_t Address);
@@ -1,25 +1,271 @@
 debug_info _DI = { };
 debug_info *DI = &_DI;
 
+di_module Modules[MAX_DI_MODULES] = { };
+u32 ModulesCount = 0;
+bool ModulesStale = false;
+// NOTE(mateusz): Changes every time the file mappings of the debugee change, things
+// built from the maps (like the image of the debugee) are redone only then.
+u32 ModulesGeneration = 0;
+u64 ModulesMapsHash = 0;
+
+di_elf_file ElfFiles[MAX_ELF_FILES] = { };
+
 static void
 DwarfClearAll()
 {
-    DwarfCloseSymbolsHandle(&DI->DwarfFd, &DI->Debug);
-    DwarfCloseSymbolsHandle(&DI->CFAFd, &DI->CFADebug);
-
-    ArenaDestroy(&DI->Arena);
+    for(u32 I = 0; I < ModulesCount; I++)
+    {
+        debug_info *ModuleDI = &Modules[I].DI;
+        DwarfCloseSymbolsHandle(&ModuleDI->DwarfFd, &ModuleDI->Debug);
+        DwarfCloseSymbolsHandle(&ModuleDI->CFAFd, &ModuleDI->CFADebug);
+        
+        ArenaDestroy(&ModuleDI->Arena);
+        free(ModuleDI->ElfSymbols);
+        free(ModuleDI->ElfSymbolNames);
+    }
+    
+    memset(Modules, 0, sizeof(di_module) * ModulesCount);
+    ModulesCount = 0;
+    ModulesStale = false;
+    ModulesMapsHash = 0;
+    ModulesGeneration += 1;
 
+    DI = &_DI;
     memset(DI, 0, sizeof(debug_info));
 }
 
+static void *
+DwarfInflateWorker(void *Arg)
+{
+    di_inflate_job *Jobs = (di_inflate_job *)Arg;
+    
+    for(u32 I = 0; Jobs[I].Data; I++)
+    {
+        di_inflate_job *Job = &Jobs[I];
+        // NOTE(mateusz): Workers pick the sections up in order, the first one to mark
+        // a job owns it.
+        if(__atomic_exchange_n(&Job->Inflated, true, __ATOMIC_ACQ_REL))
+        {
+            continue;
+        }
+        
+        Elf64_Chdr *Header = (Elf64_Chdr *)Job->Data->d_buf;
+        u8 *Source = (u8 *)(Header + 1);
+        size_t SourceSize = Job->Data->d_size - sizeof(Elf64_Chdr);
+        Job->Result = (u8 *)malloc(Header->ch_size);
+        Job->ResultSize = Header->ch_size;
+        
+        bool Result = false;
+        if(Header->ch_type == ELFCOMPRESS_ZLIB)
+        {
+            uLongf DestSize = Job->ResultSize;
+            Result = uncompress(Job->Result, &DestSize, Source, SourceSize) == Z_OK && DestSize == Job->ResultSize;
+        }
+        else if(Header->ch_type == ELFCOMPRESS_ZSTD)
+        {
+            size_t DestSize = ZSTD_decompress(Job->Result, Job->ResultSize, Source, SourceSize);
+            Result = !ZSTD_isError(DestSize) && DestSize == Job->ResultSize;
+        }
+        
+        if(!Result)
+        {
+            free(Job->Result);
+            Job->Result = 0x0;
+        }
+    }
+    
+    return 0x0;
+}
+
+static void
+DwarfInflateSections(di_elf_file *File)
+{
+    size_t StringsIndex = 0;
+    if(elf_getshdrstrndx(File->ElfHandle, &StringsIndex) != 0)
+    {
+        return;
+    }
+    
+    u32 SectionsCount = 0;
+    for(Elf_Scn *ElfScn = 0x0; (ElfScn = elf_nextscn(File->ElfHandle, ElfScn));)
+    {
+        SectionsCount++;
+    }
+    
+    // Zeroed last job terminates the list
+    di_inflate_job *Jobs = (di_inflate_job *)calloc(SectionsCount + 1, sizeof(di_inflate_job));
+    Elf64_Shdr **Headers = (Elf64_Shdr **)calloc(SectionsCount + 1, sizeof(Elf64_Shdr *));
+    u32 JobsCount = 0;
+    
+    for(Elf_Scn *ElfScn = 0x0; (ElfScn = elf_nextscn(File->ElfHandle, ElfScn));)
+    {
+        Elf64_Shdr *SectionHeader = elf64_getshdr(ElfScn);
+        char *Name = elf_strptr(File->ElfHandle, StringsIndex, SectionHeader->sh_name);
+        if(!Name || !StringStartsWith(Name, ".debug_") || !(SectionHeader->sh_flags & SHF_COMPRESSED))
+        {
+            continue;
+        }
+        
+        Elf_Data *Data = elf_getdata(ElfScn, 0x0);
+        if(Data && Data->d_size > sizeof(Elf64_Chdr))
+        {
+            Headers[JobsCount] = SectionHeader;
+            Jobs[JobsCount++].Data = Data;
+        }
+    }
+    
+    if(JobsCount > 0)
+    {
+        pthread_t Workers[16] = {};
+        u32 WorkersCount = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+        WorkersCount = WorkersCount < ARRAY_LENGTH(Workers) ? WorkersCount : ARRAY_LENGTH(Workers);
+        WorkersCount = WorkersCount < JobsCount - 1 ? WorkersCount : JobsCount - 1;
+        
+        for(u32 I = 0; I < WorkersCount; I++)
+        {
+            assert(pthread_create(&Workers[I], 0x0, DwarfInflateWorker, Jobs) == 0);
+        }
+        DwarfInflateWorker(Jobs);
+        for(u32 I = 0; I < WorkersCount; I++)
+        {
+            pthread_join(Workers[I], 0x0);
+        }
+        
+        // NOTE(mateusz): libdwarf only sees the section headers and the data of the
+        // handle, once they describe the inflated bytes it reads them as they are.
+        File->Buffers = (void **)calloc(JobsCount, sizeof(void *));
+        for(u32 I = 0; I < JobsCount; I++)
+        {
+            di_inflate_job *Job = &Jobs[I];
+            if(Job->Result)
+            {
+                Job->Data->d_buf = Job->Result;
+                Job->Data->d_size = Job->ResultSize;
+                Job->Data->d_type = ELF_T_BYTE;
+                Job->Data->d_align = 1;
+                Headers[I]->sh_flags &= ~SHF_COMPRESSED;
+                Headers[I]->sh_size = Job->ResultSize;
+                
+                File->Buffers[File->BuffersCount++] = Job->Result;
+            }
+            else
+            {
+                LOG_DWARF("Section of %s was not inflated, left to libdwarf\n", File->Path);
+            }
+        }
+    }
+    
+    free(Headers);
+    free(Jobs);
+}
+
+static void
+DwarfCloseElfFile(di_elf_file *File)
+{
+    assert(File->Users == 0);
+    
+    elf_end(File->ElfHandle);
+    close(File->Fd);
+    for(u32 I = 0; I < File->BuffersCount; I++)
+    {
+        free(File->Buffers[I]);
+    }
+    free(File->Buffers);
+    
+    memset(File, 0, sizeof(di_elf_file));
+}
+
+static di_elf_file *
+DwarfOpenElfFile(char *Path)
+{
+    struct stat Stat = {};
+    if(stat(Path, &Stat) != 0)
+    {
+        return 0x0;
+    }
+    
+    di_elf_file *Free = 0x0;
+    for(u32 I = 0; I < MAX_ELF_FILES; I++)
+    {
+        di_elf_file *File = &ElfFiles[I];
+        if(File->Fd && StringMatches(File->Path, Path))
+        {
+            bool Changed = File->FileSize != (size_t)Stat.st_size ||
+                File->ModifyTime.tv_sec != Stat.st_mtim.tv_sec ||
+                File->ModifyTime.tv_nsec != Stat.st_mtim.tv_nsec;
+            if(!Changed || File->Users > 0)
+            {
+                return File;
+            }
+            
+            // The binary was rebuilt between the runs
+            DwarfCloseElfFile(File);
+        }
+        
+        if(!Free && (!File->Fd || File->Users == 0))
+        {
+            Free = File;
+        }
+    }
+    
+    if(!Free)
+    {
+        LOG_DWARF("All of the %d ELF files are in use\n", MAX_ELF_FILES);
+        return 0x0;
+    }
+    
+    i32 Fd = open(Path, O_RDONLY);
+    if(Fd == -1)
+    {
+        return 0x0;
+    }
+    
+    if(Free->Fd)
+    {
+        DwarfCloseElfFile(Free);
+    }
+    
+    assert(elf_version(EV_CURRENT) != EV_NONE);
+    Elf *ElfHandle = elf_begin(Fd, ELF_C_READ, 0x0);
+    if(!ElfHandle)
+    {
+        close(Fd);
+        return 0x0;
+    }
+    
+    StringCopy(Free->Path, Path);
+    Free->Fd = Fd;
+    Free->ElfHandle = ElfHandle;
+    Free->ModifyTime = Stat.st_mtim;
+    Free->FileSize = Stat.st_size;
+    
+    return Free;
+}
+
 static bool
-DwarfOpenSymbolsHandle(i32 *Fd, Dwarf_Debug *Debug)
+DwarfOpenSymbolsHandle(char *Path, i32 *Fd, Dwarf_Debug *Debug)
 {
     assert(*Fd == 0);
-    *Fd = open(Debugee.ProgramPath, O_RDONLY);
-    assert(*Fd != -1);
+    di_elf_file *File = Path ? DwarfOpenElfFile(Path) : 0x0;
+    if(!File)
+    {
+        return false;
+    }
+    
+    if(!File->Inflated)
+    {
+        DwarfInflateSections(File);
+        File->Inflated = true;
+    }
     
-    bool Result = dwarf_init(*Fd, DW_DLC_READ, 0, 0, Debug, 0x0) == DW_DLV_OK;
+    // Modules without any DWARF sections fail here
+    bool Result = dwarf_elf_init(File->ElfHandle, DW_DLC_READ, 0, 0, Debug, 0x0) == DW_DLV_OK;
+    if(Result)
+    {
+        File->Users++;
+        *Fd = File->Fd;
+    }
     
     return Result;
 }
@@ -30,7 +276,15 @@ DwarfCloseSymbolsHandle(i32 *Fd, Dwarf_Debug *Debug)
     if(*Fd)
     {
         assert(dwarf_finish(*Debug, 0x0) == DW_DLV_OK);
-        close(*Fd);
+        for(u32 I = 0; I < MAX_ELF_FILES; I++)
+        {
+            if(ElfFiles[I].Fd == *Fd)
+            {
+                assert(ElfFiles[I].Users > 0);
+                ElfFiles[I].Users--;
+                break;
+            }
+        }
         *Fd = 0;
     }
 }
@@ -38,8 +292,13 @@ DwarfCloseSymbolsHandle(i32 *Fd, Dwarf_Debug *Debug)
 static di_src_line *
 DwarfFindLineByAddress(size_t Address)
 {
+    di_src_line *Result = 0x0;
+    
+    debug_info *Current = DI;
+    DI = DwarfModuleDebugInfo(Address);
+    
     // Try to find it in what we have
-    for(u32 I = 0; I < DI->SourceFilesCount; I++)
+    for(u32 I = 0; I < DI->SourceFilesCount && !Result; I++)
     {
         di_src_file *File = &DI->SourceFiles[I];
         for(u32 J = 0; J < File->SrcLineCount; J++)
@@ -47,13 +306,15 @@ DwarfFindLineByAddress(size_t Address)
             size_t LineAddress = File->Lines[J].Address;
             if(LineAddress == Address)
             {
-                return &File->Lines[J];
+                Result = &File->Lines[J];
+                break;
             }
             else if(J + 1 < File->SrcLineCount &&
                     Address > LineAddress &&
                     Address < File->Lines[J + 1].Address)
             {
-                return &File->Lines[J];
+                Result = &File->Lines[J];
+                break;
             }
         }
     }
@@ -61,19 +322,17 @@ DwarfFindLineByAddress(size_t Address)
     // If we don't have it, call Dwarf parsing, and search for it
     u32 LineIdx = 0;
     u32 FileIdx = 0;
-    bool Found = DwarfLoadSourceFileByAddress(Address, &FileIdx, &LineIdx);
-    
-    if(Found)
+    if(!Result && DwarfLoadSourceFileByAddress(Address, &FileIdx, &LineIdx))
     {
         assert(FileIdx < DI->SourceFilesCount);
         di_src_file *File = &DI->SourceFiles[FileIdx];
         assert(LineIdx < File->SrcLineCount);
-        di_src_line *Line = &File->Lines[LineIdx];
-        
-        return Line;
+        Result = &File->Lines[LineIdx];
     }
     
-    return 0x0;
+    DI = Current;
+    
+    return Result;
 }
 
 static di_src_line *
@@ -95,23 +354,21 @@ DwarfFindLineByNumber(u32 LineNum, u32 SrcFileIndex)
 static bool
 DwarfAddressConfinedByFunction(di_function *Func, size_t Address)
 {
-    size_t LowPC = Func->FuncLexScope.LowPC;
-    size_t HighPC = Func->FuncLexScope.HighPC;
-
-    return AddressBetween(Address, LowPC, HighPC);
+    return DwarfAddressConfinedByLexicalScope(&Func->FuncLexScope, Address);
 }
 
 static di_function *
 DwarfFindFunctionByAddress(size_t Address)
 {
     di_function *Result = 0x0;
+    debug_info *ModuleDI = DwarfModuleDebugInfo(Address);
     
-    for(u32 I = 0; I < DI->FunctionsCount; I++)
+    for(u32 I = 0; I < ModuleDI->FunctionsCount; I++)
     {
-        di_function *Func = &DI->Functions[I];
-        if(AddressBetween(Address, Func->FuncLexScope.LowPC, Func->FuncLexScope.HighPC))
+        di_function *Func = &ModuleDI->Functions[I];
+        if(DwarfAddressConfinedByLexicalScope(&Func->FuncLexScope, Address))
         {
-            Result = &DI->Functions[I];
+            Result = &ModuleDI->Functions[I];
             break;
         }
     }
@@ -119,13 +376,73 @@ DwarfFindFunctionByAddress(size_t Address)
     return Result;
 }
 
+// NOTE(mateusz): Fills Result with the inlined calls of Func that contain Address,
+// innermost call first, the same order frames are shown in a backtrace.
+static u32
+DwarfFindInlinedCallsByAddress(di_function *Func, size_t Address, di_inlined_call **Result, u32 MaxCount)
+{
+    u32 Count = 0;
+    
+    for(u32 I = 0; Func && I < Func->InlinedCallsCount && Count < MaxCount; I++)
+    {
+        di_inlined_call *Call = &Func->InlinedCalls[I];
+        if(DwarfAddressConfinedByLexicalScope(&Call->LexScope, Address))
+        {
+            Result[Count++] = Call;
+        }
+    }
+    
+    for(u32 I = 0; I < Count / 2; I++)
+    {
+        di_inlined_call *Temp = Result[I];
+        Result[I] = Result[Count - 1 - I];
+        Result[Count - 1 - I] = Temp;
+    }
+    
+    return Count;
+}
+
+static u32
+DwarfGetInlinedDepth(size_t Address)
+{
+    di_inlined_call *Calls[MAX_INLINED_DEPTH] = {};
+    di_function *Func = DwarfFindFunctionByAddress(Address);
+    
+    return DwarfFindInlinedCallsByAddress(Func, Address, Calls, ARRAY_LENGTH(Calls));
+}
+
+static char *
+DwarfGetAbstractOriginName(Dwarf_Debug Debug, Dwarf_Attribute Attribute)
+{
+    Dwarf_Error Error_ = {};
+    Dwarf_Error *Error = &Error_;
+    char *Result = 0x0;
+    
+    Dwarf_Off OriginOffset = 0;
+    DWARF_CALL(dwarf_global_formref(Attribute, &OriginOffset, Error));
+    
+    Dwarf_Die OriginDIE = 0x0;
+    if(dwarf_offdie_b(Debug, OriginOffset, true, &OriginDIE, Error) == DW_DLV_OK)
+    {
+        char *Name = 0x0;
+        if(dwarf_diename(OriginDIE, &Name, Error) == DW_DLV_OK)
+        {
+            Result = StringDuplicate(&DI->Arena, Name);
+        }
+        
+        dwarf_dealloc(Debug, OriginDIE, DW_DLA_DIE);
+    }
+    
+    return Result;
+}
+
 /* NOTE(mateusz): 
 
 Types like DW_TAG_pointer_type, DW_TAG_typedef, DW_TAG_const_type, DW_TAG_array_type...
 are considered as "decorator" types, and only help in displaying the underlaying types.
 As underlaying types we understand DW_TAG_base_type or DW_TAG_structure_type.
 This function recursivley adds "decorator" types to the flags, and ultimately returns
- void * that depending on the underlaying type is either di_base_type or di_struct_type.
+ void * that depending on the underlaying type is either di_base_type or di_aggregate_type.
 
 */
 
@@ -153,8 +470,86 @@ DIEOffsetPredicate(void *Cmp, void *Search)
     return Result;
 }
 
+static di_type_node *
+DwarfGetTypeNode(size_t DIEOffset)
+{
+    // No debug info was read into this module, nothing to keep the nodes in
+    if(DIEOffset == 0x0 || !DI->Arena.CursorNode)
+    {
+        return 0x0;
+    }
+
+    u32 Mask = DI->TypeNodesCapacity - 1;
+    u32 Slot = DIEOffset & Mask;
+    while(DI->TypeNodesCapacity && DI->TypeNodes[Slot].DIEOffset)
+    {
+        if(DI->TypeNodes[Slot].DIEOffset == DIEOffset)
+        {
+            return &DI->TypeNodes[Slot];
+        }
+
+        Slot = (Slot + 1) & Mask;
+    }
+
+    // NOTE(mateusz): Resolving looks up the decorated types below this one, which
+    // can grow the table, so the slot is searched for again after it.
+    di_underlaying_type Underlaying = DwarfResolveUnderlayingType(DIEOffset);
+
+    if(DI->TypeNodesCount * 4 >= DI->TypeNodesCapacity * 3)
+    {
+        di_type_node *Old = DI->TypeNodes;
+        u32 OldCapacity = DI->TypeNodesCapacity;
+
+        DI->TypeNodesCapacity = OldCapacity ? OldCapacity * 2 : DI_TYPE_NODES_INITIAL_CAPACITY;
+        DI->TypeNodes = ArrayPush(&DI->Arena, di_type_node, DI->TypeNodesCapacity);
+        memset(DI->TypeNodes, 0, sizeof(di_type_node) * DI->TypeNodesCapacity);
+
+        for(u32 I = 0; I < OldCapacity; I++)
+        {
+            if(Old[I].DIEOffset)
+            {
+                u32 NewSlot = Old[I].DIEOffset & (DI->TypeNodesCapacity - 1);
+                while(DI->TypeNodes[NewSlot].DIEOffset)
+                {
+                    NewSlot = (NewSlot + 1) & (DI->TypeNodesCapacity - 1);
+                }
+
+                DI->TypeNodes[NewSlot] = Old[I];
+            }
+        }
+    }
+
+    Mask = DI->TypeNodesCapacity - 1;
+    Slot = DIEOffset & Mask;
+    while(DI->TypeNodes[Slot].DIEOffset)
+    {
+        Slot = (Slot + 1) & Mask;
+    }
+
+    di_type_node *Result = &DI->TypeNodes[Slot];
+    Result->DIEOffset = DIEOffset;
+    Result->Underlaying = Underlaying;
+    DI->TypeNodesCount += 1;
+
+    return Result;
+}
+
 static di_underlaying_type
 DwarfFindUnderlayingType(size_t BTDIEOffset)
+{
+    di_type_node *Node = DwarfGetTypeNode(BTDIEOffset);
+    if(Node)
+    {
+        return Node->Underlaying;
+    }
+
+    return DwarfResolveUnderlayingType(BTDIEOffset);
+}
+
+// NOTE(mateusz): Only called on the first lookup of an offset, the decorated
+// types go back through DwarfFindUnderlayingType so every level is memoized.
+static di_underlaying_type
+DwarfResolveUnderlayingType(size_t BTDIEOffset)
 {
     di_underlaying_type Result = {};
 
@@ -212,8 +607,8 @@ DwarfFindUnderlayingType(size_t BTDIEOffset)
         return Result;
     }
 
-    SearchResult = BinarySearch(DI->StructTypes, DI->StructTypesCount, offsetof(di_struct_type, DIEOffset),
-                                sizeof(di_struct_type), DIEOffsetPredicate, (void *)&BTDIEOffset);
+    SearchResult = BinarySearch(DI->StructTypes, DI->StructTypesCount, offsetof(di_aggregate_type, DIEOffset),
+                                sizeof(di_aggregate_type), DIEOffsetPredicate, (void *)&BTDIEOffset);
 
     // Underlaying types
     if(SearchResult.Found)
@@ -225,8 +620,8 @@ DwarfFindUnderlayingType(size_t BTDIEOffset)
         return Result;
     }
 
-    SearchResult = BinarySearch(DI->UnionTypes, DI->UnionTypesCount, offsetof(di_union_type, DIEOffset),
-                                sizeof(di_union_type), DIEOffsetPredicate, (void *)&BTDIEOffset);
+    SearchResult = BinarySearch(DI->UnionTypes, DI->UnionTypesCount, offsetof(di_aggregate_type, DIEOffset),
+                                sizeof(di_aggregate_type), DIEOffsetPredicate, (void *)&BTDIEOffset);
 
     if(SearchResult.Found)
     {
@@ -271,66 +666,575 @@ DwarfGetVariablesUnderlayingType(di_variable *Var)
 	return Result;
 }
 
+// NOTE(mateusz): DWARF register numbers for x86-64, 0-15 are the general purpose
+// registers, 16 is the return address and 17-32 are XMM0-15.
 static size_t
-DwarfGetVariableMemoryAddress(di_variable *Var)
+DwarfGetRegisterValue(u32 Register)
 {
-    size_t Address = 0x0;
-    if(Var->LocationAtom == DW_OP_fbreg)
+    size_t Result = 0x0;
+    
+    if(Register <= 15)
     {
-        size_t CFA = DwarfGetCanonicalFrameAddress(DebugeeGetProgramCounter(&Debugee));
-        Address = CFA + Var->Offset;
+        Result = RegisterGetByABINumber(Debugee.Regs, Register);
     }
-    else if(Var->LocationAtom == DW_OP_addr)
+    else if(Register == 16)
     {
-        Address = Debugee.Flags.PIE ? Var->Offset + Debugee.LoadAddress : Var->Offset;
+        Result = Debugee.Regs.RIP;
     }
-    else if(Var->LocationAtom >= DW_OP_breg0 && Var->LocationAtom <= DW_OP_breg15)
+    else if(Register <= 32)
     {
-        size_t Register = RegisterGetByABINumber(Debugee.Regs, Var->LocationAtom - DW_OP_breg0);
-        Address = Var->Offset + Register;
+        memcpy(&Result, &Debugee.XSaveBuffer[160 + (Register - 17) * 16], sizeof(Result));
     }
-
-    return Address;
+    
+    return Result;
 }
 
 static u32
-DwarfParseTypeStringToBytes(di_underlaying_type *Underlaying, char *String, u8 *Result)
+DwarfReadRegisterBytes(u32 Register, u8 *Result, u32 Size)
 {
-    u32 WrittenBytes = 0;
+    u32 Written = 0;
+    
+    if(Register <= 16)
+    {
+        size_t Value = DwarfGetRegisterValue(Register);
+        Written = MIN(Size, sizeof(Value));
+        memcpy(Result, &Value, Written);
+    }
+    else if(Register <= 32)
+    {
+        Written = MIN(Size, 16);
+        memcpy(Result, &Debugee.XSaveBuffer[160 + (Register - 17) * 16], Written);
+    }
+    
+    return Written;
+}
 
-    if(Underlaying->Type->Encoding == DW_ATE_float)
+static void
+DwarfDecodeLocation(Dwarf_Die DIE, Dwarf_Attribute Attribute, di_location_list *Result)
+{
+    Dwarf_Error Error_ = {};
+    Dwarf_Error *Error = &Error_;
+    
+    Dwarf_Loc_Head_c LocListHead = {};
+    Dwarf_Unsigned LocCount = 0;
+    DWARF_CALL(dwarf_get_loclist_c(Attribute, &LocListHead, &LocCount, Error));
+    
+    Result->Entries = ArrayPush(&DI->Arena, di_loc_entry, LocCount);
+    Result->EntriesCount = 0;
+    
+    for(u32 I = 0; I < LocCount; I++)
     {
-        switch(Underlaying->Type->ByteSize)
-        {
-        case 4:
+        Dwarf_Small LLEOut = 0;
+        Dwarf_Addr LowPC = 0;
+        Dwarf_Addr HighPC = 0;
+        Dwarf_Unsigned OpsCount = 0;
+        Dwarf_Locdesc_c LocDesc = 0;
+        Dwarf_Small LocListSourceOut = 0;
+        Dwarf_Unsigned ExpressionOffsetOut = 0;
+        Dwarf_Unsigned LocDescOffsetOut = 0;
+        
+        DWARF_CALL(dwarf_get_locdesc_entry_c(LocListHead, I, &LLEOut, &LowPC, &HighPC, &OpsCount, &LocDesc, &LocListSourceOut, &ExpressionOffsetOut, 
+                                             &LocDescOffsetOut, Error));
+        
+        // NOTE(mateusz): Base address and end of list entries carry no expression
+        if(LocListSourceOut != 0 && (OpsCount == 0 || LowPC >= HighPC))
         {
-            union Float4Int
-            {
-                float Float;
-                u8 Bytes[4];
-            };
-
-            Float4Int FI = {};
-            FI.Float = atof(String);
-
-            WrittenBytes = sizeof(Float4Int);
-            assert(WrittenBytes == 4);
-            memcpy(Result, FI.Bytes, WrittenBytes);
-
-            break;
+            continue;
         }
-        case 8:
+        
+        di_loc_entry *Entry = &Result->Entries[Result->EntriesCount++];
+        Entry->Always = LocListSourceOut == 0;
+        Entry->LowPC = LowPC + DI->LoadBias;
+        Entry->HighPC = HighPC + DI->LoadBias;
+        Entry->Ops = ArrayPush(&DI->Arena, di_loc_op, OpsCount);
+        Entry->OpsCount = OpsCount;
+        
+        for(u32 OpIndex = 0; OpIndex < OpsCount; OpIndex++)
         {
-            union Float8Int
+            Dwarf_Small AtomOut = 0;
+            Dwarf_Unsigned Operand1 = 0;
+            Dwarf_Unsigned Operand2 = 0;
+            Dwarf_Unsigned Operand3 = 0;
+            Dwarf_Unsigned OffsetBranch = 0;
+            DWARF_CALL(dwarf_get_location_op_value_c(LocDesc, OpIndex, &AtomOut, &Operand1, &Operand2, &Operand3, &OffsetBranch, Error));
+            
+            LOG_DWARF("AtomOut = %d, Oper1 = %lld, Oper2 = %llu, Oper3 = %llu, OffsetBranch = %llu\n", AtomOut, Operand1, Operand2, Operand3, OffsetBranch);
+            
+            di_loc_op *Op = &Entry->Ops[OpIndex];
+            Op->Atom = AtomOut;
+            Op->Operand1 = Operand1;
+            Op->Operand2 = Operand2;
+            
+            if(AtomOut == DW_OP_addrx || AtomOut == DW_OP_GNU_addr_index)
             {
-                double Float;
-                u8 Bytes[8];
-            };
-
-            Float8Int FI = {};
-            FI.Float = atof(String);
-
-            WrittenBytes = sizeof(Float8Int);
+                // NOTE(mateusz): Split units keep addresses in the .debug_addr of the skeleton
+                Dwarf_Addr Address = 0;
+                if(dwarf_debug_addr_index_to_addr(DIE, Operand1, &Address, Error) == DW_DLV_OK)
+                {
+                    Op->Atom = DW_OP_addr;
+                    Op->Operand1 = Address;
+                }
+                else
+                {
+                    Op->Atom = 0x0;
+                }
+            }
+            else if(AtomOut == DW_OP_implicit_value)
+            {
+                // NOTE(mateusz): Operand1 is the block length and Operand2 points to the block
+                Op->Operand2 = 0;
+                memcpy(&Op->Operand2, (u8 *)Operand2, MIN(Operand1, sizeof(Op->Operand2)));
+            }
+            else if(AtomOut == DW_OP_entry_value || AtomOut == DW_OP_GNU_entry_value)
+            {
+                // NOTE(mateusz): Only the common form with a single register in the
+                // block is supported, anything else is decoded to an unknown op
+                u8 *Block = (u8 *)Operand2;
+                if(Operand1 == 1 && Block[0] >= DW_OP_reg0 && Block[0] <= DW_OP_reg31)
+                {
+                    Op->Operand1 = Block[0] - DW_OP_reg0;
+                }
+                else if(Operand1 >= 2 && Block[0] == DW_OP_regx)
+                {
+                    u64 Register = 0;
+                    u32 Shift = 0;
+                    for(u32 B = 1; B < Operand1; B++)
+                    {
+                        Register |= (u64)(Block[B] & 0x7f) << Shift;
+                        Shift += 7;
+                        if(!(Block[B] & 0x80))
+                        {
+                            break;
+                        }
+                    }
+                    Op->Operand1 = Register;
+                }
+                else
+                {
+                    Op->Atom = 0x0;
+                }
+            }
+        }
+    }
+    
+    dwarf_loc_head_c_dealloc(LocListHead);
+}
+
+static di_location
+DwarfEvaluateLocationOps(di_loc_op *Ops, u32 OpsCount, size_t PC)
+{
+    di_location Result = {};
+    di_location Unavailable = {};
+    
+    size_t Stack[MAX_LOCATION_STACK];
+    u32 Top = 0;
+    di_location_piece Current = {};
+    bool HasCurrent = false;
+    
+#define LOCATION_NEED(Count) if(Top < (Count)) { return Unavailable; }
+#define LOCATION_PUSH(Value) if(Top >= MAX_LOCATION_STACK) { return Unavailable; } Stack[Top] = (Value); Top++;
+    
+    for(u32 I = 0; I < OpsCount; I++)
+    {
+        di_loc_op *Op = &Ops[I];
+        u8 Atom = Op->Atom;
+        
+        if(Atom >= DW_OP_lit0 && Atom <= DW_OP_lit31)
+        {
+            LOCATION_PUSH(Atom - DW_OP_lit0);
+        }
+        else if(Atom >= DW_OP_breg0 && Atom <= DW_OP_breg31)
+        {
+            LOCATION_PUSH(DwarfGetRegisterValue(Atom - DW_OP_breg0) + (i64)Op->Operand1);
+        }
+        else if(Atom >= DW_OP_reg0 && Atom <= DW_OP_reg31)
+        {
+            Current.Kind = LOCATION_REGISTER;
+            Current.Value = Atom - DW_OP_reg0;
+            HasCurrent = true;
+        }
+        else
+        {
+            switch(Atom)
+            {
+            case DW_OP_addr:
+            {
+                LOCATION_PUSH(Op->Operand1 + DI->LoadBias);
+            }break;
+            case DW_OP_const1u:
+            case DW_OP_const1s:
+            case DW_OP_const2u:
+            case DW_OP_const2s:
+            case DW_OP_const4u:
+            case DW_OP_const4s:
+            case DW_OP_const8u:
+            case DW_OP_const8s:
+            case DW_OP_constu:
+            case DW_OP_consts:
+            {
+                LOCATION_PUSH(Op->Operand1);
+            }break;
+            case DW_OP_fbreg:
+            {
+                size_t FrameBase = 0x0;
+                if(!DwarfGetFrameBase(PC, &FrameBase))
+                {
+                    return Unavailable;
+                }
+                
+                LOCATION_PUSH(FrameBase + (i64)Op->Operand1);
+            }break;
+            case DW_OP_call_frame_cfa:
+            {
+                size_t CFA = 0x0;
+                if(!DwarfGetCanonicalFrameAddress(PC, &CFA))
+                {
+                    return Unavailable;
+                }
+                
+                LOCATION_PUSH(CFA);
+            }break;
+            case DW_OP_bregx:
+            {
+                LOCATION_PUSH(DwarfGetRegisterValue(Op->Operand1) + (i64)Op->Operand2);
+            }break;
+            case DW_OP_regx:
+            {
+                Current.Kind = LOCATION_REGISTER;
+                Current.Value = Op->Operand1;
+                HasCurrent = true;
+            }break;
+            case DW_OP_dup:
+            {
+                LOCATION_NEED(1);
+                LOCATION_PUSH(Stack[Top - 1]);
+            }break;
+            case DW_OP_drop:
+            {
+                LOCATION_NEED(1);
+                Top--;
+            }break;
+            case DW_OP_over:
+            {
+                LOCATION_NEED(2);
+                LOCATION_PUSH(Stack[Top - 2]);
+            }break;
+            case DW_OP_swap:
+            {
+                LOCATION_NEED(2);
+                size_t Temp = Stack[Top - 1];
+                Stack[Top - 1] = Stack[Top - 2];
+                Stack[Top - 2] = Temp;
+            }break;
+            case DW_OP_deref:
+            {
+                LOCATION_NEED(1);
+                Stack[Top - 1] = DebugeePeekMemory(&Debugee, Stack[Top - 1]);
+            }break;
+            case DW_OP_plus_uconst:
+            {
+                LOCATION_NEED(1);
+                Stack[Top - 1] += Op->Operand1;
+            }break;
+            case DW_OP_neg:
+            {
+                LOCATION_NEED(1);
+                Stack[Top - 1] = -(i64)Stack[Top - 1];
+            }break;
+            case DW_OP_not:
+            {
+                LOCATION_NEED(1);
+                Stack[Top - 1] = ~Stack[Top - 1];
+            }break;
+            case DW_OP_plus:
+            case DW_OP_minus:
+            case DW_OP_mul:
+            case DW_OP_and:
+            case DW_OP_or:
+            case DW_OP_xor:
+            case DW_OP_shl:
+            case DW_OP_shr:
+            case DW_OP_shra:
+            {
+                LOCATION_NEED(2);
+                size_t B = Stack[--Top];
+                size_t A = Stack[Top - 1];
+                switch(Atom)
+                {
+                case DW_OP_plus: { A = A + B; }break;
+                case DW_OP_minus: { A = A - B; }break;
+                case DW_OP_mul: { A = A * B; }break;
+                case DW_OP_and: { A = A & B; }break;
+                case DW_OP_or: { A = A | B; }break;
+                case DW_OP_xor: { A = A ^ B; }break;
+                case DW_OP_shl: { A = A << B; }break;
+                case DW_OP_shr: { A = A >> B; }break;
+                case DW_OP_shra: { A = (i64)A >> B; }break;
+                }
+                Stack[Top - 1] = A;
+            }break;
+            case DW_OP_stack_value:
+            {
+                LOCATION_NEED(1);
+                Current.Kind = LOCATION_VALUE;
+                Current.Value = Stack[Top - 1];
+                HasCurrent = true;
+            }break;
+            case DW_OP_implicit_value:
+            {
+                Current.Kind = LOCATION_VALUE;
+                Current.Value = Op->Operand2;
+                HasCurrent = true;
+            }break;
+            case DW_OP_entry_value:
+            case DW_OP_GNU_entry_value:
+            {
+                // NOTE(mateusz): Without unwinding to the call site the value at
+                // entry is only known when the debugee still sits on the first instruction
+                di_function *Func = DwarfFindFunctionByAddress(PC);
+                if(!Func || Func->FuncLexScope.LowPC != PC)
+                {
+                    return Unavailable;
+                }
+                
+                LOCATION_PUSH(DwarfGetRegisterValue(Op->Operand1));
+            }break;
+            case DW_OP_piece:
+            {
+                if(!HasCurrent)
+                {
+                    // NOTE(mateusz): An empty piece describes an optimized out part of the variable
+                    Current.Kind = Top ? LOCATION_MEMORY : LOCATION_UNAVAILABLE;
+                    Current.Value = Top ? Stack[Top - 1] : 0x0;
+                }
+                
+                if(Result.PiecesCount >= MAX_LOCATION_PIECES || Op->Operand1 == 0)
+                {
+                    return Unavailable;
+                }
+                
+                Current.Size = Op->Operand1;
+                Result.Pieces[Result.PiecesCount++] = Current;
+                
+                Current = {};
+                HasCurrent = false;
+                Top = 0;
+            }break;
+            case DW_OP_nop:
+            {
+            }break;
+            default:
+            {
+                const char *OpName = 0x0;
+                dwarf_get_OP_name(Atom, &OpName);
+                LOG_DWARF("Unsupported location op = %d, %s\n", Atom, OpName);
+                
+                return Unavailable;
+            }break;
+            }
+        }
+    }
+    
+#undef LOCATION_NEED
+#undef LOCATION_PUSH
+    
+    if(Result.PiecesCount == 0)
+    {
+        if(HasCurrent)
+        {
+            Result.Pieces[Result.PiecesCount++] = Current;
+        }
+        else if(Top)
+        {
+            Current.Kind = LOCATION_MEMORY;
+            Current.Value = Stack[Top - 1];
+            Result.Pieces[Result.PiecesCount++] = Current;
+        }
+    }
+    
+    return Result;
+}
+
+static di_location
+DwarfGetVariableLocation(di_variable *Var)
+{
+    di_location Result = {};
+    size_t PC = DebugeeGetProgramCounter(&Debugee);
+    
+    for(u32 I = 0; I < Var->Location.EntriesCount; I++)
+    {
+        di_loc_entry *Entry = &Var->Location.Entries[I];
+        if(Entry->Always || (PC >= Entry->LowPC && PC < Entry->HighPC))
+        {
+            Result = DwarfEvaluateLocationOps(Entry->Ops, Entry->OpsCount, PC);
+            break;
+        }
+    }
+    
+    return Result;
+}
+
+// NOTE(mateusz): DW_AT_frame_base of the function the PC is in. It is a location like
+// any other, a memory location (DW_OP_call_frame_cfa, DW_OP_breg7) is the frame base
+// itself and a register location (DW_OP_reg6) holds it.
+static bool
+DwarfGetFrameBase(size_t PC, size_t *Result)
+{
+    di_function *Func = DwarfFindFunctionByAddress(PC);
+    if(!Func)
+    {
+        return false;
+    }
+    
+    for(u32 I = 0; I < Func->FrameBase.EntriesCount; I++)
+    {
+        di_loc_entry *Entry = &Func->FrameBase.Entries[I];
+        if(!Entry->Always && (PC < Entry->LowPC || PC >= Entry->HighPC))
+        {
+            continue;
+        }
+        
+        // The frame base can't be relative to itself
+        for(u32 OpIndex = 0; OpIndex < Entry->OpsCount; OpIndex++)
+        {
+            if(Entry->Ops[OpIndex].Atom == DW_OP_fbreg)
+            {
+                return false;
+            }
+        }
+        
+        di_location Location = DwarfEvaluateLocationOps(Entry->Ops, Entry->OpsCount, PC);
+        if(Location.PiecesCount != 1)
+        {
+            return false;
+        }
+        
+        di_location_piece *Piece = &Location.Pieces[0];
+        if(Piece->Kind == LOCATION_MEMORY)
+        {
+            *Result = Piece->Value;
+            return true;
+        }
+        else if(Piece->Kind == LOCATION_REGISTER && Piece->Value <= 16)
+        {
+            *Result = DwarfGetRegisterValue(Piece->Value);
+            return true;
+        }
+        
+        return false;
+    }
+    
+    return false;
+}
+
+static bool
+DwarfLocationIsMemory(di_location *Location)
+{
+    return Location->PiecesCount == 1 && Location->Pieces[0].Kind == LOCATION_MEMORY &&
+        Location->Pieces[0].Size == 0;
+}
+
+// NOTE(mateusz): Returns 0 if any part of the location is unavailable, parts not
+// covered by the pieces are zeroed.
+static u32
+DwarfReadLocationBytes(di_location *Location, u8 *Result, u32 Size)
+{
+    memset(Result, 0, Size);
+    if(Location->PiecesCount == 0)
+    {
+        return 0;
+    }
+    
+    u32 Offset = 0;
+    for(u32 I = 0; I < Location->PiecesCount && Offset < Size; I++)
+    {
+        di_location_piece *Piece = &Location->Pieces[I];
+        u32 PieceSize = Piece->Size ? MIN(Piece->Size, Size - Offset) : Size - Offset;
+        
+        switch(Piece->Kind)
+        {
+        case LOCATION_MEMORY:
+        {
+            if(DebugeeReadMemory(&Debugee, Piece->Value, &Result[Offset], PieceSize) != PieceSize)
+            {
+                return 0;
+            }
+        }break;
+        case LOCATION_REGISTER:
+        {
+            if(DwarfReadRegisterBytes(Piece->Value, &Result[Offset], PieceSize) == 0)
+            {
+                return 0;
+            }
+        }break;
+        case LOCATION_VALUE:
+        {
+            memcpy(&Result[Offset], &Piece->Value, MIN(PieceSize, sizeof(Piece->Value)));
+        }break;
+        default:
+        {
+            return 0;
+        }break;
+        }
+        
+        Offset += PieceSize;
+    }
+    
+    return Size;
+}
+
+static size_t
+DwarfGetVariableMemoryAddress(di_variable *Var)
+{
+    size_t Address = 0x0;
+    
+    di_location Location = DwarfGetVariableLocation(Var);
+    if(DwarfLocationIsMemory(&Location))
+    {
+        Address = Location.Pieces[0].Value;
+    }
+
+    return Address;
+}
+
+static u32
+DwarfParseTypeStringToBytes(di_underlaying_type *Underlaying, char *String, u8 *Result)
+{
+    u32 WrittenBytes = 0;
+
+    if(Underlaying->Type->Encoding == DW_ATE_float)
+    {
+        switch(Underlaying->Type->ByteSize)
+        {
+        case 4:
+        {
+            union Float4Int
+            {
+                float Float;
+                u8 Bytes[4];
+            };
+
+            Float4Int FI = {};
+            FI.Float = atof(String);
+
+            WrittenBytes = sizeof(Float4Int);
+            assert(WrittenBytes == 4);
+            memcpy(Result, FI.Bytes, WrittenBytes);
+
+            break;
+        }
+        case 8:
+        {
+            union Float8Int
+            {
+                double Float;
+                u8 Bytes[8];
+            };
+
+            Float8Int FI = {};
+            FI.Float = atof(String);
+
+            WrittenBytes = sizeof(Float8Int);
             assert(WrittenBytes == 8);
             memcpy(Result, FI.Bytes, WrittenBytes);
 
@@ -418,38 +1322,59 @@ DwarfGetScopedVars(size_t PC)
     }
 
     di_function *Func = DwarfFindFunctionByAddress(PC);
-    if(Func && Func->FrameBaseIsCFA)
+    if(Func)
     {
         Result.Param = Func->Params;
         Result.ParamCount = Func->ParamCount;
 
-        //TODO(mateusz): Some variables are missing that way, fix it.
         Result.Local = Func->FuncLexScope.Variables;
         Result.LocalCount = Func->FuncLexScope.VariablesCount;
+        
+        for(i32 I = Func->LexScopesCount - 1; I >= 0 && Result.BlocksCount < MAX_SCOPE_BLOCKS; I--)
+        {
+            if(DwarfAddressConfinedByLexicalScope(&Func->LexScopes[I], PC))
+            {
+                Result.Blocks[Result.BlocksCount++] = &Func->LexScopes[I];
+            }
+        }
     }
 
     return Result;
 }
 
-static di_variable *
-DwarfFindVariableByNameInScope(scoped_vars Scope, char *Name)
+// NOTE(mateusz): Lexical blocks are stored in DIE order so a block comes before the
+// blocks nested in it, the last one that has the address is the innermost.
+static di_lexical_scope *
+DwarfFindInnermostLexicalScope(di_function *Func, size_t Address)
 {
-    for(u32 I = 0; I < Scope.GlobalCount; I++)
+    for(i32 I = Func->LexScopesCount - 1; I >= 0; I--)
     {
-        if(StringMatches(Name, Scope.Global[I].Name))
+        if(DwarfAddressConfinedByLexicalScope(&Func->LexScopes[I], Address))
         {
-            return &Scope.Global[I];
+            return &Func->LexScopes[I];
         }
     }
+    
+    return &Func->FuncLexScope;
+}
 
-    for(u32 I = 0; I < Scope.ParamCount; I++)
+// NOTE(mateusz): Inner names shadow the outer ones, so the blocks go first, then the
+// function and the compile unit.
+static di_variable *
+DwarfFindVariableByNameInScope(scoped_vars Scope, char *Name)
+{
+    for(u32 Block = 0; Block < Scope.BlocksCount; Block++)
     {
-        if(StringMatches(Name, Scope.Param[I].Name))
+        di_lexical_scope *LexScope = Scope.Blocks[Block];
+        for(u32 I = 0; I < LexScope->VariablesCount; I++)
         {
-            return &Scope.Param[I];
-        }
+            if(StringMatches(Name, LexScope->Variables[I].Name))
+            {
+                return &LexScope->Variables[I];
+            }
+        }
     }
-
+    
     for(u32 I = 0; I < Scope.LocalCount; I++)
     {
         if(StringMatches(Name, Scope.Local[I].Name))
@@ -458,7 +1383,23 @@ DwarfFindVariableByNameInScope(scoped_vars Scope, char *Name)
         }
     }
 
-    return 0x0;
+    for(u32 I = 0; I < Scope.ParamCount; I++)
+    {
+        if(StringMatches(Name, Scope.Param[I].Name))
+        {
+            return &Scope.Param[I];
+        }
+    }
+
+    for(u32 I = 0; I < Scope.GlobalCount; I++)
+    {
+        if(StringMatches(Name, Scope.Global[I].Name))
+        {
+            return &Scope.Global[I];
+        }
+    }
+
+    return DwarfFindGlobalVariableByName(Name);
 }
 
 static char *
@@ -506,6 +1447,23 @@ DwarfGetTypeStringRepresentation(di_underlaying_type Type, arena *Arena)
 }
 
 
+static char *
+DwarfGetTypeString(size_t TypeOffset, arena *Arena)
+{
+    di_type_node *Node = DwarfGetTypeNode(TypeOffset);
+    if(!Node)
+    {
+        return DwarfGetTypeStringRepresentation(DwarfResolveUnderlayingType(TypeOffset), Arena);
+    }
+
+    if(!Node->TypeString)
+    {
+        Node->TypeString = DwarfGetTypeStringRepresentation(Node->Underlaying, &DI->Arena);
+    }
+
+    return Node->TypeString;
+}
+
 static char *
 DwarfBaseTypeToFormatStr(di_base_type *Type, type_flags TFlag)
 {
@@ -587,39 +1545,320 @@ DwarfBaseTypeIsDoubleFloat(di_base_type *Type)
     return Type && Type->Encoding == DW_ATE_float && Type->ByteSize == 8;
 }
 
-static di_struct_member *
-DwarfStructGetMemberByName(di_struct_type *Type, char *Name)
+static u32
+DwarfHashString(char *String)
 {
-    di_struct_member *Result = 0x0;
-    for(u32 I = 0; I < Type->MembersCount; I++)
+    // FNV-1a
+    u32 Result = 2166136261u;
+    for(char *C = String; C[0]; C++)
+    {
+        Result = (Result ^ (u8)C[0]) * 16777619u;
+    }
+
+    return Result;
+}
+
+static char *
+DwarfFindInternedString(char *String)
+{
+    if(!DI->InternedStringsCapacity)
+    {
+        return 0x0;
+    }
+
+    u32 Hash = DwarfHashString(String);
+    u32 Mask = DI->InternedStringsCapacity - 1;
+    for(u32 Slot = Hash & Mask; DI->InternedStrings[Slot].String; Slot = (Slot + 1) & Mask)
     {
-        if(StringMatches(Name, Type->Members[I].Name))
+        di_interned_string *Entry = &DI->InternedStrings[Slot];
+        if(Entry->Hash == Hash && StringMatches(Entry->String, String))
         {
-            Result = &Type->Members[I];
-            break;
+            return Entry->String;
         }
     }
 
-    return Result;
+    return 0x0;
+}
+
+static char *
+DwarfInternString(char *String)
+{
+    char *Found = DwarfFindInternedString(String);
+    if(Found)
+    {
+        return Found;
+    }
+
+    if(DI->InternedStringsCount * 4 >= DI->InternedStringsCapacity * 3)
+    {
+        di_interned_string *Old = DI->InternedStrings;
+        u32 OldCapacity = DI->InternedStringsCapacity;
+
+        DI->InternedStringsCapacity = OldCapacity ? OldCapacity * 2 : DI_INTERNED_STRINGS_INITIAL_CAPACITY;
+        DI->InternedStrings = ArrayPush(&DI->Arena, di_interned_string, DI->InternedStringsCapacity);
+        memset(DI->InternedStrings, 0, sizeof(di_interned_string) * DI->InternedStringsCapacity);
+
+        u32 Mask = DI->InternedStringsCapacity - 1;
+        for(u32 I = 0; I < OldCapacity; I++)
+        {
+            if(Old[I].String)
+            {
+                u32 Slot = Old[I].Hash & Mask;
+                while(DI->InternedStrings[Slot].String)
+                {
+                    Slot = (Slot + 1) & Mask;
+                }
+
+                DI->InternedStrings[Slot] = Old[I];
+            }
+        }
+    }
+
+    u32 Hash = DwarfHashString(String);
+    u32 Mask = DI->InternedStringsCapacity - 1;
+    u32 Slot = Hash & Mask;
+    while(DI->InternedStrings[Slot].String)
+    {
+        Slot = (Slot + 1) & Mask;
+    }
+
+    di_interned_string *Entry = &DI->InternedStrings[Slot];
+    Entry->String = StringDuplicate(&DI->Arena, String);
+    Entry->Hash = Hash;
+    DI->InternedStringsCount += 1;
+
+    return Entry->String;
 }
 
-static di_union_member *
-DwarfUnionGetMemberByName(di_union_type *Type, char *Name)
+static u32
+DwarfHashPointer(void *Ptr)
+{
+    size_t Value = (size_t)Ptr;
+
+    return (u32)((Value >> 3) ^ (Value >> 17)) * 2654435761u;
+}
+
+static void
+DwarfBuildMembersHash(di_aggregate_type *Type)
 {
-    di_union_member *Result = 0x0;
+    u32 Capacity = 4;
+    while(Capacity < Type->MembersCount * 2)
+    {
+        Capacity *= 2;
+    }
 
+    Type->MembersHash = ArrayPush(&DI->Arena, u32, Capacity);
+    memset(Type->MembersHash, 0, sizeof(u32) * Capacity);
+    Type->MembersHashCapacity = Capacity;
+
+    // Slots keep the member index + 1 so that zero is an empty slot
     for(u32 I = 0; I < Type->MembersCount; I++)
     {
-        if(StringMatches(Name, Type->Members[I].Name))
+        u32 Slot = DwarfHashPointer(Type->Members[I].Name) & (Capacity - 1);
+        while(Type->MembersHash[Slot])
         {
-            Result = &Type->Members[I];
-            break;
+            Slot = (Slot + 1) & (Capacity - 1);
+        }
+
+        Type->MembersHash[Slot] = I + 1;
+    }
+}
+
+static di_member *
+DwarfGetMemberByName(di_aggregate_type *Type, char *Name)
+{
+    // A name that was never interned is not a name of any member
+    char *Interned = DwarfFindInternedString(Name);
+    if(!Interned || !Type->MembersCount)
+    {
+        return 0x0;
+    }
+
+    if(!Type->MembersHash)
+    {
+        DwarfBuildMembersHash(Type);
+    }
+
+    u32 Mask = Type->MembersHashCapacity - 1;
+    for(u32 Slot = DwarfHashPointer(Interned) & Mask; Type->MembersHash[Slot]; Slot = (Slot + 1) & Mask)
+    {
+        di_member *Member = &Type->Members[Type->MembersHash[Slot] - 1];
+        if(Member->Name == Interned)
+        {
+            return Member;
+        }
+    }
+
+    return 0x0;
+}
+
+// NOTE(mateusz): A struct that is emplaced in an union gets its own members read
+// before the rest of the members of the union, so the members of one aggregate are
+// not next to each other until they are grouped here with a counting sort.
+static void
+DwarfGroupMembers()
+{
+    u32 AggregatesCount = DI->StructTypesCount + DI->UnionTypesCount;
+    u32 *Firsts = (u32 *)calloc(AggregatesCount + 1, sizeof(u32));
+
+    u32 First = 0;
+    for(u32 I = 0; I < AggregatesCount; I++)
+    {
+        di_aggregate_type *Type = I < DI->StructTypesCount ? &DI->StructTypes[I] : &DI->UnionTypes[I - DI->StructTypesCount];
+        Firsts[I] = First;
+        First += Type->MembersCount;
+    }
+    assert(First == DI->MembersCount);
+
+    di_member *Grouped = ArrayPush(&DI->Arena, di_member, DI->MembersCount);
+    for(u32 I = 0; I < DI->MembersCount; I++)
+    {
+        u32 Owner = DI->MemberOwners[I];
+        u32 Aggregate = (Owner & DI_MEMBER_OWNER_UNION) ? DI->StructTypesCount + (Owner & ~DI_MEMBER_OWNER_UNION) : Owner;
+
+        Grouped[Firsts[Aggregate]++] = DI->Members[I];
+    }
+
+    First = 0;
+    for(u32 I = 0; I < AggregatesCount; I++)
+    {
+        di_aggregate_type *Type = I < DI->StructTypesCount ? &DI->StructTypes[I] : &DI->UnionTypes[I - DI->StructTypesCount];
+        Type->Members = Type->MembersCount ? &Grouped[First] : 0x0;
+        First += Type->MembersCount;
+    }
+
+    free(DI->Members);
+    free(DI->MemberOwners);
+    free(Firsts);
+    DI->Members = Grouped;
+    DI->MemberOwners = 0x0;
+}
+
+// NOTE(mateusz): In DWARF 4 DW_AT_ranges is an offset into .debug_ranges and the
+// entries are relative to the base address of the CU (its DW_AT_low_pc) until a base
+// address selection entry replaces it. DWARF 5 points into .debug_rnglists, with
+// DW_FORM_rnglistx or an offset, and libdwarf gives back the final addresses there.
+static u32
+DwarfReadRanges(Dwarf_Debug Debug, Dwarf_Die DIE, Dwarf_Attribute Attribute, size_t BaseAddress,
+                size_t **LowPCs, size_t **HighPCs)
+{
+    Dwarf_Error Error_ = {};
+    Dwarf_Error *Error = &Error_;
+    u32 Result = 0;
+
+    Dwarf_Half Form = 0;
+    DWARF_CALL(dwarf_whatform(Attribute, &Form, Error));
+
+    Dwarf_Half Version = 0;
+    Dwarf_Half OffsetSize = 0;
+    DWARF_CALL(dwarf_get_version_of_die(DIE, &Version, &OffsetSize));
+
+    if(Form == DW_FORM_rnglistx || Version >= 5)
+    {
+        Dwarf_Unsigned Value = 0;
+        if(Form == DW_FORM_rnglistx)
+        {
+            DWARF_CALL(dwarf_formudata(Attribute, &Value, Error));
+        }
+        else
+        {
+            Dwarf_Off Offset = 0;
+            DWARF_CALL(dwarf_global_formref(Attribute, &Offset, Error));
+            Value = Offset;
+        }
+
+        Dwarf_Rnglists_Head Head = 0x0;
+        Dwarf_Unsigned EntriesCount = 0;
+        Dwarf_Unsigned GlobalOffset = 0;
+        DWARF_CALL(dwarf_rnglists_get_rle_head(Attribute, Form, Value, &Head, &EntriesCount, &GlobalOffset, Error));
+
+        *LowPCs = ArrayPush(&DI->Arena, size_t, EntriesCount);
+        *HighPCs = ArrayPush(&DI->Arena, size_t, EntriesCount);
+
+        for(u32 I = 0; I < EntriesCount; I++)
+        {
+            unsigned int EntryLength = 0;
+            unsigned int Kind = 0;
+            Dwarf_Unsigned Raw1 = 0;
+            Dwarf_Unsigned Raw2 = 0;
+            Dwarf_Bool AddrUnavailable = false;
+            Dwarf_Unsigned LowPC = 0;
+            Dwarf_Unsigned HighPC = 0;
+            DWARF_CALL(dwarf_get_rnglists_entry_fields_a(Head, I, &EntryLength, &Kind, &Raw1, &Raw2,
+                                                         &AddrUnavailable, &LowPC, &HighPC, Error));
+
+            // Base address entries are already applied to the ones that follow them
+            bool IsRange = Kind != DW_RLE_end_of_list && Kind != DW_RLE_base_address &&
+                           Kind != DW_RLE_base_addressx;
+            if(IsRange && !AddrUnavailable)
+            {
+                (*LowPCs)[Result] = LowPC;
+                (*HighPCs)[Result] = HighPC;
+                Result += 1;
+            }
+        }
+
+        dwarf_dealloc_rnglists_head(Head);
+    }
+    else
+    {
+        Dwarf_Ranges *Ranges = 0x0;
+        Dwarf_Signed RangesCount = 0;
+        Dwarf_Unsigned ByteCount = 0;
+
+        Dwarf_Off DebugRangesOffset = 0;
+        DWARF_CALL(dwarf_global_formref(Attribute, &DebugRangesOffset, Error));
+
+        DWARF_CALL(dwarf_get_ranges_a(Debug, DebugRangesOffset, DIE, &Ranges,
+                                      &RangesCount, &ByteCount, Error));
+
+        *LowPCs = ArrayPush(&DI->Arena, size_t, RangesCount);
+        *HighPCs = ArrayPush(&DI->Arena, size_t, RangesCount);
+
+        size_t Base = BaseAddress;
+        for(u32 I = 0; I < RangesCount; I++)
+        {
+            switch(Ranges[I].dwr_type)
+            {
+                case DW_RANGES_ENTRY:
+                {
+                    (*LowPCs)[Result] = Base + Ranges[I].dwr_addr1;
+                    (*HighPCs)[Result] = Base + Ranges[I].dwr_addr2;
+                    Result += 1;
+                }break;
+                case DW_RANGES_ADDRESS_SELECTION:
+                {
+                    Base = Ranges[I].dwr_addr2;
+                }break;
+                case DW_RANGES_END:
+                {
+                    break;
+                }break;
+                default:
+                {
+                    assert(false);
+                };
+            }
         }
     }
 
     return Result;
 }
 
+static void
+DwarfReadLexicalScopeRanges(Dwarf_Debug Debug, Dwarf_Die DIE, Dwarf_Attribute Attribute, di_lexical_scope *LexScope)
+{
+    di_compile_unit *CU = &DI->CompileUnits[DI->CompileUnitsCount - 1];
+    LexScope->RangesCount = DwarfReadRanges(Debug, DIE, Attribute, CU->BaseAddress,
+                                            &LexScope->RangesLowPCs, &LexScope->RangesHighPCs);
+    
+    for(u32 I = 0; I < LexScope->RangesCount; I++)
+    {
+        LexScope->RangesLowPCs[I] += DI->LoadBias;
+        LexScope->RangesHighPCs[I] += DI->LoadBias;
+    }
+}
+
 static bool
 DwarfAddressConfinedByLexicalScope(di_lexical_scope *LexScope, size_t Address)
 {
@@ -632,7 +1871,7 @@ DwarfAddressConfinedByLexicalScope(di_lexical_scope *LexScope, size_t Address)
     {
         for(u32 RIndex = 0; RIndex < LexScope->RangesCount; RIndex++)
         {
-            if(AddressBetween(Address, LexScope->RangesLowPCs[RIndex], LexScope->RangesHighPCs[RIndex]))
+            if(AddressBetween(Address, LexScope->RangesLowPCs[RIndex], LexScope->RangesHighPCs[RIndex] - 1))
             {
                 Result = true;
                 break;
@@ -664,10 +1903,11 @@ static di_compile_unit *
 DwarfFindCompileUnitByAddress(size_t Address)
 {
     di_compile_unit *Result = 0x0;
+    debug_info *ModuleDI = DwarfModuleDebugInfo(Address);
 
-    for(u32 I = 0; I < DI->CompileUnitsCount; I++)
+    for(u32 I = 0; I < ModuleDI->CompileUnitsCount; I++)
     {
-        di_compile_unit *CU = &DI->CompileUnits[I];
+        di_compile_unit *CU = &ModuleDI->CompileUnits[I];
         if(DwarfAddressConfinedByCompileUnit(CU, Address))
         {
             Result = CU;
@@ -722,44 +1962,22 @@ DwarfPushSourceFile(char *Path, u32 SrcLineCount)
     return Result;
 }
 
+// NOTE(mateusz): The debug info handle stays open after DwarfRead, the DIE of a compile
+// unit is read straight from its recorded offset.
 static Dwarf_Die
-DwarfFindDIEByOffset(Dwarf_Debug Debug, Dwarf_Die DIE, size_t Offset)
+DwarfGetCompileUnitDIE(di_compile_unit *CU)
 {
-    Dwarf_Off DIEOffset = 0;
-    DWARF_CALL(dwarf_die_CU_offset(DIE, &DIEOffset, 0x0));
-    Dwarf_Off OverallOffset = 0;
-    DWARF_CALL(dwarf_dieoffset(DIE, &OverallOffset, 0x0));
-    
-    if((OverallOffset - DIEOffset) == Offset)
-    {
-        return DIE;
-    }
-    else
+    Dwarf_Die Result = 0x0;
+    if(!DI->Debug || dwarf_offdie_b(DI->Debug, CU->Offset, true, &Result, 0x0) != DW_DLV_OK)
     {
-        Dwarf_Die ChildDIE = 0;
-        i32 Result = dwarf_child(DIE, &ChildDIE, 0x0);
-        
-        if(Result == DW_DLV_OK)
-        { 
-            return DwarfFindDIEByOffset(Debug, ChildDIE, Offset);
-            Dwarf_Die SiblingDIE = ChildDIE;
-            while(Result == DW_DLV_OK)
-            {
-                DIE = SiblingDIE;
-                Result = dwarf_siblingof(Debug, DIE, &SiblingDIE, 0x0);
-                if(Result == DW_DLV_OK)
-                {
-                    return DwarfFindDIEByOffset(Debug, SiblingDIE, Offset);
-                }
-                else
-                {
-                    return 0x0;
-                }
-            };
-        }
+        return 0x0;
     }
     
-    return 0x0;
+    Dwarf_Half Tag = 0;
+    DWARF_CALL(dwarf_tag(Result, &Tag, 0x0));
+    assert(Tag == DW_TAG_compile_unit);
+    
+    return Result;
 }
 
 static u32
@@ -803,7 +2021,7 @@ DwarfLoadSourceFileByIndex(Dwarf_Line *Lines, u32 LineCount, di_src_file *File,
                 *LineIdxOut = File->SrcLineCount;
             }
 
-            Line.Address = Debugee.Flags.PIE ? Addr + Debugee.LoadAddress : Addr;
+            Line.Address = Addr + DI->LoadBias;
             Line.LineNum = LineNO;
 
             Dwarf_Signed LineOffset = 0;
@@ -819,35 +2037,9 @@ DwarfLoadSourceFileByIndex(Dwarf_Line *Lines, u32 LineCount, di_src_file *File,
 static void
 DwarfLoadSourceFileFromCU(di_compile_unit *CU, di_exec_src_file *File)
 {
-    assert(DwarfOpenSymbolsHandle(&DI->DwarfFd, &DI->Debug));
-    
-    Dwarf_Unsigned CUHeaderLength = 0;
-    Dwarf_Half Version = 0;
-    Dwarf_Unsigned AbbrevOffset = 0;
-    Dwarf_Half AddressSize = 0;
-    Dwarf_Unsigned NextCUHeader = 0;
     Dwarf_Error *Error = 0x0;
     
-    Dwarf_Die SearchDie = 0x0;
-    for(;;)
-    {
-        i32 ResultI = dwarf_next_cu_header(DI->Debug, &CUHeaderLength,
-                                           &Version, &AbbrevOffset, &AddressSize,
-                                           &NextCUHeader, Error);
-                
-        assert(ResultI != DW_DLV_ERROR);
-                
-        Dwarf_Die CurrentDIE = 0;
-        ResultI = dwarf_siblingof(DI->Debug, 0, &CurrentDIE, Error);
-        assert(ResultI != DW_DLV_ERROR && ResultI != DW_DLV_NO_ENTRY);
-                
-        SearchDie = DwarfFindDIEByOffset(DI->Debug, CurrentDIE, CU->Offset);
-        if(SearchDie)
-        {
-            break;
-        }
-    }
-
+    Dwarf_Die SearchDie = DwarfGetCompileUnitDIE(CU);
     if(SearchDie)
     {
         Dwarf_Unsigned Version = 0;
@@ -869,9 +2061,10 @@ DwarfLoadSourceFileFromCU(di_compile_unit *CU, di_exec_src_file *File)
         LOG_DWARF("Pushing source file %s\n", FileName);
 
         DwarfLoadSourceFileByIndex(LineBuffer, LineCount, NewFile, File->DwarfIndex);
+        
+        dwarf_srclines_dealloc_b(LineCtx);
+        dwarf_dealloc(DI->Debug, SearchDie, DW_DLA_DIE);
     }
-
-    DwarfCloseSymbolsHandle(&DI->DwarfFd, &DI->Debug);
 }
 
 static bool
@@ -879,19 +2072,11 @@ DwarfLoadSourceFileByAddress(size_t Address, u32 *FileIdxOut, u32 *LineIdxOut)
 {
     bool Result = false;
     
-    assert(DwarfOpenSymbolsHandle(&DI->DwarfFd, &DI->Debug));
-
     LOG_DWARF("Loading source that contains address %lx\n", Address);
     
-    Dwarf_Unsigned CUHeaderLength = 0;
-    Dwarf_Half Version = 0;
-    Dwarf_Unsigned AbbrevOffset = 0;
-    Dwarf_Half AddressSize = 0;
-    Dwarf_Unsigned NextCUHeader = 0;
     Dwarf_Error *Error = 0x0;
     
-    size_t CUDIEOffset = 0;
-    bool CUFound = false;
+    di_compile_unit *FoundCU = 0x0;
     if(DI->CompileUnitsCount > 0)
     {
         LOG_DWARF("Searching for CU\n");
@@ -907,45 +2092,20 @@ DwarfLoadSourceFileByAddress(size_t Address, u32 *FileIdxOut, u32 *LineIdxOut)
                 
                 if(AddressBetween(Address, LowPC, HighPC))
                 {
-                    CUDIEOffset = CompUnit->Offset;
-                    CUFound = true;
+                    FoundCU = CompUnit;
                     LOG_DWARF("LowPC is %lx, HighPC is %lx\n", LowPC, HighPC);
                 }
             }
         }
 
-        if(CUFound)
+        if(FoundCU)
         {
-            LOG_DWARF("Found CU with offset %lx\n", CUDIEOffset);
-            LOG_DWARF("Searching for that DIE\n");
+            LOG_DWARF("Found CU with offset %lx\n", FoundCU->Offset);
 
-            Dwarf_Die SearchDie = 0x0;
-            
-            for(;;)
-            {
-                i32 ResultI = dwarf_next_cu_header(DI->Debug, &CUHeaderLength,
-                                                   &Version, &AbbrevOffset, &AddressSize,
-                                                   &NextCUHeader, Error);
-                
-                assert(ResultI != DW_DLV_ERROR);
-                
-                Dwarf_Die CurrentDIE = 0;
-                Result = dwarf_siblingof(DI->Debug, 0, &CurrentDIE, Error);
-                assert(ResultI != DW_DLV_ERROR && ResultI != DW_DLV_NO_ENTRY);
-                
-                SearchDie = DwarfFindDIEByOffset(DI->Debug, CurrentDIE, CUDIEOffset);
-                if(SearchDie)
-                {
-                    break;
-                }
-            }
-            
+            Dwarf_Die SearchDie = DwarfGetCompileUnitDIE(FoundCU);
             if(SearchDie)
             {
                 LOG_DWARF("Found DIE\n");
-                Dwarf_Half Tag = 0;
-                DWARF_CALL(dwarf_tag(SearchDie, &Tag, 0x0));
-                assert(Tag == DW_TAG_compile_unit);
                 
                 Dwarf_Unsigned Version = 0;
                 Dwarf_Small TableType = 0;
@@ -970,7 +2130,7 @@ DwarfLoadSourceFileByAddress(size_t Address, u32 *FileIdxOut, u32 *LineIdxOut)
 
                     // NOTE(mateusz): LineAddresses are as offsets, we need them in the address
                     // space of the exectuable.
-                    LineAddr = Debugee.Flags.PIE ? LineAddr + Debugee.LoadAddress : LineAddr;
+                    LineAddr = LineAddr + DI->LoadBias;
                     
                     if(Address == LineAddr)
                     {
@@ -993,15 +2153,17 @@ DwarfLoadSourceFileByAddress(size_t Address, u32 *FileIdxOut, u32 *LineIdxOut)
                         break;
                     }
                 }
+                
+                dwarf_srclines_dealloc_b(LineCtx);
+                dwarf_dealloc(DI->Debug, SearchDie, DW_DLA_DIE);
             }
         }
     }
     
-    DwarfCloseSymbolsHandle(&DI->DwarfFd, &DI->Debug);
-    
     return Result;
 }
 
+// NOTE(mateusz): The range is empty if there is no line at the address
 static address_range
 DwarfGetAddressRangeUntilNextLine(size_t StartAddress)
 {
@@ -1011,7 +2173,7 @@ DwarfGetAddressRangeUntilNextLine(size_t StartAddress)
     if(!Current)
     {
         LOG_DWARF("Didn't find line with address = %lx\n", StartAddress);
-        assert(false);
+        return Result;
     }
     di_src_file *File = &DI->SourceFiles[Current->SrcFileIndex];
 LOG_DWARF("Current->Address = %lx, Current->SrcFileIndex = %d\n", Current->Address, Current->SrcFileIndex);
@@ -1023,7 +2185,7 @@ LOG_DWARF("Current->Address = %lx, Current->SrcFileIndex = %d\n", Current->Addre
         {
             di_function *Func = DwarfFindFunctionByAddress(Current->Address);
             Result.Start = Current->Address;
-            Result.End = Func->FuncLexScope.HighPC;
+            Result.End = Func ? Func->FuncLexScope.HighPC : Current->Address;
             break;
         }
         else
@@ -1067,8 +2229,13 @@ DwarfIsExectuablePIE()
 {
     bool Result = false;
 
+    // NOTE(mateusz): Read from the running image, an attached process could have
+    // its executable replaced on the disk.
+    char ExePath[64] = {};
+    sprintf(ExePath, "/proc/%d/exe", Debugee.PID);
+
     Elf *ElfHandle = 0x0;
-    int BinaryFD = open(Debugee.ProgramPath, O_RDONLY);
+    int BinaryFD = open(ExePath, O_RDONLY);
     assert(BinaryFD > 0);
 
     assert(elf_version(EV_CURRENT) != EV_NONE);
@@ -1110,47 +2277,341 @@ DwarfIsExectuablePIE()
     }
 
     elf_end(ElfHandle);
+    close(BinaryFD);
     
     return Result;
 }
 
-static void
-DwarfReadDIE(Dwarf_Debug Debug, Dwarf_Die DIE)
+// NOTE(mateusz): Counts the symbols and the size of their names when Result is null
+static u32
+DwarfCollectElfSymbols(di_elf_file *File, size_t LoadBias, elf_symbol *Result, char *Names, u32 *NamesSize)
 {
-    Dwarf_Error Error_ = {};
-    Dwarf_Error *Error = &Error_;
-    Dwarf_Die CurrentDIE = DIE;
+    u32 Count = 0;
     
-    Dwarf_Half Tag = 0;
-    assert(dwarf_tag(CurrentDIE, &Tag, Error) == DW_DLV_OK);
-    
-    switch(Tag)
+    for(Elf_Scn *ElfScn = 0x0; (ElfScn = elf_nextscn(File->ElfHandle, ElfScn));)
     {
-        case DW_TAG_compile_unit:
+        Elf64_Shdr *SectionHeader = elf64_getshdr(ElfScn);
+        if(SectionHeader->sh_type != SHT_SYMTAB && SectionHeader->sh_type != SHT_DYNSYM)
         {
-            LOG_DWARF("libdwarf: Compile Unit\n");
-            Dwarf_Signed AttrCount = 0;
-            Dwarf_Attribute *AttrList = {};
-            DWARF_CALL(dwarf_attrlist(DIE, &AttrList, &AttrCount, Error));
-            
-            di_compile_unit *CompUnit = &DI->CompileUnits[DI->CompileUnitsCount++];
-
-            Dwarf_Off OverallOffset = 0;
-            DWARF_CALL(dwarf_dieoffset(DIE, &OverallOffset, Error));
-            Dwarf_Off DIEOffset = 0;
-            DWARF_CALL(dwarf_die_CU_offset(DIE, &DIEOffset, 0x0));
+            continue;
+        }
+        
+        Elf_Data *Data = elf_getdata(ElfScn, 0x0);
+        if(!Data)
+        {
+            continue;
+        }
+        
+        Elf64_Sym *Symbols = (Elf64_Sym *)Data->d_buf;
+        size_t SymbolsCount = Data->d_size / sizeof(Elf64_Sym);
+        for(size_t I = 0; I < SymbolsCount; I++)
+        {
+            Elf64_Sym *Symbol = &Symbols[I];
+            u32 Type = ELF64_ST_TYPE(Symbol->st_info);
+            bool Function = Type == STT_FUNC || Type == STT_GNU_IFUNC;
+            if(!Function || Symbol->st_value == 0 || Symbol->st_shndx == SHN_UNDEF)
+            {
+                continue;
+            }
             
-            CompUnit->Offset = OverallOffset - DIEOffset;
+            char *Name = elf_strptr(File->ElfHandle, SectionHeader->sh_link, Symbol->st_name);
+            if(!Name || !Name[0])
+            {
+                continue;
+            }
             
-            for(u32 I = 0; I < AttrCount; I++)
+            if(Result)
             {
-                Dwarf_Attribute Attribute = AttrList[I];
-                Dwarf_Half AttrTag = 0;
-                DWARF_CALL(dwarf_whatattr(Attribute, &AttrTag, Error));
-                
-                switch(AttrTag)
-                {
-                    case DW_AT_name:
+                elf_symbol *Entry = &Result[Count];
+                Entry->Address = Symbol->st_value + LoadBias;
+                Entry->Size = Symbol->st_size;
+                Entry->NameOffset = *NamesSize;
+                StringCopy(&Names[*NamesSize], Name);
+            }
+            
+            *NamesSize += strlen(Name) + 1;
+            Count++;
+        }
+    }
+    
+    return Count;
+}
+
+static int
+DwarfCompareElfSymbols(const void *A, const void *B)
+{
+    size_t AddressA = ((elf_symbol *)A)->Address;
+    size_t AddressB = ((elf_symbol *)B)->Address;
+    
+    return AddressA < AddressB ? -1 : (AddressA > AddressB ? 1 : 0);
+}
+
+// NOTE(mateusz): .dynsym is read from the module itself, .symtab can also be in the
+// separate debug file of a stripped module.
+static void
+DwarfReadElfSymbols(debug_info *ModuleDI)
+{
+    char *Paths[2] = { ModuleDI->Path, 0x0 };
+    if(ModuleDI->SymbolsPath && !StringMatches(ModuleDI->SymbolsPath, ModuleDI->Path))
+    {
+        Paths[1] = ModuleDI->SymbolsPath;
+    }
+    
+    elf_symbol *Symbols = 0x0;
+    char *Names = 0x0;
+    u32 Count = 0;
+    u32 NamesSize = 0;
+    
+    // One file at a time, opening the next one can reuse the cache slot of the previous
+    for(u32 I = 0; I < ARRAY_LENGTH(Paths); I++)
+    {
+        di_elf_file *File = Paths[I] ? DwarfOpenElfFile(Paths[I]) : 0x0;
+        if(!File)
+        {
+            continue;
+        }
+        
+        u32 FileNamesSize = 0;
+        u32 FileCount = DwarfCollectElfSymbols(File, ModuleDI->LoadBias, 0x0, 0x0, &FileNamesSize);
+        
+        Symbols = (elf_symbol *)realloc(Symbols, (Count + FileCount) * sizeof(elf_symbol));
+        Names = (char *)realloc(Names, NamesSize + FileNamesSize);
+        Count += DwarfCollectElfSymbols(File, ModuleDI->LoadBias, &Symbols[Count], Names, &NamesSize);
+    }
+    
+    if(!Count)
+    {
+        free(Symbols);
+        free(Names);
+        return;
+    }
+    
+    qsort(Symbols, Count, sizeof(elf_symbol), DwarfCompareElfSymbols);
+    
+    // Both tables list most of the functions, aliases and duplicates are dropped
+    u32 Unique = 0;
+    for(u32 I = 0; I < Count; I++)
+    {
+        if(Unique > 0 && Symbols[Unique - 1].Address == Symbols[I].Address)
+        {
+            Symbols[Unique - 1].Size = MAX(Symbols[Unique - 1].Size, Symbols[I].Size);
+            continue;
+        }
+        
+        Symbols[Unique++] = Symbols[I];
+    }
+    
+    ModuleDI->ElfSymbols = Symbols;
+    ModuleDI->ElfSymbolsCount = Unique;
+    ModuleDI->ElfSymbolNames = Names;
+    LOG_DWARF("Read %u ELF symbols of %s\n", Unique, ModuleDI->Path);
+}
+
+static char *
+DwarfFindElfSymbolByAddress(size_t Address, size_t *Offset)
+{
+    di_module *Module = DwarfFindModuleByAddress(Address);
+    if(!Module)
+    {
+        return 0x0;
+    }
+    
+    debug_info *ModuleDI = &Module->DI;
+    if(!ModuleDI->ElfSymbolsRead)
+    {
+        ModuleDI->ElfSymbolsRead = true;
+        DwarfModuleFindSymbols(Module);
+        DwarfReadElfSymbols(ModuleDI);
+    }
+    
+    // Last symbol that starts at or before the address
+    u32 Low = 0;
+    u32 High = ModuleDI->ElfSymbolsCount;
+    while(Low < High)
+    {
+        u32 Mid = Low + (High - Low) / 2;
+        if(ModuleDI->ElfSymbols[Mid].Address <= Address)
+        {
+            Low = Mid + 1;
+        }
+        else
+        {
+            High = Mid;
+        }
+    }
+    
+    if(Low == 0)
+    {
+        return 0x0;
+    }
+    
+    // Symbols without a size cover everything up to the next one
+    elf_symbol *Symbol = &ModuleDI->ElfSymbols[Low - 1];
+    if(Symbol->Size && Address >= Symbol->Address + Symbol->Size)
+    {
+        return 0x0;
+    }
+    
+    *Offset = Address - Symbol->Address;
+    return ModuleDI->ElfSymbolNames + Symbol->NameOffset;
+}
+
+// NOTE(mateusz): Stripped binaries keep their DWARF in a separate file, looked up
+// by the build-id first and by the .gnu_debuglink name next. Result is Path
+// itself when the binary has its own .debug_info or nothing was found.
+static void
+DwarfFindSymbolsPath(char *Path, char *Result)
+{
+    StringCopy(Result, Path);
+    
+    i32 BinaryFD = open(Path, O_RDONLY);
+    if(BinaryFD == -1)
+    {
+        return;
+    }
+    
+    assert(elf_version(EV_CURRENT) != EV_NONE);
+    Elf *ElfHandle = elf_begin(BinaryFD, ELF_C_READ, 0x0);
+    size_t StringsIndex = 0;
+    if(!ElfHandle || elf_getshdrstrndx(ElfHandle, &StringsIndex) != 0)
+    {
+        if(ElfHandle) { elf_end(ElfHandle); }
+        close(BinaryFD);
+        return;
+    }
+    
+    bool HasDebugInfo = false;
+    u8 *BuildID = 0x0;
+    u32 BuildIDSize = 0;
+    char *DebugLink = 0x0;
+    
+    Elf_Scn *ElfScn = 0x0;
+    while((ElfScn = elf_nextscn(ElfHandle, ElfScn)))
+    {
+        Elf64_Shdr *SectionHeader = elf64_getshdr(ElfScn);
+        char *Name = elf_strptr(ElfHandle, StringsIndex, SectionHeader->sh_name);
+        if(!Name)
+        {
+            continue;
+        }
+        
+        if(StringMatches(Name, ".debug_info"))
+        {
+            HasDebugInfo = SectionHeader->sh_type != SHT_NOBITS;
+        }
+        else if(StringMatches(Name, ".gnu_debuglink"))
+        {
+            Elf_Data *Data = elf_getdata(ElfScn, 0x0);
+            DebugLink = Data ? (char *)Data->d_buf : 0x0;
+        }
+        else if(SectionHeader->sh_type == SHT_NOTE)
+        {
+            Elf_Data *Data = elf_getdata(ElfScn, 0x0);
+            for(size_t Offset = 0; Data && Offset + sizeof(Elf64_Nhdr) <= Data->d_size;)
+            {
+                Elf64_Nhdr *Note = (Elf64_Nhdr *)((u8 *)Data->d_buf + Offset);
+                u8 *NoteName = (u8 *)(Note + 1);
+                u8 *Desc = NoteName + ((Note->n_namesz + 3) & ~3);
+                if(Note->n_type == NT_GNU_BUILD_ID && Note->n_namesz == 4 && memcmp(NoteName, "GNU", 4) == 0)
+                {
+                    BuildID = Desc;
+                    BuildIDSize = Note->n_descsz;
+                }
+                
+                Offset += sizeof(Elf64_Nhdr) + ((Note->n_namesz + 3) & ~3) + ((Note->n_descsz + 3) & ~3);
+            }
+        }
+    }
+    
+    if(!HasDebugInfo)
+    {
+        char Candidate[PATH_MAX] = {};
+        bool Found = false;
+        
+        if(BuildID && BuildIDSize >= 2)
+        {
+            char *WriteHead = Candidate;
+            WriteHead += sprintf(WriteHead, "/usr/lib/debug/.build-id/%02x/", BuildID[0]);
+            for(u32 I = 1; I < BuildIDSize; I++)
+            {
+                WriteHead += sprintf(WriteHead, "%02x", BuildID[I]);
+            }
+            sprintf(WriteHead, ".debug");
+            
+            Found = access(Candidate, R_OK) == 0;
+        }
+        
+        if(!Found && DebugLink)
+        {
+            char Dir[PATH_MAX] = {};
+            StringCopy(Dir, Path);
+            char *LastSlash = StringFindLastChar(Dir, '/');
+            if(LastSlash)
+            {
+                LastSlash[0] = '\0';
+            }
+            
+            char *Formats[] = { "%s/%s", "%s/.debug/%s", "/usr/lib/debug%s/%s" };
+            for(u32 I = 0; I < ARRAY_LENGTH(Formats) && !Found; I++)
+            {
+                snprintf(Candidate, sizeof(Candidate), Formats[I], Dir, DebugLink);
+                Found = access(Candidate, R_OK) == 0 && !StringMatches(Candidate, Path);
+            }
+        }
+        
+        if(Found)
+        {
+            LOG_DWARF("Symbols of %s are read from %s\n", Path, Candidate);
+            StringCopy(Result, Candidate);
+        }
+    }
+    
+    elf_end(ElfHandle);
+    close(BinaryFD);
+}
+
+static void
+DwarfReadDIE(Dwarf_Debug Debug, Dwarf_Die DIE)
+{
+    Dwarf_Error Error_ = {};
+    Dwarf_Error *Error = &Error_;
+    Dwarf_Die CurrentDIE = DIE;
+    
+    Dwarf_Half Tag = 0;
+    assert(dwarf_tag(CurrentDIE, &Tag, Error) == DW_DLV_OK);
+    
+    switch(Tag)
+    {
+        case DW_TAG_compile_unit:
+        {
+            LOG_DWARF("libdwarf: Compile Unit\n");
+            Dwarf_Signed AttrCount = 0;
+            Dwarf_Attribute *AttrList = {};
+            DWARF_CALL(dwarf_attrlist(DIE, &AttrList, &AttrCount, Error));
+            
+            di_compile_unit *CompUnit = &DI->CompileUnits[DI->CompileUnitsCount++];
+
+            Dwarf_Off OverallOffset = 0;
+            DWARF_CALL(dwarf_dieoffset(DIE, &OverallOffset, Error));
+            
+            CompUnit->Offset = OverallOffset;
+
+            // The base the ranges are relative to, the attribute can come after them
+            Dwarf_Addr BaseAddress = 0x0;
+            if(dwarf_lowpc(DIE, &BaseAddress, Error) == DW_DLV_OK)
+            {
+                CompUnit->BaseAddress = BaseAddress;
+            }
+            
+            for(u32 I = 0; I < AttrCount; I++)
+            {
+                Dwarf_Attribute Attribute = AttrList[I];
+                Dwarf_Half AttrTag = 0;
+                DWARF_CALL(dwarf_whatattr(Attribute, &AttrTag, Error));
+                
+                switch(AttrTag)
+                {
+                    case DW_AT_name:
                     {
                         char *Name = 0x0;
                         DWARF_CALL(dwarf_formstring(Attribute, &Name, Error));
@@ -1179,9 +2640,8 @@ Taken from glfwFramework:
                     DW_AT_low_pc                0x00000000
                     DW_AT_stmt_list             0x00000000
 
-sometimes there are ranges which also have a low_pc which I guess is always zero
-it's weird so I'm just going to assume that it's always zero and if already
-ranges have been read then don't read the low-high
+sometimes there are ranges which also have a low_pc, then it is only the base
+address of the ranges (read before the attributes) and the low-high is not read
 
 */
                         if(CompUnit->RangesCount == 0)
@@ -1191,12 +2651,6 @@ ranges have been read then don't read the low-high
                             Dwarf_Addr *WritePoint = (Dwarf_Addr *)CompUnit->RangesLowPCs;
                             DWARF_CALL(dwarf_formaddr(Attribute, WritePoint, Error));
                         }
-                        else
-                        {
-                            Dwarf_Addr WritePoint;
-                            DWARF_CALL(dwarf_formaddr(Attribute, &WritePoint, Error));
-                            assert(WritePoint == 0x0);
-                        }
                     }break;
                     case DW_AT_high_pc:
                     {
@@ -1221,47 +2675,8 @@ ranges have been read then don't read the low-high
                     }break;
                     case DW_AT_ranges:
                     {
-                        Dwarf_Ranges *Ranges = 0x0;
-                        Dwarf_Signed RangesCount = 0;
-                        Dwarf_Unsigned ByteCount = 0;
-                        CompUnit->RangesCount = 0;
-                        Dwarf_Off DebugRangesOffset = 0;
-                        DWARF_CALL(dwarf_global_formref(Attribute, &DebugRangesOffset, Error));
-                        
-                        DWARF_CALL(dwarf_get_ranges_a(Debug, DebugRangesOffset, DIE, &Ranges,
-                                                      &RangesCount, &ByteCount, Error));
-                        
-                        CompUnit->RangesLowPCs = ArrayPush(&DI->Arena, size_t, RangesCount);
-                        CompUnit->RangesHighPCs = ArrayPush(&DI->Arena, size_t, RangesCount);
-                        
-                        size_t SelectedAddress = 0x0;
-                        for(u32 I = 0; I < RangesCount; I++)
-                        {
-                            switch(Ranges[I].dwr_type)
-                            {
-                                case DW_RANGES_ENTRY:
-                                {
-                                    size_t RLowPC = Ranges[I].dwr_addr1 + SelectedAddress;
-                                    size_t RHighPC = Ranges[I].dwr_addr2 + SelectedAddress;
-                                    
-                                    u32 RIndex = CompUnit->RangesCount++;
-                                    CompUnit->RangesLowPCs[RIndex] = RLowPC;
-                                    CompUnit->RangesHighPCs[RIndex] = RHighPC;
-                                }break;
-                                case DW_RANGES_ADDRESS_SELECTION:
-                                {
-                                    SelectedAddress = Ranges[I].dwr_addr2;
-                                }break;
-                                case DW_RANGES_END:
-                                {
-                                    break;
-                                }break;
-                                default:
-                                {
-                                    assert(false);
-                                };
-                            }
-                        }
+                        CompUnit->RangesCount = DwarfReadRanges(Debug, DIE, Attribute, CompUnit->BaseAddress,
+                                                                &CompUnit->RangesLowPCs, &CompUnit->RangesHighPCs);
                         
                         CompUnit->Flags |= DI_COMP_UNIT_HAS_RANGES;
                     }break;
@@ -1353,14 +2768,10 @@ ranges have been read then don't read the low-high
 
             // NOTE(mateusz): We read offsets, now add to them the load address so they represent the
             // the actual address inside the running excutable.
-            if(Debugee.Flags.PIE)
+            for(u32 I = 0; I < CompUnit->RangesCount; I++)
             {
-                for(u32 I = 0; I < CompUnit->RangesCount; I++)
-                {
-                    assert(Debugee.LoadAddress != 0x0);
-                    CompUnit->RangesLowPCs[I] += Debugee.LoadAddress;
-                    CompUnit->RangesHighPCs[I] += Debugee.LoadAddress;
-                }
+                CompUnit->RangesLowPCs[I] += DI->LoadBias;
+                CompUnit->RangesHighPCs[I] += DI->LoadBias;
             }
         }break;
         case DW_TAG_subprogram:
@@ -1400,7 +2811,7 @@ ranges have been read then don't read the low-high
                     case DW_AT_type:
                     {
                         Dwarf_Off Offset = 0;
-                        DWARF_CALL(dwarf_dietype_offset(CurrentDIE, &Offset, Error));
+                        DWARF_CALL(DwarfDIETypeOffset(CurrentDIE, &Offset, Error));
                         
                         Func->TypeOffset = Offset;
                     }break;
@@ -1420,47 +2831,24 @@ ranges have been read then don't read the low-high
                             LexScope->HighPC += LexScope->LowPC;
                         }
                     }break;
-                    case DW_AT_frame_base:
+                    case DW_AT_ranges:
                     {
-                        Dwarf_Loc_Head_c LocListHead = {};
-                        Dwarf_Unsigned LocCount = 0;
-                        DWARF_CALL(dwarf_get_loclist_c(Attribute, &LocListHead, &LocCount, Error));
-                        
-                        assert(LocCount == 1);
-                        for(u32 I = 0; I < LocCount; I++)
+                        // NOTE(mateusz): Functions split into a hot and a cold part
+                        DwarfReadLexicalScopeRanges(Debug, DIE, Attribute, LexScope);
+                    }break;
+                    case DW_AT_abstract_origin:
+                    {
+                        // NOTE(mateusz): Out of line copies of inline functions only
+                        // point to the abstract instance that carries the name
+                        if(!Func->Name)
                         {
-                            Dwarf_Small LLEOut = 0;
-                            Dwarf_Addr LowPC = 0;
-                            Dwarf_Addr HighPC = 0;
-                            Dwarf_Unsigned LocListCountOut = 0;
-                            Dwarf_Locdesc_c IDK = 0;
-                            Dwarf_Small LocListSourceOut = 0;
-                            Dwarf_Unsigned ExpressionOffsetOut = 0;
-                            Dwarf_Unsigned LocDescOffsetOut = 0;
-                            
-                            DWARF_CALL(dwarf_get_locdesc_entry_c(LocListHead, I, &LLEOut, &LowPC, &HighPC, &LocListCountOut, &IDK, &LocListSourceOut, &ExpressionOffsetOut, 
-                                                                 &LocDescOffsetOut, Error));
-                            
-                            Dwarf_Small AtomOut = 0;
-                            Dwarf_Unsigned Operand1 = 0;
-                            Dwarf_Unsigned Operand2 = 0;
-                            Dwarf_Unsigned Operand3 = 0;
-                            Dwarf_Unsigned OffsetBranch = 0;
-                            DWARF_CALL(dwarf_get_location_op_value_c(IDK, I, &AtomOut, &Operand1, &Operand2, &Operand3, &OffsetBranch, Error));
-                            
-                            LOG_DWARF("AtomOut = %d, Oper1 = %lld, Oper2 = %llu, Oper3 = %llu, OffsetBranch = %llu\n", AtomOut, Operand1, Operand2, Operand3, OffsetBranch);
-                            
-                            if(AtomOut != DW_OP_call_frame_cfa)
-                            {
-                                const char *OpName = 0x0;
-                                dwarf_get_OP_name(AtomOut, &OpName);
-
-                                LOG_DWARF("AtomOut is = %d, %s\n", AtomOut, OpName);
-                                assert(!"Call frame is not CFA");
-                            }
-                            Func->FrameBaseIsCFA = true;
+                            Func->Name = DwarfGetAbstractOriginName(Debug, Attribute);
                         }
                     }break;
+                    case DW_AT_frame_base:
+                    {
+                        DwarfDecodeLocation(DIE, Attribute, &Func->FrameBase);
+                    }break;
                     default:
                     {
                         bool ignored = AttrTag == DW_AT_decl_file ||
@@ -1481,10 +2869,15 @@ ranges have been read then don't read the low-high
                 }
             }
 
-            if(Debugee.Flags.PIE)
+            Func->FuncLexScope.LowPC += DI->LoadBias;
+            Func->FuncLexScope.HighPC += DI->LoadBias;
+            
+            // NOTE(mateusz): The first range is the one with the entry, it stands in for
+            // the function where a single range is needed (breakpoints on the function).
+            if(LexScope->RangesCount)
             {
-                Func->FuncLexScope.LowPC += Debugee.LoadAddress;
-                Func->FuncLexScope.HighPC += Debugee.LoadAddress;
+                LexScope->LowPC = LexScope->RangesLowPCs[0];
+                LexScope->HighPC = LexScope->RangesHighPCs[0];
             }
         }break;
         case DW_TAG_lexical_block:
@@ -1518,49 +2911,7 @@ ranges have been read then don't read the low-high
                 {
                     case DW_AT_ranges:
                     {
-                        Dwarf_Ranges *Ranges = 0x0;
-                        Dwarf_Signed RangesCount = 0;
-                        Dwarf_Unsigned ByteCount = 0;
-                        
-                        Dwarf_Off DebugRangesOffset = 0;
-                        DWARF_CALL(dwarf_global_formref(Attribute, &DebugRangesOffset, Error));
-                        
-                        DWARF_CALL(dwarf_get_ranges_a(Debug, DebugRangesOffset, DIE, &Ranges,
-                                                      &RangesCount, &ByteCount, Error));
-                        
-                        LexScope->RangesLowPCs = ArrayPush(&DI->Arena, size_t, RangesCount);
-                        LexScope->RangesHighPCs = ArrayPush(&DI->Arena, size_t, RangesCount);
-                        
-                        di_compile_unit *CU = &DI->CompileUnits[DI->CompileUnitsCount - 1];
-                        size_t SelectedAddress = 0x0;
-                        for(u32 I = 0; I < RangesCount; I++)
-                        {
-                            switch(Ranges[I].dwr_type)
-                            {
-                                case DW_RANGES_ENTRY:
-                                {
-                                    assert(CU->RangesCount >= 1);
-                                    size_t RLowPC = CU->RangesLowPCs[0] + Ranges[I].dwr_addr1 + SelectedAddress;
-                                    size_t RHighPC = CU->RangesLowPCs[0] + Ranges[I].dwr_addr2 + SelectedAddress;
-                                    
-                                    u32 RIndex = LexScope->RangesCount++;
-                                    LexScope->RangesLowPCs[RIndex] = RLowPC;
-                                    LexScope->RangesHighPCs[RIndex] = RHighPC;
-                                }break;
-                                case DW_RANGES_ADDRESS_SELECTION:
-                                {
-                                    SelectedAddress = Ranges[I].dwr_addr2;
-                                }break;
-                                case DW_RANGES_END:
-                                {
-                                    break;
-                                }break;
-                                default:
-                                {
-                                    assert(false);
-                                };
-                            }
-                        }
+                        DwarfReadLexicalScopeRanges(Debug, DIE, Attribute, LexScope);
                     }break;
                     case DW_AT_low_pc:
                     {
@@ -1595,10 +2946,98 @@ ranges have been read then don't read the low-high
                 }
             }
 
-            if(Debugee.Flags.PIE)
+            LexScope->LowPC += DI->LoadBias;
+            LexScope->HighPC += DI->LoadBias;
+        }break;
+        case DW_TAG_inlined_subroutine:
+        {
+            LOG_DWARF("libdwarf: Inlined subroutine\n");
+            
+            Dwarf_Signed AttrCount = 0;
+            Dwarf_Attribute *AttrList = {};
+            if(dwarf_attrlist(DIE, &AttrList, &AttrCount, Error) != DW_DLV_OK)
+                break;
+            
+            assert(DI->FunctionsCount);
+            
+            di_inlined_call *Call = &DI->InlinedCalls[DI->InlinedCallsCount++];
+            di_lexical_scope *LexScope = &Call->LexScope;
+            di_function *Func = &DI->Functions[DI->FunctionsCount - 1];
+            if(!Func->InlinedCalls)
+            {
+                Func->InlinedCalls = Call;
+            }
+            
+            Func->InlinedCallsCount += 1;
+            
+            for(u32 I = 0; I < AttrCount; I++)
+            {
+                Dwarf_Attribute Attribute = AttrList[I];
+                Dwarf_Half AttrTag = 0;
+                DWARF_CALL(dwarf_whatattr(Attribute, &AttrTag, Error));
+                
+                switch(AttrTag)
+                {
+                    case DW_AT_abstract_origin:
+                    {
+                        Call->Name = DwarfGetAbstractOriginName(Debug, Attribute);
+                    }break;
+                    case DW_AT_call_line:
+                    {
+                        Dwarf_Unsigned CallLine = 0;
+                        DWARF_CALL(dwarf_formudata(Attribute, &CallLine, Error));
+                        Call->CallLine = CallLine;
+                    }break;
+                    case DW_AT_ranges:
+                    {
+                        DwarfReadLexicalScopeRanges(Debug, DIE, Attribute, LexScope);
+                    }break;
+                    case DW_AT_low_pc:
+                    {
+                        Dwarf_Addr *WritePoint = (Dwarf_Addr *)&LexScope->LowPC;
+                        DWARF_CALL(dwarf_formaddr(Attribute, WritePoint, Error));
+                    }break;
+                    case DW_AT_high_pc:
+                    {
+                        Dwarf_Addr *WritePoint = (Dwarf_Addr *)&LexScope->HighPC;
+                        
+                        Dwarf_Half Form = 0;
+                        Dwarf_Form_Class FormType = {};
+                        DWARF_CALL(dwarf_highpc_b(DIE, WritePoint, &Form, &FormType, 0x0));
+                        if (FormType == DW_FORM_CLASS_CONSTANT) {
+                            LexScope->HighPC += LexScope->LowPC;
+                        }
+                    }break;
+                    default:
+                    {
+                        bool ignored = AttrTag == DW_AT_call_file ||
+                            AttrTag == DW_AT_call_column ||
+                            AttrTag == DW_AT_entry_pc ||
+                            AttrTag == DW_AT_GNU_discriminator ||
+                            AttrTag == DW_AT_sibling;
+                        
+                        if(!ignored)
+                        {
+                            const char *AttrName = 0x0;
+                            DWARF_CALL(dwarf_get_AT_name(AttrTag, &AttrName));
+                            LOG_DWARF("Inlined Subroutine Unhandled Attribute: %s\n", AttrName);
+                        }
+                    }break;
+                }
+            }
+
+            LexScope->LowPC += DI->LoadBias;
+            LexScope->HighPC += DI->LoadBias;
+
+            // NOTE(mateusz): Calls that contain this one were read before it
+            size_t CallStart = LexScope->RangesCount ? LexScope->RangesLowPCs[0] : LexScope->LowPC;
+            Call->Depth = 1;
+            for(u32 I = 0; I < Func->InlinedCallsCount - 1; I++)
             {
-                LexScope->LowPC += Debugee.LoadAddress;
-                LexScope->HighPC += Debugee.LoadAddress;
+                if(DwarfAddressConfinedByLexicalScope(&Func->InlinedCalls[I].LexScope, CallStart))
+                {
+                    Call->Depth += 1;
+                }
             }
         }break;
         case DW_TAG_variable:
@@ -1658,45 +3097,14 @@ ranges have been read then don't read the low-high
                     case DW_AT_type:
                         {
                             Dwarf_Off Offset = 0;
-                            DWARF_CALL(dwarf_dietype_offset(CurrentDIE, &Offset, Error));
+                            DWARF_CALL(DwarfDIETypeOffset(CurrentDIE, &Offset, Error));
 
                             Var->TypeOffset = Offset;
                         }break;
                     case DW_AT_location:
-                        {
-                            Dwarf_Loc_Head_c LocListHead = {};
-                            Dwarf_Unsigned LocCount = 0;
-                            DWARF_CALL(dwarf_get_loclist_c(Attribute, &LocListHead, &LocCount, Error));
-
-                            assert(LocCount == 1);
-
-                            for(u32 I = 0; I < LocCount; I++)
-                            {
-                                Dwarf_Small LLEOut = 0;
-                                Dwarf_Addr LowPC = 0;
-                                Dwarf_Addr HighPC = 0;
-                                Dwarf_Unsigned LocListCountOut = 0;
-                                Dwarf_Locdesc_c LocDesc = 0;
-                                Dwarf_Small LocListSourceOut = 0;
-                                Dwarf_Unsigned ExpressionOffsetOut = 0;
-                                Dwarf_Unsigned LocDescOffsetOut = 0;
-
-                                DWARF_CALL(dwarf_get_locdesc_entry_c(LocListHead, I, &LLEOut, &LowPC, &HighPC, &LocListCountOut, &LocDesc, &LocListSourceOut, &ExpressionOffsetOut, 
-                                                                     &LocDescOffsetOut, Error));
-
-                                Dwarf_Small AtomOut = 0;
-                                Dwarf_Unsigned Operand1 = 0;
-                                Dwarf_Unsigned Operand2 = 0;
-                                Dwarf_Unsigned Operand3 = 0;
-                                Dwarf_Unsigned OffsetBranch = 0;
-                                DWARF_CALL(dwarf_get_location_op_value_c(LocDesc, I, &AtomOut, &Operand1, &Operand2, &Operand3, &OffsetBranch, Error));
-
-                                LOG_DWARF("AtomOut = %d, Oper1 = %lld, Oper2 = %llu, Oper3 = %llu, OffsetBranch = %llu\n", AtomOut, Operand1, Operand2, Operand3, OffsetBranch);
-
-                                Var->LocationAtom = AtomOut;
-                                Var->Offset = Operand1;
-                            }
-                        }break;
+                    {
+                        DwarfDecodeLocation(DIE, Attribute, &Var->Location);
+                    }break;
                     default:
                         {
                             bool ignored = AttrTag == DW_AT_decl_file ||
@@ -1724,7 +3132,10 @@ ranges have been read then don't read the low-high
             Dwarf_Attribute *AttrList = {};
             DWARF_CALL(dwarf_attrlist(DIE, &AttrList, &AttrCount, Error));
             
-            if(DI->FunctionsCount)
+            // NOTE(mateusz): Parameters of a function come before its body, the ones
+            // after an inlined call belong to the inlined calls and are not shown
+            bool InlinedParam = DI->FunctionsCount && DI->Functions[DI->FunctionsCount - 1].InlinedCallsCount;
+            if(DI->FunctionsCount && !InlinedParam)
             {
                 di_function *Func = &DI->Functions[DI->FunctionsCount - 1];
                 if(Func->ParamCount == 0)
@@ -1753,44 +3164,13 @@ ranges have been read then don't read the low-high
                         case DW_AT_type:
                         {
                             Dwarf_Off Offset = 0;
-                            DWARF_CALL(dwarf_dietype_offset(CurrentDIE, &Offset, Error));
+                            DWARF_CALL(DwarfDIETypeOffset(CurrentDIE, &Offset, Error));
                             
                             Param->TypeOffset = Offset;
                         }break;
                         case DW_AT_location:
                         {
-                            Dwarf_Loc_Head_c LocListHead = {};
-                            Dwarf_Unsigned LocCount = 0;
-                            DWARF_CALL(dwarf_get_loclist_c(Attribute, &LocListHead, &LocCount, Error));
-                            
-                            assert(LocCount == 1);
-                            
-                            for(u32 I = 0; I < LocCount; I++)
-                            {
-                                Dwarf_Small LLEOut = 0;
-                                Dwarf_Addr LowPC = 0;
-                                Dwarf_Addr HighPC = 0;
-                                Dwarf_Unsigned LocListCountOut = 0;
-                                Dwarf_Locdesc_c LocDesc = 0;
-                                Dwarf_Small LocListSourceOut = 0;
-                                Dwarf_Unsigned ExpressionOffsetOut = 0;
-                                Dwarf_Unsigned LocDescOffsetOut = 0;
-                                
-                                DWARF_CALL(dwarf_get_locdesc_entry_c(LocListHead, I, &LLEOut, &LowPC, &HighPC, &LocListCountOut, &LocDesc, &LocListSourceOut, &ExpressionOffsetOut, 
-                                                                     &LocDescOffsetOut, Error));
-                                
-                                Dwarf_Small AtomOut = 0;
-                                Dwarf_Unsigned Operand1 = 0;
-                                Dwarf_Unsigned Operand2 = 0;
-                                Dwarf_Unsigned Operand3 = 0;
-                                Dwarf_Unsigned OffsetBranch = 0;
-                                DWARF_CALL(dwarf_get_location_op_value_c(LocDesc, I, &AtomOut, &Operand1, &Operand2, &Operand3, &OffsetBranch, Error));
-                                
-                                LOG_DWARF("AtomOut = %d, Oper1 = %lld, Oper2 = %llu, Oper3 = %llu, OffsetBranch = %llu\n", AtomOut, Operand1, Operand2, Operand3, OffsetBranch);
-                                
-                                Param->LocationAtom = AtomOut;
-                                Param->Offset = Operand1;
-                            }
+                            DwarfDecodeLocation(DIE, Attribute, &Param->Location);
                         }break;
                         default:
                         {
@@ -1819,9 +3199,7 @@ ranges have been read then don't read the low-high
             DWARF_CALL(dwarf_attrlist(DIE, &AttrList, &AttrCount, Error));
             
             di_base_type *Type = (di_base_type *)&DI->BaseTypes[DI->BaseTypesCount++];
-            Dwarf_Off DIEOffset = 0;
-            DWARF_CALL(dwarf_die_CU_offset(DIE, &DIEOffset, Error));
-            Type->DIEOffset = DIEOffset + DI->CompileUnits[DI->CompileUnitsCount - 1].Offset;
+            Type->DIEOffset = DwarfDIEOffset(DIE);
             
             for(u32 I = 0; I < AttrCount; I++)
             {
@@ -1868,9 +3246,7 @@ ranges have been read then don't read the low-high
             DWARF_CALL(dwarf_attrlist(DIE, &AttrList, &AttrCount, Error));
             
             di_typedef *Typedef = &DI->Typedefs[DI->TypedefsCount++];
-            Dwarf_Off DIEOffset = 0;
-            DWARF_CALL(dwarf_die_CU_offset(DIE, &DIEOffset, Error));
-            Typedef->DIEOffset = DIEOffset + DI->CompileUnits[DI->CompileUnitsCount - 1].Offset;
+            Typedef->DIEOffset = DwarfDIEOffset(DIE);
             
             for(u32 I = 0; I < AttrCount; I++)
             {
@@ -1891,7 +3267,7 @@ ranges have been read then don't read the low-high
                     case DW_AT_type:
                     {
                         Dwarf_Off Offset = 0;
-                        DWARF_CALL(dwarf_dietype_offset(CurrentDIE, &Offset, Error));
+                        DWARF_CALL(DwarfDIETypeOffset(CurrentDIE, &Offset, Error));
                         
                         Typedef->ActualTypeOffset = Offset;
                     }break;
@@ -1920,9 +3296,7 @@ ranges have been read then don't read the low-high
             DWARF_CALL(dwarf_attrlist(DIE, &AttrList, &AttrCount, Error));
             
             di_pointer_type *PType = &DI->PointerTypes[DI->PointerTypesCount++];
-            Dwarf_Off DIEOffset = 0;
-            DWARF_CALL(dwarf_die_CU_offset(DIE, &DIEOffset, Error));
-            PType->DIEOffset = DIEOffset + DI->CompileUnits[DI->CompileUnitsCount - 1].Offset;
+            PType->DIEOffset = DwarfDIEOffset(DIE);
             
             for(u32 I = 0; I < AttrCount; I++)
             {
@@ -1941,7 +3315,7 @@ ranges have been read then don't read the low-high
                     case DW_AT_type:
                     {
                         Dwarf_Off Offset = 0;
-                        DWARF_CALL(dwarf_dietype_offset(CurrentDIE, &Offset, Error));
+                        DWARF_CALL(DwarfDIETypeOffset(CurrentDIE, &Offset, Error));
                         
                         PType->ActualTypeOffset = Offset;
                     }break;
@@ -1963,9 +3337,7 @@ ranges have been read then don't read the low-high
             if(dwarf_attrlist(DIE, &AttrList, &AttrCount, Error) == DW_DLV_OK)
             {
                 di_const_type *CType = &DI->ConstTypes[DI->ConstTypesCount++];
-                Dwarf_Off DIEOffset = 0;
-                DWARF_CALL(dwarf_die_CU_offset(DIE, &DIEOffset, Error));
-                CType->DIEOffset = DIEOffset + DI->CompileUnits[DI->CompileUnitsCount - 1].Offset;
+                CType->DIEOffset = DwarfDIEOffset(DIE);
                 
                 for(u32 I = 0; I < AttrCount; I++)
                 {
@@ -1977,7 +3349,7 @@ ranges have been read then don't read the low-high
                         case DW_AT_type:
                         {
                             Dwarf_Off Offset = 0;
-                            DWARF_CALL(dwarf_dietype_offset(CurrentDIE, &Offset, Error));
+                            DWARF_CALL(DwarfDIETypeOffset(CurrentDIE, &Offset, Error));
                             
                             CType->ActualTypeOffset = Offset;
                         }break;
@@ -1998,9 +3370,7 @@ ranges have been read then don't read the low-high
             DWARF_CALL(dwarf_attrlist(DIE, &AttrList, &AttrCount, Error));
             
             di_restrict_type *RType = &DI->RestrictTypes[DI->RestrictTypesCount++];
-            Dwarf_Off DIEOffset = 0;
-            DWARF_CALL(dwarf_die_CU_offset(DIE, &DIEOffset, Error));
-            RType->DIEOffset = DIEOffset + DI->CompileUnits[DI->CompileUnitsCount - 1].Offset;
+            RType->DIEOffset = DwarfDIEOffset(DIE);
             
             for(u32 I = 0; I < AttrCount; I++)
             {
@@ -2012,7 +3382,7 @@ ranges have been read then don't read the low-high
                     case DW_AT_type:
                     {
                         Dwarf_Off Offset = 0;
-                        DWARF_CALL(dwarf_dietype_offset(CurrentDIE, &Offset, Error));
+                        DWARF_CALL(DwarfDIETypeOffset(CurrentDIE, &Offset, Error));
                         
                         RType->ActualTypeOffset = Offset;
                     }break;
@@ -2031,10 +3401,8 @@ ranges have been read then don't read the low-high
             Dwarf_Attribute *AttrList = {};
             DWARF_CALL(dwarf_attrlist(DIE, &AttrList, &AttrCount, Error));
             
-            di_struct_type *StructType = &DI->StructTypes[DI->StructTypesCount++];
-            Dwarf_Off DIEOffset = 0;
-            DWARF_CALL(dwarf_die_CU_offset(DIE, &DIEOffset, Error));
-            StructType->DIEOffset = DIEOffset + DI->CompileUnits[DI->CompileUnitsCount - 1].Offset;
+            di_aggregate_type *StructType = &DI->StructTypes[DI->StructTypesCount++];
+            StructType->DIEOffset = DwarfDIEOffset(DIE);
             
             /*
             This is to support things like this
@@ -2079,18 +3447,14 @@ ranges have been read then don't read the low-high
             {
                 // There is a possibility of there not being enough space for the member given the fact we don't count it
                 // when we are doing a pass over all the DIEs
-                di_union_member *Member = &DI->UnionMembers[DI->UnionMembersCount++];
+                DI->MemberOwners[DI->MembersCount] = (DI->UnionTypesCount - 1) | DI_MEMBER_OWNER_UNION;
+                di_member *Member = &DI->Members[DI->MembersCount++];
 
-                di_union_type *Union = &DI->UnionTypes[DI->UnionTypesCount - 1];
-                if(Union->MembersCount == 0)
-                {
-                    Union->Members = Member;
-                }
-                
+                di_aggregate_type *Union = &DI->UnionTypes[DI->UnionTypesCount - 1];
                 Union->MembersCount += 1;
                 Member->ByteLocation = 0;
                 Member->Name = "";
-                Member->ActualTypeOffset = DIEOffset + DI->CompileUnits[DI->CompileUnitsCount - 1].Offset;
+                Member->ActualTypeOffset = StructType->DIEOffset;
             }
 
             DI->WasUnion = false;
@@ -2150,10 +3514,8 @@ ranges have been read then don't read the low-high
             Dwarf_Attribute *AttrList = {};
             DWARF_CALL(dwarf_attrlist(DIE, &AttrList, &AttrCount, Error));
             
-            di_union_type *UnionType = &DI->UnionTypes[DI->UnionTypesCount++];
-            Dwarf_Off DIEOffset = 0;
-            DWARF_CALL(dwarf_die_CU_offset(DIE, &DIEOffset, Error));
-            UnionType->DIEOffset = DIEOffset + DI->CompileUnits[DI->CompileUnitsCount - 1].Offset;
+            di_aggregate_type *UnionType = &DI->UnionTypes[DI->UnionTypesCount++];
+            UnionType->DIEOffset = DwarfDIEOffset(DIE);
             UnionType->Name = "";
             
             DI->WasUnion = true;
@@ -2220,14 +3582,10 @@ ranges have been read then don't read the low-high
             
             if(DI->WasStruct)
             {
-                di_struct_member *Member = &DI->StructMembers[DI->StructMembersCount++];
-                
-                di_struct_type *Struct = &DI->StructTypes[DI->StructTypesCount - 1];
-                if(Struct->MembersCount == 0)
-                {
-                    Struct->Members = Member;
-                }
+                DI->MemberOwners[DI->MembersCount] = DI->StructTypesCount - 1;
+                di_member *Member = &DI->Members[DI->MembersCount++];
                 
+                di_aggregate_type *Struct = &DI->StructTypes[DI->StructTypesCount - 1];
                 Struct->MembersCount += 1;
                 Member->Name = "";
                 
@@ -2243,14 +3601,12 @@ ranges have been read then don't read the low-high
                             char *Name = 0x0;
                             DWARF_CALL(dwarf_formstring(Attribute, &Name, Error));
                             
-                            u32 Size = strlen(Name) + 1;
-                            Member->Name = ArrayPush(&DI->Arena, char, Size);
-                            StringCopy(Member->Name, Name);
+                            Member->Name = DwarfInternString(Name);
                         }break;
                         case DW_AT_type:
                         {
                             Dwarf_Off Offset = 0;
-                            DWARF_CALL(dwarf_dietype_offset(CurrentDIE, &Offset, Error));
+                            DWARF_CALL(DwarfDIETypeOffset(CurrentDIE, &Offset, Error));
                             
                             Member->ActualTypeOffset = Offset;
                         }break;
@@ -2278,14 +3634,10 @@ ranges have been read then don't read the low-high
             }
             else if(DI->WasUnion)
             {
-                di_union_member *Member = &DI->UnionMembers[DI->UnionMembersCount++];
-                
-                di_union_type *Union = &DI->UnionTypes[DI->UnionTypesCount - 1];
-                if(Union->MembersCount == 0)
-                {
-                    Union->Members = Member;
-                }
+                DI->MemberOwners[DI->MembersCount] = (DI->UnionTypesCount - 1) | DI_MEMBER_OWNER_UNION;
+                di_member *Member = &DI->Members[DI->MembersCount++];
                 
+                di_aggregate_type *Union = &DI->UnionTypes[DI->UnionTypesCount - 1];
                 Union->MembersCount += 1;
                 Member->ByteLocation = 0;
                 Member->Name = "";
@@ -2302,14 +3654,12 @@ ranges have been read then don't read the low-high
                             char *Name = 0x0;
                             DWARF_CALL(dwarf_formstring(Attribute, &Name, Error));
                             
-                            u32 Size = strlen(Name) + 1;
-                            Member->Name = ArrayPush(&DI->Arena, char, Size);
-                            StringCopy(Member->Name, Name);
+                            Member->Name = DwarfInternString(Name);
                         }break;
                         case DW_AT_type:
                         {
                             Dwarf_Off Offset = 0;
-                            DWARF_CALL(dwarf_dietype_offset(CurrentDIE, &Offset, Error));
+                            DWARF_CALL(DwarfDIETypeOffset(CurrentDIE, &Offset, Error));
                             
                             Member->ActualTypeOffset = Offset;
                         }break;
@@ -2338,9 +3688,7 @@ ranges have been read then don't read the low-high
             
             di_array_type *AType = &DI->ArrayTypes[DI->ArrayTypesCount++];
             
-            Dwarf_Off DIEOffset = 0;
-            DWARF_CALL(dwarf_die_CU_offset(DIE, &DIEOffset, Error));
-            AType->DIEOffset = DIEOffset + DI->CompileUnits[DI->CompileUnitsCount - 1].Offset;
+            AType->DIEOffset = DwarfDIEOffset(DIE);
             
             for(u32 I = 0; I < AttrCount; I++)
             {
@@ -2352,7 +3700,7 @@ ranges have been read then don't read the low-high
                     case DW_AT_type:
                     {
                         Dwarf_Off Offset = 0;
-                        DWARF_CALL(dwarf_dietype_offset(CurrentDIE, &Offset, Error));
+                        DWARF_CALL(DwarfDIETypeOffset(CurrentDIE, &Offset, Error));
                         
                         AType->ActualTypeOffset = Offset;
                     }break;
@@ -2390,7 +3738,7 @@ ranges have been read then don't read the low-high
                     case DW_AT_type:
                     {
                         Dwarf_Off Offset = 0;
-                        DWARF_CALL(dwarf_dietype_offset(CurrentDIE, &Offset, Error));
+                        DWARF_CALL(DwarfDIETypeOffset(CurrentDIE, &Offset, Error));
                         
                         AType->RangesTypeOffset = Offset;
                     }break;
@@ -2503,21 +3851,44 @@ DwarfRead()
 {
     Dwarf_Unsigned CUHeaderLength = 0;
     Dwarf_Half Version = 0;
-    Dwarf_Unsigned AbbrevOffset = 0;
+    Dwarf_Off AbbrevOffset = 0;
     Dwarf_Half AddressSize = 0;
+    Dwarf_Half LengthSize = 0;
+    Dwarf_Half ExtensionSize = 0;
+    Dwarf_Sig8 Signature = {};
+    Dwarf_Unsigned TypeOffset = 0;
     Dwarf_Unsigned NextCUHeader = 0;
+    Dwarf_Half UnitType = 0;
     Dwarf_Error *Error = 0x0;
     
-    DwarfOpenSymbolsHandle(&DI->DwarfFd, &DI->Debug);
+    DwarfReadFrameInfo();
+    
+    // The handle might be open already, if the name index was used before the module was loaded
+    if(!DI->Debug && !DwarfOpenSymbolsHandle(DI->SymbolsPath, &DI->DwarfFd, &DI->Debug))
+    {
+        return;
+    }
     
     u32 *CountTable = (u32 *)calloc(DWARF_TAGS_COUNT, sizeof(u32));
     DI->Arena = ArenaCreateZeros(Kilobytes(64));
+
+    // NOTE(mateusz): Split units are looked up in the package first, it is
+    // named after the executable and holds the units of every .dwo
+    char PackagePath[PATH_MAX + 8] = {};
+    snprintf(PackagePath, sizeof(PackagePath), "%s.dwp", DI->Path);
+    i32 PackageFd = 0;
+    Dwarf_Debug Package = 0x0;
+    if(access(PackagePath, R_OK) == 0 && DwarfOpenSymbolsHandle(PackagePath, &PackageFd, &Package))
+    {
+        DWARF_CALL(dwarf_set_tied_dbg(Package, DI->Debug, Error));
+    }
     
     for(i32 CUCount = 0;;++CUCount)
     {
-        i32 Result = dwarf_next_cu_header(DI->Debug, &CUHeaderLength,
-                                          &Version, &AbbrevOffset, &AddressSize,
-                                          &NextCUHeader, Error);
+        i32 Result = dwarf_next_cu_header_d(DI->Debug, true, &CUHeaderLength,
+                                            &Version, &AbbrevOffset, &AddressSize,
+                                            &LengthSize, &ExtensionSize, &Signature,
+                                            &TypeOffset, &NextCUHeader, &UnitType, Error);
         
         assert(Result != DW_DLV_ERROR);
         if(Result  == DW_DLV_NO_ENTRY) {
@@ -2530,6 +3901,15 @@ DwarfRead()
         assert(Result != DW_DLV_ERROR && Result != DW_DLV_NO_ENTRY);
         
         DwarfCountTags(DI->Debug, CurrentDIE, CountTable);
+
+        Dwarf_Sig8 DwoID = {};
+        di_split_unit Unit = {};
+        if(DwarfGetDwoID(CurrentDIE, UnitType, &Signature, &DwoID) &&
+           DwarfOpenSplitUnit(Package, CurrentDIE, &DwoID, &Unit))
+        {
+            DwarfCountTags(Unit.Debug, Unit.CUDIE, CountTable);
+            DwarfCloseSplitUnit(&Unit);
+        }
     }
     
     //TIMER_START(0);
@@ -2544,10 +3924,15 @@ DwarfRead()
     DI->Variables = ArrayPush(&DI->Arena, di_variable, CountTable[DW_TAG_variable]);
     DI->Params = ArrayPush(&DI->Arena, di_variable, CountTable[DW_TAG_formal_parameter]);
     DI->LexScopes = ArrayPush(&DI->Arena, di_lexical_scope, CountTable[DW_TAG_lexical_block]);
-    DI->StructMembers = ArrayPush(&DI->Arena, di_struct_member, CountTable[DW_TAG_member]);
-    DI->StructTypes = ArrayPush(&DI->Arena, di_struct_type, CountTable[DW_TAG_structure_type]);
-    DI->UnionMembers = ArrayPush(&DI->Arena, di_union_member, CountTable[DW_TAG_member]);
-    DI->UnionTypes = ArrayPush(&DI->Arena, di_union_type, CountTable[DW_TAG_union_type]);
+    DI->InlinedCalls = ArrayPush(&DI->Arena, di_inlined_call, CountTable[DW_TAG_inlined_subroutine]);
+    DI->StructTypes = ArrayPush(&DI->Arena, di_aggregate_type, CountTable[DW_TAG_structure_type]);
+    DI->UnionTypes = ArrayPush(&DI->Arena, di_aggregate_type, CountTable[DW_TAG_union_type]);
+
+    // NOTE(mateusz): Structs emplaced in unions become members too, they are not
+    // counted as DW_TAG_member. Both arrays go away in DwarfGroupMembers.
+    u32 MembersCapacity = CountTable[DW_TAG_member] + CountTable[DW_TAG_structure_type];
+    DI->Members = (di_member *)calloc(MembersCapacity, sizeof(di_member));
+    DI->MemberOwners = (u32 *)calloc(MembersCapacity, sizeof(u32));
     DI->ArrayTypes = ArrayPush(&DI->Arena, di_array_type, CountTable[DW_TAG_array_type]);
     DI->SourceFiles = ArrayPush(&DI->Arena, di_src_file, MAX_DI_SOURCE_FILES);
 
@@ -2568,9 +3953,10 @@ DwarfRead()
     for(i32 CUCount = 0;;++CUCount)
     {
         // NOTE(mateusz): I don't know what it does
-        i32 Result = dwarf_next_cu_header(DI->Debug, &CUHeaderLength,
-                                          &Version, &AbbrevOffset, &AddressSize,
-                                          &NextCUHeader, Error);
+        i32 Result = dwarf_next_cu_header_d(DI->Debug, true, &CUHeaderLength,
+                                            &Version, &AbbrevOffset, &AddressSize,
+                                            &LengthSize, &ExtensionSize, &Signature,
+                                            &TypeOffset, &NextCUHeader, &UnitType, Error);
 
         assert(Result != DW_DLV_ERROR);
         if(Result  == DW_DLV_NO_ENTRY) {
@@ -2583,33 +3969,445 @@ DwarfRead()
         assert(Result != DW_DLV_ERROR && Result != DW_DLV_NO_ENTRY);
         
         DwarfReadDIEMany(DI->Debug, CurrentDIE);
+
+        Dwarf_Sig8 DwoID = {};
+        di_split_unit Unit = {};
+        if(DwarfGetDwoID(CurrentDIE, UnitType, &Signature, &DwoID) &&
+           DwarfOpenSplitUnit(Package, CurrentDIE, &DwoID, &Unit))
+        {
+            DwarfReadSplitUnit(&Unit);
+            DwarfCloseSplitUnit(&Unit);
+        }
     }
+
+    DwarfCloseSymbolsHandle(&PackageFd, &Package);
+    DwarfGroupMembers();
     
-    DwarfCloseSymbolsHandle(&DI->DwarfFd, &DI->Debug);
+    // NOTE(mateusz): DI->Debug is kept open for the source lookups, it's closed in DwarfClearAll
     
+    free(CountTable);
+}
+
+// NOTE(mateusz): The .eh_frame is in the module itself, not in the symbols file, and
+// it is there even if the module has no .debug_* sections at all.
+static void
+DwarfReadFrameInfo()
+{
     // NOTE(mateusz): This time without finish to preserve it
-    DwarfOpenSymbolsHandle(&DI->CFAFd, &DI->CFADebug);
+    if(DwarfOpenSymbolsHandle(DI->Path, &DI->CFAFd, &DI->CFADebug))
+    {
+        Dwarf_Cie *CIEs;
+        Dwarf_Signed CIECount;
+        Dwarf_Fde *FDEs;
+        Dwarf_Signed FDECount;
+        if(dwarf_get_fde_list_eh(DI->CFADebug, &CIEs, &CIECount, &FDEs, &FDECount, 0x0) == DW_DLV_OK)
+        {
+            di_frame_info *Frame = &DI->FrameInfo;
+            Frame->CIECount = CIECount;
+            Frame->FDECount = FDECount;
+            Frame->CIEs = CIEs;
+            Frame->FDEs = FDEs;
+        }
+    }
+}
+
+static size_t
+DwarfDIEOffset(Dwarf_Die DIE)
+{
+    Dwarf_Off Offset = 0;
+    DWARF_CALL(dwarf_dieoffset(DIE, &Offset, 0x0));
     
-    Dwarf_Cie *CIEs;
-    Dwarf_Signed CIECount;
-    Dwarf_Fde *FDEs;
-    Dwarf_Signed FDECount;
-    DWARF_CALL(dwarf_get_fde_list_eh(DI->CFADebug, &CIEs, &CIECount, &FDEs, &FDECount, Error));
+    return Offset + DI->DIEOffsetBase;
+}
+
+static i32
+DwarfDIETypeOffset(Dwarf_Die DIE, Dwarf_Off *Offset, Dwarf_Error *Error)
+{
+    i32 Result = dwarf_dietype_offset(DIE, Offset, Error);
+    if(Result == DW_DLV_OK)
+    {
+        *Offset += DI->DIEOffsetBase;
+    }
     
-    di_frame_info *Frame = &DI->FrameInfo;
-    Frame->CIECount = CIECount;
-    Frame->FDECount = FDECount;
-    Frame->CIEs = CIEs;
-    Frame->FDEs = FDEs;
+    return Result;
+}
+
+// NOTE(mateusz): DWARF 5 skeleton units carry the id in the unit header, the GNU
+// extension used by older compilers puts it in DW_AT_GNU_dwo_id.
+static bool
+DwarfGetDwoID(Dwarf_Die SkeletonDIE, Dwarf_Half UnitType, Dwarf_Sig8 *HeaderSignature, Dwarf_Sig8 *Result)
+{
+    bool Found = false;
     
-    free(CountTable);
+    if(UnitType == DW_UT_skeleton)
+    {
+        *Result = *HeaderSignature;
+        Found = true;
+    }
+    else
+    {
+        Dwarf_Attribute Attribute = 0x0;
+        Dwarf_Unsigned ID = 0;
+        if(dwarf_attr(SkeletonDIE, DW_AT_GNU_dwo_id, &Attribute, 0x0) == DW_DLV_OK &&
+           dwarf_formudata(Attribute, &ID, 0x0) == DW_DLV_OK)
+        {
+            memcpy(Result->signature, &ID, sizeof(Result->signature));
+            Found = true;
+        }
+    }
+    
+    return Found;
+}
+
+static bool
+DwarfOpenSplitUnit(Dwarf_Debug Package, Dwarf_Die SkeletonDIE, Dwarf_Sig8 *DwoID, di_split_unit *Unit)
+{
+    if(Package && dwarf_die_from_hash_signature(Package, DwoID, "cu", &Unit->CUDIE, 0x0) == DW_DLV_OK)
+    {
+        Unit->Debug = Package;
+        return true;
+    }
+    
+    char *DwoName = 0x0;
+    char *CompDir = 0x0;
+    Dwarf_Attribute Attribute = 0x0;
+    if(dwarf_attr(SkeletonDIE, DW_AT_dwo_name, &Attribute, 0x0) == DW_DLV_OK ||
+       dwarf_attr(SkeletonDIE, DW_AT_GNU_dwo_name, &Attribute, 0x0) == DW_DLV_OK)
+    {
+        DWARF_CALL(dwarf_formstring(Attribute, &DwoName, 0x0));
+    }
+    if(dwarf_attr(SkeletonDIE, DW_AT_comp_dir, &Attribute, 0x0) == DW_DLV_OK)
+    {
+        DWARF_CALL(dwarf_formstring(Attribute, &CompDir, 0x0));
+    }
+    
+    if(!DwoName)
+    {
+        return false;
+    }
+    
+    char Path[PATH_MAX] = {};
+    if(DwoName[0] == '/' || !CompDir)
+    {
+        snprintf(Path, sizeof(Path), "%s", DwoName);
+    }
+    else
+    {
+        snprintf(Path, sizeof(Path), "%s/%s", CompDir, DwoName);
+    }
+    
+    if(!DwarfOpenSymbolsHandle(Path, &Unit->Fd, &Unit->Debug))
+    {
+        LOG_DWARF("Split unit %s is missing\n", Path);
+        return false;
+    }
+    
+    // NOTE(mateusz): Addresses and ranges of the unit are stored in the skeleton's sections
+    DWARF_CALL(dwarf_set_tied_dbg(Unit->Debug, DI->Debug, 0x0));
+    
+    Dwarf_Unsigned CUHeaderLength = 0;
+    Dwarf_Half Version = 0;
+    Dwarf_Off AbbrevOffset = 0;
+    Dwarf_Half AddressSize = 0;
+    Dwarf_Half LengthSize = 0;
+    Dwarf_Half ExtensionSize = 0;
+    Dwarf_Sig8 Signature = {};
+    Dwarf_Unsigned TypeOffset = 0;
+    Dwarf_Unsigned NextCUHeader = 0;
+    Dwarf_Half UnitType = 0;
+    
+    // A .dwo file holds a single compile unit
+    bool Result = dwarf_next_cu_header_d(Unit->Debug, true, &CUHeaderLength, &Version, &AbbrevOffset,
+                                         &AddressSize, &LengthSize, &ExtensionSize, &Signature,
+                                         &TypeOffset, &NextCUHeader, &UnitType, 0x0) == DW_DLV_OK &&
+                  dwarf_siblingof(Unit->Debug, 0, &Unit->CUDIE, 0x0) == DW_DLV_OK;
+    if(!Result)
+    {
+        DwarfCloseSplitUnit(Unit);
+    }
+    
+    return Result;
+}
+
+static void
+DwarfCloseSplitUnit(di_split_unit *Unit)
+{
+    // The package is shared by every unit and closed in DwarfRead
+    DwarfCloseSymbolsHandle(&Unit->Fd, &Unit->Debug);
+    *Unit = {};
+}
+
+// NOTE(mateusz): The skeleton CU is read like any other, the children of the split
+// CU are then read as if they were its own.
+static void
+DwarfReadSplitUnit(di_split_unit *Unit)
+{
+    Dwarf_Error Error_ = {};
+    Dwarf_Error *Error = &Error_;
+    
+    DI->DIEOffsetBase = (size_t)(++DI->SplitUnitsCount) << DI_SPLIT_UNIT_OFFSET_SHIFT;
+    
+    Dwarf_Die ChildDIE = 0x0;
+    i32 Result = dwarf_child(Unit->CUDIE, &ChildDIE, Error);
+    if(Result == DW_DLV_OK)
+    {
+        DI->DIEIndentLevel++;
+        DwarfReadDIEMany(Unit->Debug, ChildDIE);
+        Dwarf_Die SiblingDIE = ChildDIE;
+        
+        while(Result == DW_DLV_OK)
+        {
+            Dwarf_Die CurrentDIE = SiblingDIE;
+            Result = dwarf_siblingof(Unit->Debug, CurrentDIE, &SiblingDIE, Error);
+            if(Result == DW_DLV_OK)
+            {
+                DwarfReadDIEMany(Unit->Debug, SiblingDIE);
+            }
+        }
+        DI->DIEIndentLevel--;
+    }
+    
+    DI->DIEOffsetBase = 0;
+}
+
+static void
+DwarfModulesInit()
+{
+    DwarfModulesRefresh();
+
+    di_module *Executable = DwarfFindModuleByAddress(Debugee.LoadAddress);
+    assert(Executable);
+
+    // A non PIE executable is linked at the addresses it runs at
+    if(!Debugee.Flags.PIE)
+    {
+        Executable->DI.LoadBias = 0x0;
+    }
+
+    DwarfModuleLoad(Executable);
+    DI = &Executable->DI;
+}
+
+static void
+DwarfModulesRefresh()
+{
+    char Path[64] = {};
+    sprintf(Path, "/proc/%d/maps", Debugee.PID);
+
+    FILE *FileHandle = fopen(Path, "r");
+    if(!FileHandle)
+    {
+        return;
+    }
+    ModulesStale = false;
+
+    u64 MapsHash = 0xcbf29ce484222325;
+    char Line[PATH_MAX + 128] = {};
+    while(fgets(Line, sizeof(Line), FileHandle))
+    {
+        size_t Start = 0x0;
+        size_t End = 0x0;
+        size_t Offset = 0x0;
+        char MappedPath[PATH_MAX] = {};
+        i32 Fields = sscanf(Line, "%lx-%lx %*s %lx %*s %*s %[^\n]", &Start, &End, &Offset, MappedPath);
+
+        // Anonymous mappings and the ones like [stack] or [vdso]
+        if(Fields != 4 || MappedPath[0] != '/')
+        {
+            continue;
+        }
+
+        // Only the file mappings, the heap and the stack grow all the time
+        MapsHash = (MapsHash ^ Start) * 0x100000001b3;
+        MapsHash = (MapsHash ^ End) * 0x100000001b3;
+        MapsHash = (MapsHash ^ Offset) * 0x100000001b3;
+
+        di_module *Module = DwarfFindModuleByPath(MappedPath);
+        if(Module)
+        {
+            Module->AddrRange.Start = MIN(Module->AddrRange.Start, Start);
+            Module->AddrRange.End = MAX(Module->AddrRange.End, End);
+        }
+        else if(ModulesCount < MAX_DI_MODULES)
+        {
+            Module = &Modules[ModulesCount++];
+            StringCopy(Module->Path, MappedPath);
+            Module->AddrRange.Start = Start;
+            Module->AddrRange.End = End;
+            Module->DI.Path = Module->Path;
+            Module->DI.LoadBias = Start - Offset;
+        }
+    }
+
+    fclose(FileHandle);
+
+    if(MapsHash != ModulesMapsHash)
+    {
+        ModulesMapsHash = MapsHash;
+        ModulesGeneration += 1;
+    }
+}
+
+static di_module *
+DwarfFindModuleByPath(char *Path)
+{
+    di_module *Result = 0x0;
+
+    for(u32 I = 0; I < ModulesCount; I++)
+    {
+        if(StringMatches(Path, Modules[I].Path))
+        {
+            Result = &Modules[I];
+            break;
+        }
+    }
+
+    return Result;
+}
+
+static di_module *
+DwarfFindModuleByAddress(size_t Address)
+{
+    di_module *Result = 0x0;
+
+    for(u32 I = 0; I < ModulesCount; I++)
+    {
+        address_range Range = Modules[I].AddrRange;
+        if(Address >= Range.Start && Address < Range.End)
+        {
+            Result = &Modules[I];
+            break;
+        }
+    }
+
+    // NOTE(mateusz): Libraries could have been loaded since the last time we
+    // looked, the maps are read again at most once per stop.
+    if(!Result && ModulesStale)
+    {
+        ModulesStale = false;
+        DwarfModulesRefresh();
+        Result = DwarfFindModuleByAddress(Address);
+    }
+
+    return Result;
+}
+
+static void
+DwarfModuleLoad(di_module *Module)
+{
+    if(!Module->Loaded)
+    {
+        Module->Loaded = true;
+
+        DwarfModuleFindSymbols(Module);
+
+        debug_info *Current = DI;
+        DI = &Module->DI;
+        DwarfRead();
+        DI = Current;
+    }
+}
+
+// NOTE(mateusz): Addresses outside of every module (JIT code, the stack...) are
+// looked up in the current module like before.
+static debug_info *
+DwarfModuleDebugInfo(size_t Address)
+{
+    debug_info *Result = DI;
+
+    di_module *Module = DwarfFindModuleByAddress(Address);
+    if(Module)
+    {
+        DwarfModuleLoad(Module);
+        Result = &Module->DI;
+    }
+
+    return Result;
+}
+
+static void
+DwarfModuleFindSymbols(di_module *Module)
+{
+    if(!Module->DI.SymbolsPath)
+    {
+        DwarfFindSymbolsPath(Module->Path, Module->SymbolsPath);
+        Module->DI.SymbolsPath = Module->SymbolsPath;
+    }
+}
+
+// Called on every stop, the module of the program counter becomes the current one
+static void
+DwarfSelectModuleByAddress(size_t Address)
+{
+    ModulesStale = true;
+    DI = DwarfModuleDebugInfo(Address);
+}
+
+// NOTE(mateusz): The maps are read at most once per stop, if looking up the modules
+// during the stop didn't do that already it is done here.
+static u32
+DwarfModulesGeneration()
+{
+    if(ModulesStale)
+    {
+        DwarfModulesRefresh();
+    }
+    
+    return ModulesGeneration;
+}
+
+// NOTE(mateusz): Finds the executable section of the module with the given name or,
+// without a name, the one the address is in. Writable sections could have been
+// changed at runtime so they are never returned. Range is in the debugee addresses.
+static bool
+DwarfModuleCodeSection(di_module *Module, size_t Address, char *Name, address_range *Range, size_t *FileOffset)
+{
+    di_elf_file *File = DwarfOpenElfFile(Module->Path);
+    size_t StringsIndex = 0;
+    if(!File || elf_getshdrstrndx(File->ElfHandle, &StringsIndex) != 0)
+    {
+        return false;
+    }
+    
+    for(Elf_Scn *ElfScn = 0x0; (ElfScn = elf_nextscn(File->ElfHandle, ElfScn));)
+    {
+        Elf64_Shdr *SectionHeader = elf64_getshdr(ElfScn);
+        if(SectionHeader->sh_type != SHT_PROGBITS || !(SectionHeader->sh_flags & SHF_EXECINSTR) ||
+           (SectionHeader->sh_flags & SHF_WRITE))
+        {
+            continue;
+        }
+        
+        size_t Start = SectionHeader->sh_addr + Module->DI.LoadBias;
+        size_t End = Start + SectionHeader->sh_size;
+        bool Matches = false;
+        if(Name)
+        {
+            char *SectionName = elf_strptr(File->ElfHandle, StringsIndex, SectionHeader->sh_name);
+            Matches = SectionName && StringMatches(SectionName, Name);
+        }
+        else
+        {
+            Matches = Address >= Start && Address < End;
+        }
+        
+        if(Matches)
+        {
+            Range->Start = Start;
+            Range->End = End;
+            *FileOffset = SectionHeader->sh_offset;
+            return true;
+        }
+    }
+    
+    return false;
 }
 
 static bool
 DwarfEvalFDE(size_t Address, u32 RegsTableSize, Dwarf_Regtable3 *Result, address_range *InRange)
 {
     bool Success = false;
-    Address = Debugee.Flags.PIE ? Address - Debugee.LoadAddress : Address;
+    Address = Address - DI->LoadBias;
     di_frame_info *Frame = &DI->FrameInfo;
     for(u32 J = 0; J < Frame->FDECount; J++)
     {
@@ -2623,8 +4421,8 @@ DwarfEvalFDE(size_t Address, u32 RegsTableSize, Dwarf_Regtable3 *Result, address
         {
 			if(InRange)
 			{
-				InRange->Start = FDELowPC;
-				InRange->End = FDELowPC + FDEFunctionLength - 1;
+				InRange->Start = FDELowPC + DI->LoadBias;
+				InRange->End = FDELowPC + FDEFunctionLength - 1 + DI->LoadBias;
 			}
 			
             if(RegsTableSize)
@@ -2662,25 +4460,34 @@ DwarfCalculateCFA(Dwarf_Regtable3 *Table, x64_registers Registers)
     return CFA;
 }
     
-static size_t
-DwarfGetCanonicalFrameAddress(size_t Address)
+// NOTE(mateusz): Fails when there is no FDE for the address
+static bool
+DwarfGetCanonicalFrameAddress(size_t Address, size_t *Result)
 {
-    size_t Result = 0x0;
+    bool Found = true;
+    
+    debug_info *Current = DI;
+    DI = DwarfModuleDebugInfo(Address);
 
-    if(AddressBetween(Address, DI->CFAAddrRange))
+    if(AddressBetween(Address, DI->CFAAddrRange) && DI->CFAStackPointer == Debugee.Regs.RSP)
     {
-		Result = DI->CachedCFA;
+		*Result = DI->CachedCFA;
     }
     else
     {
         Dwarf_Regtable3 Table = {};
-        assert(DwarfEvalFDE(Address, 0, &Table, &DI->CFAAddrRange));
-
-        Result = DwarfCalculateCFA(&Table, Debugee.Regs);
-        DI->CachedCFA = Result;
+        Found = DwarfEvalFDE(Address, 0, &Table, &DI->CFAAddrRange);
+        if(Found)
+        {
+            *Result = DwarfCalculateCFA(&Table, Debugee.Regs);
+            DI->CFAStackPointer = Debugee.Regs.RSP;
+            DI->CachedCFA = *Result;
+        }
     }
+    
+    DI = Current;
 
-    return Result;
+    return Found;
 }
 
 static bool
@@ -2776,3 +4583,611 @@ DwarfIsAddressInDifferentSourceLine(size_t Address)
         
     return false;
 }
+
+static u8 *
+DwarfGetElfSection(di_elf_file *File, char *Name, size_t *Size)
+{
+    size_t StringsIndex = 0;
+    if(elf_getshdrstrndx(File->ElfHandle, &StringsIndex) != 0)
+    {
+        return 0x0;
+    }
+    
+    for(Elf_Scn *ElfScn = 0x0; (ElfScn = elf_nextscn(File->ElfHandle, ElfScn));)
+    {
+        Elf64_Shdr *SectionHeader = elf64_getshdr(ElfScn);
+        char *SectionName = elf_strptr(File->ElfHandle, StringsIndex, SectionHeader->sh_name);
+        if(SectionName && StringMatches(SectionName, Name))
+        {
+            // Sections that failed to inflate can't be read as they are
+            Elf_Data *Data = elf_getdata(ElfScn, 0x0);
+            if(!Data || (SectionHeader->sh_flags & SHF_COMPRESSED))
+            {
+                return 0x0;
+            }
+            
+            *Size = Data->d_size;
+            return (u8 *)Data->d_buf;
+        }
+    }
+    
+    return 0x0;
+}
+
+// NOTE(mateusz): Only the sections are looked up here, the tables are read on every
+// lookup. Opens the symbols handle of modules that weren't loaded yet.
+static bool
+DwarfOpenNameIndex(debug_info *ModuleDI)
+{
+    di_name_index *Index = &ModuleDI->NameIndex;
+    if(!Index->Read && ModuleDI->SymbolsPath)
+    {
+        Index->Read = true;
+        if(!ModuleDI->Debug)
+        {
+            DwarfOpenSymbolsHandle(ModuleDI->SymbolsPath, &ModuleDI->DwarfFd, &ModuleDI->Debug);
+        }
+        
+        di_elf_file *File = ModuleDI->Debug ? DwarfOpenElfFile(ModuleDI->SymbolsPath) : 0x0;
+        if(File && (Index->Table = DwarfGetElfSection(File, ".debug_names", &Index->TableSize)))
+        {
+            Index->Strings = DwarfGetElfSection(File, ".debug_str", &Index->StringsSize);
+            Index->Kind = Index->Strings ? NAME_INDEX_DEBUG_NAMES : NAME_INDEX_NONE;
+        }
+        else if(File && (Index->Table = DwarfGetElfSection(File, ".gdb_index", &Index->TableSize)))
+        {
+            Index->Kind = NAME_INDEX_GDB_INDEX;
+        }
+        
+        LOG_DWARF("Name index of %s is %d\n", ModuleDI->Path, Index->Kind);
+    }
+    
+    return Index->Kind != NAME_INDEX_NONE;
+}
+
+static u32
+DwarfNameIndexLookup(di_name_index *Index, char *Name, u32 Tag, di_name_entry *Result, u32 MaxCount)
+{
+    u32 Count = 0;
+    
+    switch(Index->Kind)
+    {
+        case NAME_INDEX_DEBUG_NAMES:
+        {
+            Count = DwarfDebugNamesLookup(Index, Name, Tag, Result, MaxCount);
+        }break;
+        case NAME_INDEX_GDB_INDEX:
+        {
+            Count = DwarfGdbIndexLookup(Index, Name, Tag, Result, MaxCount);
+        }break;
+        default:
+        {
+        }break;
+    }
+    
+    return Count;
+}
+
+// Tables are little endian like the rest of x86_64
+static u64
+DwarfIndexRead(u8 **At, u32 Size)
+{
+    u64 Result = 0;
+    memcpy(&Result, *At, Size);
+    *At += Size;
+    
+    return Result;
+}
+
+static u64
+DwarfIndexReadULEB128(u8 **At)
+{
+    u64 Result = 0;
+    u32 Shift = 0;
+    u8 Byte = 0;
+    do
+    {
+        Byte = *(*At)++;
+        Result |= (u64)(Byte & 0x7f) << Shift;
+        Shift += 7;
+    } while(Byte & 0x80);
+    
+    return Result;
+}
+
+static bool
+DwarfIndexReadForm(u8 **At, u64 Form, u64 *Value)
+{
+    switch(Form)
+    {
+        case DW_FORM_flag:
+        case DW_FORM_data1:
+        case DW_FORM_ref1:
+        {
+            *Value = DwarfIndexRead(At, 1);
+        }break;
+        case DW_FORM_data2:
+        case DW_FORM_ref2:
+        {
+            *Value = DwarfIndexRead(At, 2);
+        }break;
+        case DW_FORM_data4:
+        case DW_FORM_ref4:
+        {
+            *Value = DwarfIndexRead(At, 4);
+        }break;
+        case DW_FORM_data8:
+        case DW_FORM_ref8:
+        {
+            *Value = DwarfIndexRead(At, 8);
+        }break;
+        case DW_FORM_data16:
+        {
+            *Value = 0;
+            *At += 16;
+        }break;
+        case DW_FORM_udata:
+        case DW_FORM_sdata:
+        case DW_FORM_ref_udata:
+        {
+            *Value = DwarfIndexReadULEB128(At);
+        }break;
+        case DW_FORM_flag_present:
+        {
+            *Value = 1;
+        }break;
+        default:
+        {
+            // The size of the entry is unknown, the rest of the series can't be read
+            return false;
+        }break;
+    }
+    
+    return true;
+}
+
+static u32
+DwarfDebugNamesReadEntries(u8 *At, u8 *Abbrevs, u8 *AbbrevsEnd, u8 *CUList, u32 CUCount, u32 OffsetSize,
+                           u32 Tag, di_name_entry *Result, u32 MaxCount)
+{
+    u32 Count = 0;
+    
+    for(;;)
+    {
+        u64 Code = DwarfIndexReadULEB128(&At);
+        if(!Code)
+        {
+            break;
+        }
+        
+        u8 *Abbrev = Abbrevs;
+        u64 AbbrevTag = 0;
+        bool Found = false;
+        while(!Found && Abbrev < AbbrevsEnd)
+        {
+            u64 AbbrevCode = DwarfIndexReadULEB128(&Abbrev);
+            if(!AbbrevCode)
+            {
+                break;
+            }
+            
+            AbbrevTag = DwarfIndexReadULEB128(&Abbrev);
+            Found = AbbrevCode == Code;
+            
+            for(;!Found;)
+            {
+                u64 Attribute = DwarfIndexReadULEB128(&Abbrev);
+                u64 Form = DwarfIndexReadULEB128(&Abbrev);
+                if(!Attribute && !Form)
+                {
+                    break;
+                }
+            }
+        }
+        
+        if(!Found)
+        {
+            break;
+        }
+        
+        // A table of a single compile unit can leave out its index
+        u64 CUIndex = 0;
+        u64 DIEOffset = 0;
+        bool TypeUnit = false;
+        for(;;)
+        {
+            u64 Attribute = DwarfIndexReadULEB128(&Abbrev);
+            u64 Form = DwarfIndexReadULEB128(&Abbrev);
+            if(!Attribute && !Form)
+            {
+                break;
+            }
+            
+            u64 Value = 0;
+            if(!DwarfIndexReadForm(&At, Form, &Value))
+            {
+                return Count;
+            }
+            
+            switch(Attribute)
+            {
+                case DW_IDX_compile_unit:
+                {
+                    CUIndex = Value;
+                }break;
+                case DW_IDX_type_unit:
+                {
+                    TypeUnit = true;
+                }break;
+                case DW_IDX_die_offset:
+                {
+                    DIEOffset = Value;
+                }break;
+                default:
+                {
+                }break;
+            }
+        }
+        
+        if(AbbrevTag == Tag && !TypeUnit && CUIndex < CUCount && Count < MaxCount)
+        {
+            u8 *CUOffset = CUList + CUIndex * OffsetSize;
+            di_name_entry *Entry = &Result[Count++];
+            Entry->Tag = Tag;
+            Entry->CUOffset = DwarfIndexRead(&CUOffset, OffsetSize);
+            Entry->DIEOffset = Entry->CUOffset + DIEOffset;
+        }
+    }
+    
+    return Count;
+}
+
+// NOTE(mateusz): Every object file built without a linker generated index brings
+// its own table, they are laid out one after another in the section.
+static u32
+DwarfDebugNamesLookup(di_name_index *Index, char *Name, u32 Tag, di_name_entry *Result, u32 MaxCount)
+{
+    u32 Count = 0;
+    
+    // Case folded DJB hash
+    u32 Hash = 5381;
+    for(char *C = Name; *C; C++)
+    {
+        Hash = Hash * 33 + tolower(*C);
+    }
+    
+    u8 *SectionEnd = Index->Table + Index->TableSize;
+    for(u8 *Unit = Index->Table; Unit + 4 <= SectionEnd && Count < MaxCount;)
+    {
+        u8 *At = Unit;
+        u32 OffsetSize = 4;
+        u64 Length = DwarfIndexRead(&At, 4);
+        if(Length == 0xffffffff)
+        {
+            Length = DwarfIndexRead(&At, 8);
+            OffsetSize = 8;
+        }
+        
+        Unit = At + Length;
+        if(Unit > SectionEnd)
+        {
+            break;
+        }
+        
+        u16 Version = DwarfIndexRead(&At, 2);
+        At += 2; // Padding
+        if(Version != 5)
+        {
+            continue;
+        }
+        
+        u32 CUCount = DwarfIndexRead(&At, 4);
+        u32 LocalTUCount = DwarfIndexRead(&At, 4);
+        u32 ForeignTUCount = DwarfIndexRead(&At, 4);
+        u32 BucketCount = DwarfIndexRead(&At, 4);
+        u32 NameCount = DwarfIndexRead(&At, 4);
+        u32 AbbrevsSize = DwarfIndexRead(&At, 4);
+        u32 AugmentationSize = DwarfIndexRead(&At, 4);
+        At += AugmentationSize;
+        
+        u8 *CUList = At;
+        At += CUCount * OffsetSize + LocalTUCount * OffsetSize + ForeignTUCount * 8;
+        u8 *Buckets = At;
+        At += BucketCount * 4;
+        u8 *Hashes = At;
+        At += BucketCount ? NameCount * 4 : 0;
+        u8 *StringOffsets = At;
+        At += NameCount * OffsetSize;
+        u8 *EntryOffsets = At;
+        At += NameCount * OffsetSize;
+        u8 *Abbrevs = At;
+        u8 *EntryPool = Abbrevs + AbbrevsSize;
+        
+        // Without the hash table the names are searched one by one
+        u32 First = 1;
+        if(BucketCount)
+        {
+            u8 *Bucket = Buckets + (Hash % BucketCount) * 4;
+            First = DwarfIndexRead(&Bucket, 4);
+            if(!First)
+            {
+                continue;
+            }
+        }
+        
+        for(u32 I = First; I <= NameCount && Count < MaxCount; I++)
+        {
+            if(BucketCount)
+            {
+                u8 *HashAt = Hashes + (I - 1) * 4;
+                u32 NameHash = DwarfIndexRead(&HashAt, 4);
+                if(NameHash % BucketCount != Hash % BucketCount)
+                {
+                    break;
+                }
+                else if(NameHash != Hash)
+                {
+                    continue;
+                }
+            }
+            
+            u8 *StringAt = StringOffsets + (I - 1) * OffsetSize;
+            size_t StringOffset = DwarfIndexRead(&StringAt, OffsetSize);
+            if(StringOffset >= Index->StringsSize || !StringMatches(Name, (char *)Index->Strings + StringOffset))
+            {
+                continue;
+            }
+            
+            u8 *EntryAt = EntryOffsets + (I - 1) * OffsetSize;
+            size_t EntryOffset = DwarfIndexRead(&EntryAt, OffsetSize);
+            Count += DwarfDebugNamesReadEntries(EntryPool + EntryOffset, Abbrevs, EntryPool, CUList, CUCount,
+                                                OffsetSize, Tag, &Result[Count], MaxCount - Count);
+        }
+    }
+    
+    return Count;
+}
+
+// NOTE(mateusz): .gdb_index only knows which compile units define the name, the DIEs
+// are looked up among the children of these units later on.
+static u32
+DwarfGdbIndexLookup(di_name_index *Index, char *Name, u32 Tag, di_name_entry *Result, u32 MaxCount)
+{
+    u32 Count = 0;
+    
+    if(Index->TableSize < 6 * sizeof(u32))
+    {
+        return Count;
+    }
+    
+    // Versions before 7 don't say what kind of symbol the name is
+    u8 *At = Index->Table;
+    u32 Version = DwarfIndexRead(&At, 4);
+    u32 CUListOffset = DwarfIndexRead(&At, 4);
+    u32 TypesListOffset = DwarfIndexRead(&At, 4);
+    At += 4; // Address area
+    u32 SymbolsOffset = DwarfIndexRead(&At, 4);
+    u32 PoolOffset = DwarfIndexRead(&At, 4);
+    if(Version < 7 || PoolOffset > Index->TableSize)
+    {
+        return Count;
+    }
+    
+    u32 CUCount = (TypesListOffset - CUListOffset) / 16;
+    u32 SlotsCount = (PoolOffset - SymbolsOffset) / 8;
+    if(!SlotsCount)
+    {
+        return Count;
+    }
+    
+    u32 Hash = 0;
+    for(char *C = Name; *C; C++)
+    {
+        Hash = Hash * 67 + tolower(*C) - 113;
+    }
+    
+    // Symbols of the same kind as the tag, variables are 2 and functions are 3
+    u32 WantedKind = Tag == DW_TAG_subprogram ? 3 : 2;
+    u32 Mask = SlotsCount - 1;
+    u32 Step = ((Hash * 17) & Mask) | 1;
+    u32 Slot = Hash & Mask;
+    for(u32 Probe = 0; Probe < SlotsCount; Probe++, Slot = (Slot + Step) & Mask)
+    {
+        u8 *SlotAt = Index->Table + SymbolsOffset + Slot * 8;
+        u32 NameOffset = DwarfIndexRead(&SlotAt, 4);
+        u32 VectorOffset = DwarfIndexRead(&SlotAt, 4);
+        if(!NameOffset && !VectorOffset)
+        {
+            break;
+        }
+        
+        if(!StringMatches(Name, (char *)Index->Table + PoolOffset + NameOffset))
+        {
+            continue;
+        }
+        
+        u8 *Vector = Index->Table + PoolOffset + VectorOffset;
+        u32 VectorCount = DwarfIndexRead(&Vector, 4);
+        for(u32 I = 0; I < VectorCount && Count < MaxCount; I++)
+        {
+            u32 Value = DwarfIndexRead(&Vector, 4);
+            u32 CUIndex = Value & 0xffffff;
+            u32 Kind = (Value >> 28) & 0x7;
+            if(Kind == WantedKind && CUIndex < CUCount)
+            {
+                u8 *CUAt = Index->Table + CUListOffset + CUIndex * 16;
+                di_name_entry *Entry = &Result[Count++];
+                Entry->Tag = Tag;
+                Entry->CUOffset = DwarfIndexRead(&CUAt, 8);
+                Entry->DIEOffset = 0;
+            }
+        }
+        
+        break;
+    }
+    
+    return Count;
+}
+
+static u32
+DwarfNameEntryLowPCs(debug_info *ModuleDI, di_name_entry *Entry, char *Name, size_t *Result, u32 MaxCount)
+{
+    u32 Count = 0;
+    Dwarf_Debug Debug = ModuleDI->Debug;
+    
+    if(Entry->DIEOffset)
+    {
+        Dwarf_Die DIE = 0x0;
+        if(dwarf_offdie_b(Debug, Entry->DIEOffset, true, &DIE, 0x0) == DW_DLV_OK)
+        {
+            // Declarations and functions that were only inlined have no address
+            Dwarf_Addr LowPC = 0;
+            if(MaxCount > 0 && dwarf_lowpc(DIE, &LowPC, 0x0) == DW_DLV_OK)
+            {
+                Result[Count++] = LowPC + ModuleDI->LoadBias;
+            }
+            
+            dwarf_dealloc(Debug, DIE, DW_DLA_DIE);
+        }
+        
+        return Count;
+    }
+    
+    Dwarf_Off CUDIEOffset = 0;
+    Dwarf_Die CUDIE = 0x0;
+    if(dwarf_get_cu_die_offset_given_cu_header_offset_b(Debug, Entry->CUOffset, true, &CUDIEOffset, 0x0) != DW_DLV_OK ||
+       dwarf_offdie_b(Debug, CUDIEOffset, true, &CUDIE, 0x0) != DW_DLV_OK)
+    {
+        return Count;
+    }
+    
+    Count = DwarfCollectNamedLowPCs(ModuleDI, CUDIE, Entry->Tag, Name, Result, Count, MaxCount);
+    dwarf_dealloc(Debug, CUDIE, DW_DLA_DIE);
+    
+    return Count;
+}
+
+// NOTE(mateusz): .gdb_index only tells the compile unit, the function can be nested
+// in a namespace, a class or another function so the whole tree of the unit is walked.
+static u32
+DwarfCollectNamedLowPCs(debug_info *ModuleDI, Dwarf_Die DIE, u32 Tag, char *Name, size_t *Result, u32 Count, u32 MaxCount)
+{
+    Dwarf_Debug Debug = ModuleDI->Debug;
+    
+    Dwarf_Die ChildDIE = 0x0;
+    i32 DIEResult = dwarf_child(DIE, &ChildDIE, 0x0);
+    while(DIEResult == DW_DLV_OK && Count < MaxCount)
+    {
+        Dwarf_Half ChildTag = 0;
+        char *DIEName = 0x0;
+        Dwarf_Addr LowPC = 0;
+        if(dwarf_tag(ChildDIE, &ChildTag, 0x0) == DW_DLV_OK && ChildTag == Tag &&
+           dwarf_diename(ChildDIE, &DIEName, 0x0) == DW_DLV_OK && StringMatches(Name, DIEName) &&
+           dwarf_lowpc(ChildDIE, &LowPC, 0x0) == DW_DLV_OK)
+        {
+            Result[Count++] = LowPC + ModuleDI->LoadBias;
+        }
+        
+        Count = DwarfCollectNamedLowPCs(ModuleDI, ChildDIE, Tag, Name, Result, Count, MaxCount);
+        
+        Dwarf_Die SiblingDIE = 0x0;
+        DIEResult = dwarf_siblingof(Debug, ChildDIE, &SiblingDIE, 0x0);
+        dwarf_dealloc(Debug, ChildDIE, DW_DLA_DIE);
+        ChildDIE = SiblingDIE;
+    }
+    
+    if(DIEResult == DW_DLV_OK)
+    {
+        dwarf_dealloc(Debug, ChildDIE, DW_DLA_DIE);
+    }
+    
+    return Count;
+}
+
+// NOTE(mateusz): Modules with a name index are searched without reading their DIEs,
+// the ones without it are only searched once they are loaded.
+static u32
+DwarfFindFunctionsByName(di_module *Module, char *Name, size_t *Result, u32 MaxCount)
+{
+    u32 Count = 0;
+    debug_info *ModuleDI = &Module->DI;
+    
+    DwarfModuleFindSymbols(Module);
+    if(DwarfOpenNameIndex(ModuleDI))
+    {
+        di_name_entry Entries[MAX_NAME_ENTRIES] = {};
+        u32 EntriesCount = DwarfNameIndexLookup(&ModuleDI->NameIndex, Name, DW_TAG_subprogram, Entries, MAX_NAME_ENTRIES);
+        
+        for(u32 I = 0; I < EntriesCount && Count < MaxCount; I++)
+        {
+            size_t Addresses[MAX_NAME_ENTRIES] = {};
+            u32 AddressesCount = DwarfNameEntryLowPCs(ModuleDI, &Entries[I], Name, Addresses, MAX_NAME_ENTRIES);
+            
+            // A function can be listed by its compile unit more than once
+            for(u32 A = 0; A < AddressesCount && Count < MaxCount; A++)
+            {
+                bool Duplicate = false;
+                for(u32 R = 0; R < Count && !Duplicate; R++)
+                {
+                    Duplicate = Result[R] == Addresses[A];
+                }
+                
+                if(!Duplicate)
+                {
+                    Result[Count++] = Addresses[A];
+                }
+            }
+        }
+    }
+    else if(Module->Loaded)
+    {
+        for(u32 I = 0; I < ModuleDI->FunctionsCount && Count < MaxCount; I++)
+        {
+            di_function *Func = &ModuleDI->Functions[I];
+            if(Func->Name && StringMatches(Name, Func->Name))
+            {
+                Result[Count++] = Func->FuncLexScope.LowPC;
+            }
+        }
+    }
+    
+    return Count;
+}
+
+// NOTE(mateusz): Globals of the current module outside of the compile unit of the
+// program counter. With a name index only the units that define the name are searched.
+static di_variable *
+DwarfFindGlobalVariableByName(char *Name)
+{
+    di_name_entry Entries[MAX_NAME_ENTRIES] = {};
+    u32 EntriesCount = 0;
+    bool Indexed = DwarfOpenNameIndex(DI);
+    if(Indexed)
+    {
+        EntriesCount = DwarfNameIndexLookup(&DI->NameIndex, Name, DW_TAG_variable, Entries, MAX_NAME_ENTRIES);
+    }
+    
+    for(u32 I = 0; I < DI->CompileUnitsCount; I++)
+    {
+        di_compile_unit *CU = &DI->CompileUnits[I];
+        
+        bool Listed = !Indexed;
+        for(u32 E = 0; E < EntriesCount && !Listed; E++)
+        {
+            Dwarf_Off CUDIEOffset = 0;
+            Listed = dwarf_get_cu_die_offset_given_cu_header_offset_b(DI->Debug, Entries[E].CUOffset, true, &CUDIEOffset, 0x0) == DW_DLV_OK &&
+                CUDIEOffset == CU->Offset;
+        }
+        
+        for(u32 V = 0; Listed && V < CU->GlobalVariablesCount; V++)
+        {
+            di_variable *Var = &CU->GlobalVariables[V];
+            if(Var->Name && StringMatches(Name, Var->Name))
+            {
+                return Var;
+            }
+        }
+    }
+    
+    return 0x0;
+}
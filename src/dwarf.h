@@ -121,7 +121,7 @@ struct di_restrict_type
     size_t ActualTypeOffset;
 };
 
-struct di_struct_member
+struct di_member
 {
     char *Name;
     
@@ -129,34 +129,31 @@ struct di_struct_member
     u32 ByteLocation;
 };
 
-struct di_struct_type
+// NOTE(mateusz): Structs and unions are the same thing, members of an union just
+// have ByteLocation = 0. Member names are interned, the hash is keyed by the
+// pointer and it is built on the first lookup by name.
+struct di_aggregate_type
 {
     char *Name;
     
     size_t DIEOffset;
     size_t ByteSize;
-    di_struct_member *Members;
+    di_member *Members;
     u32 MembersCount;
-};
 
-struct di_union_member
-{
-    char *Name;
-    
-    size_t ActualTypeOffset;
-    u32 ByteLocation;
+    u32 *MembersHash;
+    u32 MembersHashCapacity;
 };
 
-struct di_union_type
+struct di_interned_string
 {
-    char *Name;
-    
-    size_t DIEOffset;
-    size_t ByteSize;
-    di_union_member *Members;
-    u32 MembersCount;
+    char *String;
+    u32 Hash;
 };
 
+#define DI_INTERNED_STRINGS_INITIAL_CAPACITY 1024
+#define DI_MEMBER_OWNER_UNION (1u << 31)
+
 struct di_array_type
 {
     size_t DIEOffset;
@@ -172,8 +169,8 @@ struct di_underlaying_type
     union
     {
         void *Ptr;
-        di_struct_type *Struct;
-        di_union_type *Union;
+        di_aggregate_type *Struct;
+        di_aggregate_type *Union;
         di_base_type *Type;
     };
     
@@ -182,32 +179,76 @@ struct di_underlaying_type
     type_flags Flags;
 };
 
+// NOTE(mateusz): Location expressions are decoded once when the DIE is read, so
+// evaluating them on every stop only walks a small array of ops. Operands of
+// DW_OP_entry_value and DW_OP_implicit_value are unpacked at decode time as well.
+struct di_loc_op
+{
+    u8 Atom;
+    u64 Operand1;
+    u64 Operand2;
+};
+
+// NOTE(mateusz): A plain location expression is a single entry with Always set,
+// location lists have one entry per PC range (already offset by the LoadBias).
+struct di_loc_entry
+{
+    size_t LowPC;
+    size_t HighPC;
+    bool Always;
+    di_loc_op *Ops;
+    u32 OpsCount;
+};
+
+struct di_location_list
+{
+    di_loc_entry *Entries;
+    u32 EntriesCount;
+};
+
+enum
+{
+    LOCATION_UNAVAILABLE,
+    LOCATION_MEMORY,
+    LOCATION_REGISTER,
+    LOCATION_VALUE,
+};
+typedef u8 location_kind;
+
+// NOTE(mateusz): Value is an address, a DWARF register number or the value itself
+// depending on the Kind. Size of 0 means the piece spans the whole variable.
+struct di_location_piece
+{
+    location_kind Kind;
+    u32 Size;
+    size_t Value;
+};
+
+#define MAX_LOCATION_PIECES 8
+#define MAX_LOCATION_STACK 32
+
+struct di_location
+{
+    di_location_piece Pieces[MAX_LOCATION_PIECES];
+    u32 PiecesCount;
+};
+
 struct di_variable
 {
     char *Name;
     
     size_t TypeOffset;
-    u8 LocationAtom;
 	bool ValidUnderlayingType;
-    ssize_t Offset;
+    di_location_list Location;
 	di_underlaying_type Underlaying;
 };
 
-struct scoped_vars
-{
-    di_variable *Global;
-    u32 GlobalCount;
-    di_variable *Param;
-    u32 ParamCount;
-    di_variable *Local;
-    u32 LocalCount;
-};
-
 struct di_lexical_scope
 {
     // NOTE(mateusz): If RangesCount == 0, then address information is stored
-    // in LowPC and HighPC, otherwise, LowPC and HighPC are zeroed and addresses
-    // are stores in RangesLowPCs and RangesHighPCs and there are RangesCount of them
+    // in LowPC and HighPC, otherwise, addresses are stores in RangesLowPCs and
+    // RangesHighPCs and there are RangesCount of them. LowPC and HighPC are zeroed
+    // then, except for functions where they are the range with the entry.
     size_t LowPC;
     size_t HighPC;
     size_t *RangesLowPCs;
@@ -218,23 +259,58 @@ struct di_lexical_scope
     u32 VariablesCount;
 };
 
+#define MAX_SCOPE_BLOCKS 16
+
+// NOTE(mateusz): Blocks are the lexical blocks the address is in, innermost first,
+// names are looked up in them before the locals of the function itself.
+struct scoped_vars
+{
+    di_variable *Global;
+    u32 GlobalCount;
+    di_variable *Param;
+    u32 ParamCount;
+    di_variable *Local;
+    u32 LocalCount;
+    di_lexical_scope *Blocks[MAX_SCOPE_BLOCKS];
+    u32 BlocksCount;
+};
+
+// NOTE(mateusz): A DW_TAG_inlined_subroutine, the body of Name inlined into the
+// function that owns it. Calls are stored in DIE order so a call always comes
+// before the calls inlined into it, Depth is 1 for calls inlined directly
+// into the function.
+struct di_inlined_call
+{
+    char *Name;
+    di_lexical_scope LexScope;
+    u32 CallLine;
+    u32 Depth;
+};
+
+#define MAX_INLINED_DEPTH 16
+
 struct di_function
 {
     char *Name;
     
     size_t TypeOffset;
-    bool FrameBaseIsCFA;
+    di_location_list FrameBase;
     di_variable *Params;
     u32 ParamCount;
     di_lexical_scope FuncLexScope;
     di_lexical_scope *LexScopes;
     u32 LexScopesCount;
+    di_inlined_call *InlinedCalls;
+    u32 InlinedCallsCount;
 };
 
 struct di_compile_unit
 {
     char *Name;
+    // Section offset of the CU DIE, read back with dwarf_offdie_b
     size_t Offset;
+    // DW_AT_low_pc, what the DWARF 4 ranges of the CU and its scopes are relative to
+    size_t BaseAddress;
     
     size_t *RangesLowPCs;
     size_t *RangesHighPCs;
@@ -250,9 +326,68 @@ struct di_compile_unit
 
 #define MAX_DI_SOURCE_FILES 8
 
+struct di_type_node
+{
+    size_t DIEOffset;
+    di_underlaying_type Underlaying;
+    char *TypeString;
+};
+
+#define DI_TYPE_NODES_INITIAL_CAPACITY 256
+
+enum
+{
+    NAME_INDEX_NONE,
+    NAME_INDEX_DEBUG_NAMES,
+    NAME_INDEX_GDB_INDEX,
+};
+typedef u8 name_index_kind;
+
+// NOTE(mateusz): Accelerator table of a module, names are looked up in it without
+// reading any of the DIEs. Table and Strings point into the cached ELF file.
+struct di_name_index
+{
+    name_index_kind Kind;
+    bool Read;
+    
+    u8 *Table;
+    size_t TableSize;
+    u8 *Strings;
+    size_t StringsSize;
+};
+
+// Section offsets, DIEOffset is 0 when the index only knows the compile unit
+struct di_name_entry
+{
+    u32 Tag;
+    size_t CUOffset;
+    size_t DIEOffset;
+};
+
+#define MAX_NAME_ENTRIES 64
+
+// NOTE(mateusz): Function symbols of .symtab and .dynsym sorted by their address,
+// code without DWARF is named with them. Names are offsets into a single buffer.
+struct elf_symbol
+{
+    size_t Address;
+    u32 Size;
+    u32 NameOffset;
+};
+
 struct debug_info
 {
     arena Arena;
+
+    // NOTE(mateusz): Addresses read from DWARF are offsets for PIE executables and
+    // shared objects, LoadBias turns them into addresses of the running process.
+    char *Path;
+    size_t LoadBias;
+
+    // NOTE(mateusz): File the DWARF sections are read from, either Path itself or a
+    // separate debug file found through the build-id or .gnu_debuglink. CFA is
+    // always read from Path, separate debug files don't carry .eh_frame.
+    char *SymbolsPath;
     
     di_src_file *SourceFiles;
     u32 SourceFilesCount;
@@ -268,6 +403,9 @@ struct debug_info
     di_lexical_scope *LexScopes;
     u32 LexScopesCount;
     
+    di_inlined_call *InlinedCalls;
+    u32 InlinedCallsCount;
+    
     di_function *Functions;
     u32 FunctionsCount;
     
@@ -289,22 +427,25 @@ struct debug_info
     di_restrict_type *RestrictTypes;
     u32 RestrictTypesCount;
     
-    di_struct_member *StructMembers;
-    u32 StructMembersCount;
+    di_member *Members;
+    u32 MembersCount;
     
-    di_struct_type *StructTypes;
+    di_aggregate_type *StructTypes;
     u32 StructTypesCount;
     
-    di_union_member *UnionMembers;
-    u32 UnionMembersCount;
-    
-    di_union_type *UnionTypes;
+    di_aggregate_type *UnionTypes;
     u32 UnionTypesCount;
     
     di_array_type *ArrayTypes;
     u32 ArrayTypesCount;
     
     di_frame_info FrameInfo;
+    di_name_index NameIndex;
+
+    elf_symbol *ElfSymbols;
+    u32 ElfSymbolsCount;
+    char *ElfSymbolNames;
+    bool ElfSymbolsRead;
     Dwarf_Debug Debug;
     int DwarfFd;
 
@@ -312,30 +453,141 @@ struct debug_info
     Dwarf_Debug CFADebug = 0;
 
     i32 DIEIndentLevel;
+
+    // NOTE(mateusz): DIEs of every split unit are numbered from 0 inside of their .dwo
+    // sections, each unit gets its own base so the offsets of types don't collide.
+    size_t DIEOffsetBase;
+    u32 SplitUnitsCount;
     i32 LastUnionIndent;
     
     bool WasStruct = false;
     bool WasUnion = false;
 
+    // NOTE(mateusz): Which aggregate every member was read for, the members are only
+    // grouped by their aggregate once all of the DIEs are read.
+    u32 *MemberOwners;
+
+    // NOTE(mateusz): The same code runs in many frames (recursion, calls from other
+    // depths), the CFA is only reused for the same stack pointer.
 	address_range CFAAddrRange;
+	size_t CFAStackPointer;
 	size_t CachedCFA;
+
+    // NOTE(mateusz): Open addressing on the type DIE offset, every offset is resolved
+    // through the per kind arrays once and its type string is formatted once.
+    di_type_node *TypeNodes;
+    u32 TypeNodesCount;
+    u32 TypeNodesCapacity;
+
+    di_interned_string *InternedStrings;
+    u32 InternedStringsCount;
+    u32 InternedStringsCapacity;
+};
+
+// NOTE(mateusz): The full DIEs of a skeleton compile unit built with -gsplit-dwarf,
+// found in its .dwo file or in the .dwp package next to the executable.
+struct di_split_unit
+{
+    i32 Fd;
+    Dwarf_Debug Debug;
+    Dwarf_Die CUDIE;
+};
+
+#define DI_SPLIT_UNIT_OFFSET_SHIFT 40
+
+// NOTE(mateusz): Every file mapped into the debugee is a module, the debug info
+// of a module is only read the first time an address inside of it is looked up.
+struct di_module
+{
+    char Path[PATH_MAX];
+    char SymbolsPath[PATH_MAX];
+    address_range AddrRange;
+    bool Loaded;
+    debug_info DI;
+};
+
+#define MAX_DI_MODULES 256
+
+// NOTE(mateusz): Every file with DWARF sections is opened once per session and the
+// handle is shared by all of the later DwarfOpenSymbolsHandle calls until the file
+// changes on disk. Its SHF_COMPRESSED sections are inflated the first time libdwarf
+// is pointed at it, reading only the ELF symbols or the code doesn't pay for it.
+// dwarf_elf_init takes the section headers as they are when it starts, so all of
+// the .debug_ sections of the file are inflated at that point and not one by one.
+struct di_elf_file
+{
+    char Path[PATH_MAX];
+    i32 Fd;
+    Elf *ElfHandle;
+    struct timespec ModifyTime;
+    size_t FileSize;
+    u32 Users;
+    
+    bool Inflated;
+    void **Buffers;
+    u32 BuffersCount;
+};
+
+// Symbols and call frames of a module can live in two different files
+#define MAX_ELF_FILES (2 * MAX_DI_MODULES)
+
+// Older elf.h headers only know about zlib
+#ifndef ELFCOMPRESS_ZSTD
+#define ELFCOMPRESS_ZSTD 2
+#endif
+
+struct di_inflate_job
+{
+    Elf_Data *Data;
+    u8 *Result;
+    size_t ResultSize;
+    bool Inflated;
 };
 
 /*
  * Dwarf functions prototypes
  */
 static void     DwarfClearAll();
-static bool     DwarfOpenSymbolsHandle(i32 *Fd, Dwarf_Debug *Debug);
+static bool     DwarfOpenSymbolsHandle(char *Path, i32 *Fd, Dwarf_Debug *Debug);
 static void     DwarfCloseSymbolsHandle(i32 *Fd, Dwarf_Debug *Debug);
+static di_elf_file *   DwarfOpenElfFile(char *Path);
+static void     DwarfCloseElfFile(di_elf_file *File);
+static void     DwarfInflateSections(di_elf_file *File);
+static void *   DwarfInflateWorker(void *Arg);
 static void     DwarfReadDIE(Dwarf_Debug Debug, Dwarf_Die DIE);
 static void     DwarfReadDIEMany(Dwarf_Debug Debug, Dwarf_Die DIE);
+static void     DwarfDecodeLocation(Dwarf_Die DIE, Dwarf_Attribute Attribute, di_location_list *Result);
 static void     DwarfCountTags(Dwarf_Debug Debug, Dwarf_Die DIE, u32 CountTable[DWARF_TAGS_COUNT]);
 static void     DwarfRead();
+static void     DwarfReadFrameInfo();
+static size_t   DwarfDIEOffset(Dwarf_Die DIE);
+static i32      DwarfDIETypeOffset(Dwarf_Die DIE, Dwarf_Off *Offset, Dwarf_Error *Error);
+
+/*
+ * Split DWARF functions
+ */
+static bool     DwarfGetDwoID(Dwarf_Die SkeletonDIE, Dwarf_Half UnitType, Dwarf_Sig8 *HeaderSignature, Dwarf_Sig8 *Result);
+static bool     DwarfOpenSplitUnit(Dwarf_Debug Package, Dwarf_Die SkeletonDIE, Dwarf_Sig8 *DwoID, di_split_unit *Unit);
+static void     DwarfCloseSplitUnit(di_split_unit *Unit);
+static void     DwarfReadSplitUnit(di_split_unit *Unit);
+
+/*
+ * Modules functions
+ */
+static void             DwarfModulesInit();
+static void             DwarfModulesRefresh();
+static di_module *      DwarfFindModuleByPath(char *Path);
+static di_module *      DwarfFindModuleByAddress(size_t Address);
+static void             DwarfModuleLoad(di_module *Module);
+static debug_info *     DwarfModuleDebugInfo(size_t Address);
+static void             DwarfSelectModuleByAddress(size_t Address);
+static u32              DwarfModulesGeneration();
+static bool             DwarfModuleCodeSection(di_module *Module, size_t Address, char *Name, address_range *Range, size_t *FileOffset);
 
 /*
  * Dwarf internal representation functions
  */
-static Dwarf_Die DwarfFindDIEByOffset(Dwarf_Debug Debug, Dwarf_Die DIE, size_t Offset);
+static Dwarf_Die DwarfGetCompileUnitDIE(di_compile_unit *CU);
 
 /*
  * Source files functions
@@ -363,26 +615,43 @@ static di_function *    DwarfFindFunctionByAddress(size_t Address);
 static di_variable *    DwarfGetFunctionsFirstVariable(di_function *Func);
 static size_t           DwarfFindEntryPointAddress();
 static char *           DwarfGetFunctionStringRepresentation(di_function *Func, arena *Arena);
+static u32              DwarfFindInlinedCallsByAddress(di_function *Func, size_t Address, di_inlined_call **Result, u32 MaxCount);
+static u32              DwarfGetInlinedDepth(size_t Address);
+static char *           DwarfGetAbstractOriginName(Dwarf_Debug Debug, Dwarf_Attribute Attribute);
 
 /*
  * Variables types functions
  */
 static di_underlaying_type  DwarfFindUnderlayingType(size_t BTDIEOffset);
+static di_underlaying_type  DwarfResolveUnderlayingType(size_t BTDIEOffset);
+static di_type_node *       DwarfGetTypeNode(size_t DIEOffset);
 static char *               DwarfGetTypeStringRepresentation(di_underlaying_type Type, arena *Arena);
+static char *               DwarfGetTypeString(size_t TypeOffset, arena *Arena);
 static char *               DwarfBaseTypeToFormatStr(di_base_type *Type, type_flags TFlag);
 static bool                 DwarfBaseTypeIsFloat(di_base_type *Type);
 static bool                 DwarfBaseTypeIsDoubleFloat(di_base_type *Type);
-static di_struct_member *   DwarfStructGetMemberByName(di_struct_type *Type, char *Name);
-static di_union_member *    DwarfUnionGetMemberByName(di_union_type *Type, char *Name);
+static di_member *          DwarfGetMemberByName(di_aggregate_type *Type, char *Name);
+static void                 DwarfBuildMembersHash(di_aggregate_type *Type);
+static void                 DwarfGroupMembers();
+static u32                  DwarfHashString(char *String);
+static char *               DwarfInternString(char *String);
+static char *               DwarfFindInternedString(char *String);
 static size_t               DwarfGetVariableMemoryAddress(di_variable *Var);
+static di_location          DwarfGetVariableLocation(di_variable *Var);
+static bool                 DwarfGetFrameBase(size_t PC, size_t *Result);
+static bool                 DwarfLocationIsMemory(di_location *Location);
+static u32                  DwarfReadLocationBytes(di_location *Location, u8 *Result, u32 Size);
 static u32                  DwarfParseTypeStringToBytes(di_underlaying_type *Underlaying, char *String, u8 *Result);
 static scoped_vars          DwarfGetScopedVars(size_t PC);
+static di_lexical_scope *   DwarfFindInnermostLexicalScope(di_function *Func, size_t Address);
 static di_variable *        DwarfFindVariableByNameInScope(scoped_vars Scope, char *Name);
 
 /*
  * Lexical scopes functions
  */
 static bool DwarfAddressConfinedByLexicalScope(di_lexical_scope *LexScope, size_t Address);
+static u32  DwarfReadRanges(Dwarf_Debug Debug, Dwarf_Die DIE, Dwarf_Attribute Attribute, size_t BaseAddress, size_t **LowPCs, size_t **HighPCs);
+static void DwarfReadLexicalScopeRanges(Dwarf_Debug Debug, Dwarf_Die DIE, Dwarf_Attribute Attribute, di_lexical_scope *LexScope);
 
 /*
  * Compile units functions
@@ -396,11 +665,34 @@ static bool                 DwarfAddressConfinedByCompileUnit(di_compile_unit *C
 static bool     DwarfAddressInFrame(size_t Address);
 static bool     DwarfEvalFDE(size_t Address, u32 RegsTableSize, Dwarf_Regtable3 *Result, address_range *InRange);
 static size_t   DwarfCalculateCFA(Dwarf_Regtable3 *Table, x64_registers Registers);
-static size_t   DwarfGetCanonicalFrameAddress(size_t Address);
+static bool     DwarfGetCanonicalFrameAddress(size_t Address, size_t *Result);
+
+/*
+ * Name index functions
+ */
+static u8 *     DwarfGetElfSection(di_elf_file *File, char *Name, size_t *Size);
+static bool     DwarfOpenNameIndex(debug_info *ModuleDI);
+static u32      DwarfNameIndexLookup(di_name_index *Index, char *Name, u32 Tag, di_name_entry *Result, u32 MaxCount);
+static u32      DwarfDebugNamesLookup(di_name_index *Index, char *Name, u32 Tag, di_name_entry *Result, u32 MaxCount);
+static u64      DwarfIndexRead(u8 **At, u32 Size);
+static u64      DwarfIndexReadULEB128(u8 **At);
+static bool     DwarfIndexReadForm(u8 **At, u64 Form, u64 *Value);
+static u32      DwarfDebugNamesReadEntries(u8 *At, u8 *Abbrevs, u8 *AbbrevsEnd, u8 *CUList, u32 CUCount, u32 OffsetSize, u32 Tag, di_name_entry *Result, u32 MaxCount);
+static u32      DwarfGdbIndexLookup(di_name_index *Index, char *Name, u32 Tag, di_name_entry *Result, u32 MaxCount);
+static u32      DwarfNameEntryLowPCs(debug_info *ModuleDI, di_name_entry *Entry, char *Name, size_t *Result, u32 MaxCount);
+static u32      DwarfCollectNamedLowPCs(debug_info *ModuleDI, Dwarf_Die DIE, u32 Tag, char *Name, size_t *Result, u32 Count, u32 MaxCount);
+static u32      DwarfFindFunctionsByName(di_module *Module, char *Name, size_t *Result, u32 MaxCount);
+static di_variable * DwarfFindGlobalVariableByName(char *Name);
 
 /*
  * Elf related functions
  */
 static bool DwarfIsExectuablePIE();
+static void DwarfFindSymbolsPath(char *Path, char *Result);
+static void DwarfModuleFindSymbols(di_module *Module);
+static u32  DwarfCollectElfSymbols(di_elf_file *File, size_t LoadBias, elf_symbol *Result, char *Names, u32 *NamesSize);
+static int  DwarfCompareElfSymbols(const void *A, const void *B);
+static void DwarfReadElfSymbols(debug_info *ModuleDI);
+static char *DwarfFindElfSymbolByAddress(size_t Address, size_t *Offset);
 
 #endif //DWARF_H
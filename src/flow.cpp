@@ -69,22 +69,51 @@ static void
 BreakpointEnable(breakpoint *BP)
 {
     BP->State.Enabled = true;
-    BP->SavedOpCodes = ptrace(PTRACE_PEEKDATA, Debugee.PID, BP->Address, 0x0);
+    BP->SavedOpCodes = ptrace(PTRACE_PEEKDATA, Debugee.TID, BP->Address, 0x0);
     
     u64 TrapInterupt = 0xcc; // int 3
     u64 OpCodesInt3 = (BP->SavedOpCodes & ~0xff) | TrapInterupt;
-    ptrace(PTRACE_POKEDATA, Debugee.PID, BP->Address, OpCodesInt3);
+    ptrace(PTRACE_POKEDATA, Debugee.TID, BP->Address, OpCodesInt3);
 }
 
 static void
 BreakpointDisable(breakpoint *BP)
 {
     BP->State.Enabled = false;
-    size_t MachineWord = DebugeePeekMemory(&Debugee, BP->Address);
+    size_t MachineWord = ptrace(PTRACE_PEEKDATA, Debugee.TID, BP->Address, 0x0);
 
     size_t PokeData = (MachineWord & (~0xff)) | (BP->SavedOpCodes & 0xff);
     
-    ptrace(PTRACE_POKEDATA, Debugee.PID, BP->Address, PokeData);
+    ptrace(PTRACE_POKEDATA, Debugee.TID, BP->Address, PokeData);
+}
+
+// NOTE(mateusz): Breakpoints of a single command (stepping over a call, stepping out)
+// are kept with the temporary ones so that other threads hitting them are told apart
+// from the user breakpoints. Nothing is pushed where a breakpoint already is.
+static void
+BreakpointPushTemp(size_t Address)
+{
+    if(!BreakpointFind(Address) && TempBreakpointsCount < MAX_TEMP_BREAKPOINT_COUNT)
+    {
+        breakpoint *BP = &TempBreakpoints[TempBreakpointsCount++];
+        (*BP) = BreakpointCreate(Address);
+        BreakpointEnable(BP);
+    }
+}
+
+static void
+BreakpointClearTemp()
+{
+    for(u32 I = 0; I < TempBreakpointsCount; I++)
+    {
+        if(BreakpointEnabled(&TempBreakpoints[I]))
+        {
+            BreakpointDisable(&TempBreakpoints[I]);
+        }
+    }
+
+    memset(TempBreakpoints, 0, sizeof(TempBreakpoints[0]) * TempBreakpointsCount);
+    TempBreakpointsCount = 0;
 }
 
 static void
@@ -108,16 +137,49 @@ BreakpointPushAtSourceLine(di_src_file *Src, u32 LineNum, breakpoint *BPs, u32 *
     }
 }
 
+static void
+BreakpointToggleAtSourceLine(u32 SrcFileIndex, u32 LineNum)
+{
+    di_src_line *Line = DwarfFindLineByNumber(LineNum, SrcFileIndex);
+    if(!Line)
+    {
+        return;
+    }
+
+    breakpoint *BP = BreakpointFind(Line->Address);
+    if(BreakpointEnabled(BP))
+    {
+        BreakpointDisable(BP);
+    }
+    else if(BP)
+    {
+        BreakpointEnable(BP);
+    }
+    else
+    {
+        BreakpointPushAtSourceLine(&DI->SourceFiles[SrcFileIndex], LineNum, Breakpoints, &BreakpointCount);
+    }
+}
+
+// NOTE(mateusz): A name can resolve to more places than there are breakpoints, every
+// module can give MAX_NAME_ENTRIES of them, the ones that don't fit are counted in Dropped.
 static bool
-BreakAtFunctionName(char *Name)
+BreakAtFunctionName(char *Name, u32 *Dropped)
 {
     bool Result = false;
+    *Dropped = 0;
 
     for(u32 I = 0; I < DI->FunctionsCount; I++)
     {
         di_function *Func = &DI->Functions[I];
         if(StringMatches(Name, Func->Name))
         {
+            if(BreakpointCount >= MAX_BREAKPOINT_COUNT)
+            {
+                *Dropped += 1;
+                continue;
+            }
+
             breakpoint BP = BreakpointCreate(Func->FuncLexScope.LowPC);
             BreakpointEnable(&BP);
             Breakpoints[BreakpointCount++] = BP;
@@ -125,6 +187,37 @@ BreakAtFunctionName(char *Name)
         }
     }
 
+    // NOTE(mateusz): Other modules are searched through their name index, so the
+    // libraries don't get read only to find a single function.
+    for(u32 I = 0; I < ModulesCount; I++)
+    {
+        if(&Modules[I].DI == DI)
+        {
+            continue;
+        }
+        
+        size_t Addresses[MAX_NAME_ENTRIES] = {};
+        u32 AddressesCount = DwarfFindFunctionsByName(&Modules[I], Name, Addresses, MAX_NAME_ENTRIES);
+        for(u32 A = 0; A < AddressesCount; A++)
+        {
+            if(BreakpointFind(Addresses[A]))
+            {
+                continue;
+            }
+
+            if(BreakpointCount >= MAX_BREAKPOINT_COUNT)
+            {
+                *Dropped += 1;
+                continue;
+            }
+            
+            breakpoint BP = BreakpointCreate(Addresses[A]);
+            BreakpointEnable(&BP);
+            Breakpoints[BreakpointCount++] = BP;
+            Result = true;
+        }
+    }
+
     return Result;
 }
 
@@ -171,7 +264,7 @@ BreakAtAddress(char *AddressStr)
 
     u64 Address = 0;
 
-    if(StringHasChar(Gui->BreakAddress, 'x'))
+    if(StringHasChar(AddressStr, 'x'))
     {
         Address = StringHexToInt(AddressStr);
     }
@@ -254,7 +347,8 @@ BreakAtCurcialInstrsInRange(address_range Range, bool BreakCalls, breakpoint *Br
         
         if(Type & INST_TYPE_RET)
         {
-            size_t ReturnAddress = DebugeeGetReturnAddress(&Debugee, DebugeeGetProgramCounter(&Debugee));
+            size_t ReturnAddress = 0x0;
+            DebugeeGetReturnAddress(&Debugee, DebugeeGetProgramCounter(&Debugee), &ReturnAddress);
 
             bool AddressInAnyCompileUnit = DwarfFindCompileUnitByAddress(ReturnAddress) != 0x0;
             if(AddressInAnyCompileUnit && !BreakpointFind(ReturnAddress, Breakpoints, (*BreakpointsCount)))
@@ -305,7 +399,8 @@ BreakAtCurcialInstrsInRange(address_range Range, bool BreakCalls, breakpoint *Br
                 else 
                 {
                     address_range JumpToNextLine = DwarfGetAddressRangeUntilNextLine(JumpAddress);
-                    if(JumpToNextLine.Start != Range.Start && JumpToNextLine.End != Range.End)
+                    // No line at the target gives an empty range
+                    if(JumpToNextLine.End && JumpToNextLine.Start != Range.Start && JumpToNextLine.End != Range.End)
                     {
                         BreakAtCurcialInstrsInRange(JumpToNextLine, false, Breakpoints, BreakpointsCount);
                     }
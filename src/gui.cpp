@@ -238,13 +238,412 @@ GuiShowBreakpoints()
         }
         else
         {
-            char *FileName = StringFindLastChar(DI->SourceFiles[BP->FileIndex].Path, '/') + 1;
+            debug_info *ModuleDI = DwarfModuleDebugInfo(BP->Address);
+            char *FileName = StringFindLastChar(ModuleDI->SourceFiles[BP->FileIndex].Path, '/') + 1;
             ImGui::TextColored(Color, "Breakpoint at %s:%u (%lX) [%s]\n",
                                FileName, BP->SourceLine, BP->Address, StateString);
         }
     }
 }
 
+static void
+GuiMemoryViewGoTo(memory_view *View, size_t Address)
+{
+    memory_region Regions[MAX_MEMORY_REGIONS];
+    u32 RegionsCount = DebugeeGetMemoryRegions(&Debugee, Regions, ARRAY_LENGTH(Regions));
+
+    View->Start = Address & ~(size_t)(MEMORY_VIEW_ROW_BYTES - 1);
+    View->End = View->Start + MEMORY_PAGE_SIZE;
+    View->ScrollReset = true;
+    sprintf(View->AddressBuffer, "0x%lx", Address);
+
+    for(u32 I = 0; I < RegionsCount; I++)
+    {
+        if(Address >= Regions[I].Start && Address < Regions[I].End)
+        {
+            View->End = MIN(Regions[I].End, View->Start + MEMORY_VIEW_SPAN);
+            break;
+        }
+    }
+}
+
+static memory_page *
+GuiMemoryGetPage(memory_view *View, size_t Address)
+{
+    size_t PageAddress = Address & ~(size_t)(MEMORY_PAGE_SIZE - 1);
+    memory_page *Page = &View->Pages[(PageAddress / MEMORY_PAGE_SIZE) % MEMORY_PAGE_CACHE_COUNT];
+
+    if(!Page->Valid || Page->Address != PageAddress || Page->StopSequence != Tracer.SnapshotConsumed)
+    {
+        Page->Address = PageAddress;
+        Page->StopSequence = Tracer.SnapshotConsumed;
+        Page->ReadBytes = DebugeeReadMemory(&Debugee, PageAddress, Page->Bytes, MEMORY_PAGE_SIZE);
+        Page->Valid = true;
+    }
+
+    return Page;
+}
+
+static u32
+GuiMemoryParsePattern(memory_view *View, u8 *Pattern, u32 PatternSize)
+{
+    u32 Result = 0;
+    View->SearchError = 0x0;
+
+    if(!View->SearchHex)
+    {
+        Result = MIN(StringLength(View->SearchBuffer), PatternSize);
+        memcpy(Pattern, View->SearchBuffer, Result);
+
+        return Result;
+    }
+
+    u32 Nibbles = 0;
+    for(char *C = View->SearchBuffer; C[0]; C++)
+    {
+        u8 Nibble = 0;
+        if(C[0] == ' ')
+        {
+            continue;
+        }
+        else if(C[0] >= '0' && C[0] <= '9')
+        {
+            Nibble = C[0] - '0';
+        }
+        else if(TO_LOWERCASE(C[0]) >= 'a' && TO_LOWERCASE(C[0]) <= 'f')
+        {
+            Nibble = TO_LOWERCASE(C[0]) - 'a' + 10;
+        }
+        else
+        {
+            View->SearchError = "Not a hex digit in the pattern";
+            return 0;
+        }
+
+        if(Nibbles / 2 == PatternSize)
+        {
+            View->SearchError = "Pattern is too long";
+            return 0;
+        }
+
+        Pattern[Nibbles / 2] = (Nibbles % 2) ? (Pattern[Nibbles / 2] << 4) | Nibble : Nibble;
+        Nibbles += 1;
+    }
+
+    if(Nibbles % 2)
+    {
+        View->SearchError = "Odd number of hex digits in the pattern";
+        return 0;
+    }
+
+    Result = Nibbles / 2;
+
+    return Result;
+}
+
+// NOTE(mateusz): The search only takes a snapshot of the mappings here, the scan
+// itself is done by GuiMemorySearchStep over the next frames so a few gigabytes of
+// heap don't freeze the window.
+static void
+GuiMemorySearchBegin(memory_view *View)
+{
+    View->SearchResultsCount = 0;
+    View->SearchedBytes = 0;
+    View->SearchSkippedBytes = 0;
+    View->Searching = false;
+
+    View->SearchPatternLength = GuiMemoryParsePattern(View, View->SearchPattern, sizeof(View->SearchPattern));
+    if(!View->SearchPatternLength)
+    {
+        return;
+    }
+
+    bool Truncated = false;
+    View->SearchRegionsCount = DebugeeGetMemoryRegions(&Debugee, View->SearchRegions,
+                                                       ARRAY_LENGTH(View->SearchRegions), &Truncated);
+    View->SearchTruncated = Truncated;
+    View->SearchRegion = 0;
+    View->SearchAddress = View->SearchRegionsCount ? View->SearchRegions[0].Start : 0x0;
+    View->SearchStopSequence = Tracer.SnapshotConsumed;
+    View->Searching = true;
+}
+
+// NOTE(mateusz): Every readable mapping is read in MEMORY_SEARCH_CHUNK_SIZE pieces
+// and scanned with memmem. Consecutive chunks overlap by one byte less than the
+// pattern so a match that crosses the boundary is still found exactly once. At most
+// MEMORY_SEARCH_FRAME_BYTES are read in one frame.
+static void
+GuiMemorySearchStep(memory_view *View)
+{
+    if(View->SearchStopSequence != Tracer.SnapshotConsumed)
+    {
+        View->Searching = false;
+        View->SearchError = "The program ran before the search was done";
+        return;
+    }
+
+    scratch_arena Scratch(MEMORY_SEARCH_CHUNK_SIZE + 64);
+    u8 *Chunk = ArrayPush(Scratch, u8, MEMORY_SEARCH_CHUNK_SIZE);
+    u32 PatternLength = View->SearchPatternLength;
+
+    size_t Budget = MEMORY_SEARCH_FRAME_BYTES;
+    while(Budget > 0)
+    {
+        if(View->SearchRegion >= View->SearchRegionsCount ||
+           View->SearchResultsCount >= MAX_MEMORY_SEARCH_RESULTS)
+        {
+            View->Searching = false;
+            break;
+        }
+
+        memory_region *Region = &View->SearchRegions[View->SearchRegion];
+        size_t Address = View->SearchAddress;
+        if(!Region->Readable || Address >= Region->End)
+        {
+            View->SearchRegion += 1;
+            if(View->SearchRegion < View->SearchRegionsCount)
+            {
+                View->SearchAddress = View->SearchRegions[View->SearchRegion].Start;
+            }
+
+            continue;
+        }
+
+        size_t ToRead = MIN(MEMORY_SEARCH_CHUNK_SIZE, Region->End - Address);
+        size_t Read = DebugeeReadMemory(&Debugee, Address, Chunk, ToRead);
+        Budget = Budget > ToRead ? Budget - ToRead : 0;
+
+        if(Read >= PatternLength)
+        {
+            View->SearchedBytes += Read;
+
+            u8 *Head = Chunk;
+            u8 *ChunkEnd = Chunk + Read;
+            while(View->SearchResultsCount < MAX_MEMORY_SEARCH_RESULTS)
+            {
+                u8 *Match = (u8 *)memmem(Head, ChunkEnd - Head, View->SearchPattern, PatternLength);
+                if(!Match)
+                {
+                    break;
+                }
+
+                View->SearchResults[View->SearchResultsCount++] = Address + (Match - Chunk);
+                Head = Match + 1;
+            }
+        }
+
+        if(Read < ToRead)
+        {
+            // A page that can't be read (guard pages, MMIO) only costs that page,
+            // the rest of the mapping is still searched.
+            size_t BadPage = (Address + Read) & ~(size_t)(MEMORY_PAGE_SIZE - 1);
+            View->SearchAddress = BadPage + MEMORY_PAGE_SIZE;
+            View->SearchSkippedBytes += MEMORY_PAGE_SIZE;
+        }
+        else if(Address + Read >= Region->End)
+        {
+            View->SearchAddress = Region->End;
+        }
+        else
+        {
+            View->SearchAddress = Address + Read - (PatternLength - 1);
+        }
+    }
+
+    // Keep drawing frames until the scan is done
+    Debuger.InputChange = true;
+}
+
+static void
+GuiShowMemory()
+{
+    memory_view *View = &Gui->Memory;
+    if(View->End == 0x0)
+    {
+        GuiMemoryViewGoTo(View, Debugee.Regs.RSP);
+    }
+
+    ImGui::PushItemWidth(200.0f);
+    if(ImGui::InputText("Address", View->AddressBuffer, sizeof(View->AddressBuffer),
+                        ImGuiInputTextFlags_EnterReturnsTrue))
+    {
+        size_t Address = 0x0;
+        if(StringHasChar(View->AddressBuffer, 'x'))
+        {
+            Address = StringHexToInt(View->AddressBuffer);
+        }
+        else
+        {
+            Address = atol(View->AddressBuffer);
+        }
+
+        GuiMemoryViewGoTo(View, Address);
+    }
+    ImGui::SameLine();
+
+    bool Search = ImGui::InputText("Find", View->SearchBuffer, sizeof(View->SearchBuffer),
+                                   ImGuiInputTextFlags_EnterReturnsTrue);
+    ImGui::PopItemWidth();
+    ImGui::SameLine();
+    ImGui::Checkbox("Hex", &View->SearchHex);
+    ImGui::SameLine();
+    if(ImGui::Button("Search") || Search)
+    {
+        GuiMemorySearchBegin(View);
+    }
+
+    if(View->Searching)
+    {
+        GuiMemorySearchStep(View);
+    }
+
+    if(View->SearchError)
+    {
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(0.8f, 0.2f, 0.0f, 1.0f), View->SearchError);
+    }
+    else if(View->Searching)
+    {
+        ImGui::SameLine();
+        ImGui::Text("Searching, %u matches in %lu MB so far", View->SearchResultsCount, View->SearchedBytes / Megabytes(1));
+    }
+    else if(View->SearchedBytes)
+    {
+        ImGui::SameLine();
+        ImGui::Text("%u matches in %lu MB", View->SearchResultsCount, View->SearchedBytes / Megabytes(1));
+
+        if(View->SearchSkippedBytes)
+        {
+            ImGui::SameLine();
+            ImGui::Text("(%lu KB could not be read)", View->SearchSkippedBytes / Kilobytes(1));
+        }
+    }
+
+    if(View->SearchTruncated && !View->SearchError && (View->Searching || View->SearchedBytes))
+    {
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(0.8f, 0.2f, 0.0f, 1.0f), "Only the first %u mappings are searched", MAX_MEMORY_REGIONS);
+    }
+
+    if(View->SearchResultsCount)
+    {
+        ImGui::BeginChild("memory_results", ImVec2(160.0f, 0.0f), true);
+        for(u32 I = 0; I < View->SearchResultsCount; I++)
+        {
+            char Label[32] = {};
+            sprintf(Label, "%016lx", View->SearchResults[I]);
+            if(ImGui::Selectable(Label))
+            {
+                GuiMemoryViewGoTo(View, View->SearchResults[I]);
+            }
+        }
+        ImGui::EndChild();
+        ImGui::SameLine();
+    }
+
+    ImGui::BeginChild("memory_rows");
+    if(View->ScrollReset)
+    {
+        ImGui::SetScrollY(0.0f);
+        View->ScrollReset = false;
+    }
+
+    i32 RowsCount = (View->End - View->Start + MEMORY_VIEW_ROW_BYTES - 1) / MEMORY_VIEW_ROW_BYTES;
+
+    ImGuiListClipper Clipper = {};
+    Clipper.Begin(RowsCount, ImGui::GetTextLineHeightWithSpacing());
+    while(Clipper.Step())
+    {
+        for(i32 I = Clipper.DisplayStart; I < Clipper.DisplayEnd; I++)
+        {
+            size_t RowAddress = View->Start + I * MEMORY_VIEW_ROW_BYTES;
+            
+            char Line[128] = {};
+            char Ascii[MEMORY_VIEW_ROW_BYTES + 1] = {};
+            char *Cursor = Line;
+            Cursor += sprintf(Cursor, "%016lx  ", RowAddress);
+
+            for(u32 B = 0; B < MEMORY_VIEW_ROW_BYTES; B++)
+            {
+                size_t Address = RowAddress + B;
+                memory_page *Page = GuiMemoryGetPage(View, Address);
+                size_t InPage = Address - Page->Address;
+
+                if(InPage < Page->ReadBytes)
+                {
+                    u8 Byte = Page->Bytes[InPage];
+                    Cursor += sprintf(Cursor, "%02x ", Byte);
+                    Ascii[B] = IS_PRINTABLE(Byte) ? Byte : '.';
+                }
+                else
+                {
+                    Cursor += sprintf(Cursor, "?? ");
+                    Ascii[B] = '?';
+                }
+
+                if(B == MEMORY_VIEW_ROW_BYTES / 2 - 1)
+                {
+                    Cursor += sprintf(Cursor, " ");
+                }
+            }
+
+            sprintf(Cursor, " %s", Ascii);
+            ImGui::TextUnformatted(Line);
+        }
+    }
+    ImGui::EndChild();
+}
+
+// NOTE(mateusz): Only the registers that were already fetched are shown, picking
+// a thread asks the tracer for its registers and makes it the current one.
+static void
+GuiShowThreads()
+{
+    for(u32 I = 0; I < Debugee.ThreadCount; I++)
+    {
+        debugee_thread *Thread = &Debugee.Threads[I];
+        bool Current = Thread->TID == Debugee.TID;
+        char *StateString = "running";
+        if(Thread->Flags.Stopped)
+        {
+            StateString = "stopped";
+        }
+
+        size_t PC = 0x0;
+        if(Current)
+        {
+            PC = Debugee.Regs.RIP;
+        }
+        else if(Thread->Flags.Stopped && Thread->Flags.RegsValid)
+        {
+            PC = Thread->Regs.RIP;
+        }
+
+        char Label[256] = {};
+        if(PC)
+        {
+            di_function *Func = DwarfFindFunctionByAddress(PC);
+            sprintf(Label, "%c %d [%s] %lX %s", Current ? '*' : ' ', Thread->TID, StateString,
+                    PC, (Func && Func->Name) ? Func->Name : "");
+        }
+        else
+        {
+            sprintf(Label, "%c %d [%s]", Current ? '*' : ' ', Thread->TID, StateString);
+        }
+
+        ImGui::PushID(I);
+        if(ImGui::Selectable(Label, Current) && !Current && Thread->Flags.Stopped)
+        {
+            tracer_command Cmd = {};
+            Cmd.Type = TRACER_CMD_SELECT_THREAD;
+            Cmd.ThreadID = Thread->TID;
+            TracerPush(Cmd);
+            TracerWaitIdle();
+        }
+        ImGui::PopID();
+    }
+}
+
 static void
 GuiShowVarInputText(char *Label, char *Buffer, u32 BufferSize)
 {
@@ -329,6 +728,11 @@ GuiShowVariable(variable_representation *Variable, arena *Arena, bool AllowNameE
 {
     // I'm taking a gamble here and seeing if i can leave it like this
     assert(!(Variable->Underlaying.Flags.IsArray && Variable->Underlaying.Flags.IsPointer));
+
+    if(Variable->RefreshSequence != Gui->Transient.VarsSequence)
+    {
+        GuiRefreshVariable(Variable);
+    }
     
     if(Variable->Underlaying.Flags.IsBase && !Variable->Underlaying.Flags.IsArray)
     {
@@ -360,10 +764,11 @@ GuiShowVariable(variable_representation *Variable, arena *Arena, bool AllowNameE
         }
         else
         {
-            ImGui::Text(Variable->ValueString);
+            GuiShowVariableValue(Variable);
         } ImGui::NextColumn();
 
         if(!Gui->Transient.VarInEdit &&
+           !Variable->NotInMemory &&
            ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left) &&
            ImGui::IsItemClicked())
         {            
@@ -378,9 +783,6 @@ GuiShowVariable(variable_representation *Variable, arena *Arena, bool AllowNameE
     else if((Variable->Underlaying.Flags.IsStruct || Variable->Underlaying.Flags.IsUnion) && !Variable->Underlaying.Flags.IsArray)
     {
         // NOTE(mateusz): We are treating unions and struct as the same thing, but with ByteLocation = 0
-        assert(sizeof(di_union_type) == sizeof(di_struct_type));
-        assert(sizeof(di_union_member) == sizeof(di_struct_member));
-
         bool Open = false;
         if(Gui->Transient.VarInEdit && Gui->Transient.VarEditKind == VarEditKind_Name && Gui->Transient.VarInEdit == Variable)
         {
@@ -414,47 +816,52 @@ GuiShowVariable(variable_representation *Variable, arena *Arena, bool AllowNameE
             }
         }
         
-        ImGui::Text(Variable->ValueString); ImGui::NextColumn();
+        GuiShowVariableValue(Variable); ImGui::NextColumn();
         ImGui::Text(Variable->TypeString); ImGui::NextColumn();
 
         if(Open && Gui->Transient.VarInEdit != Variable)
         {
-            if(!Variable->Children)
+            // NOTE(mateusz): A struct kept in registers has no address for its members,
+            // they are cut out of the pieces instead. A pointer to a struct kept in a
+            // register still points to memory.
+            bool HasMembersAddress = !Variable->NotInMemory || Variable->Underlaying.Flags.IsPointer;
+            bool FromPieces = !HasMembersAddress && Variable->ActualVariable;
+            di_aggregate_type *Struct = Variable->Underlaying.Struct;
+            if(FromPieces && (!Variable->Children || Variable->ChildrenStale))
+            {
+                GuiBuildMembersFromPieces(Variable, Arena);
+                Variable->ChildrenStale = false;
+            }
+            else if(!Variable->Children && HasMembersAddress)
             {
                 // No children, build new
-                di_struct_type *Struct = Variable->Underlaying.Struct;
                 Variable->ChildrenCount = Struct->MembersCount;
 
                 Variable->Children = ArrayPush(Arena, variable_representation, Variable->ChildrenCount);
 
                 for(u32 I = 0; I < Struct->MembersCount; I++)
                 {
-                    di_struct_member *Member = &Struct->Members[I];
+                    di_member *Member = &Struct->Members[I];
                     size_t TypeOffset = Member->ActualTypeOffset;
                     char *Name = Member->Name;
-                    size_t Address = 0x0;
-
-                    // TODO(mateusz): I would love to move it somewhere else
-                    if(Variable->Underlaying.Flags.IsPointer)
-                    {
-                        Address = DebugeePeekMemory(&Debugee, Variable->Address);
-                        for(u32 I = 0; I < Variable->Underlaying.PointerCount; I++)
-                        {
-                            Address = DebugeePeekMemory(&Debugee, Variable->Address);
-                        }
-
-                        Address += Member->ByteLocation;
-                    }
-                    else
-                    {
-                        Address = Variable->Address + Member->ByteLocation;
-                    }
+                    size_t Address = GuiMemberAddress(Variable, Member);
 
                     Variable->Children[I] = GuiBuildVariableRepresentation(TypeOffset, Address, Name, 0, Arena);
                 }
+
+                Variable->ChildrenStale = false;
+            }
+            else if(Variable->ChildrenStale && HasMembersAddress)
+            {
+                for(u32 I = 0; I < Variable->ChildrenCount; I++)
+                {
+                    GuiRebaseVariable(&Variable->Children[I], GuiMemberAddress(Variable, &Struct->Members[I]));
+                }
+
+                Variable->ChildrenStale = false;
             }
 
-            for(u32 I = 0; I < Variable->ChildrenCount; I++)
+            for(u32 I = 0; !Variable->ChildrenStale && I < Variable->ChildrenCount; I++)
             {
                 GuiShowVariable(&Variable->Children[I], Arena);
             }
@@ -497,10 +904,20 @@ GuiShowVariable(variable_representation *Variable, arena *Arena, bool AllowNameE
             }
         }
 
-        ImGui::Text(Variable->ValueString); ImGui::NextColumn();
+        GuiShowVariableValue(Variable); ImGui::NextColumn();
         ImGui::Text(Variable->TypeString); ImGui::NextColumn();
 
-        if(Open && Gui->Transient.VarInEdit != Variable)
+        if(Open && Variable->NotInMemory)
+        {
+            ImGui::TreePop();
+        }
+        else if(Open && Gui->Transient.VarInEdit != Variable && Variable->Underlaying.Flags.IsBase)
+        {
+            GuiShowArrayWindow(Variable, Arena);
+
+            ImGui::TreePop();
+        }
+        else if(Open && Gui->Transient.VarInEdit != Variable)
         {
             if(!Variable->Children)
             {
@@ -517,6 +934,18 @@ GuiShowVariable(variable_representation *Variable, arena *Arena, bool AllowNameE
 
                     Variable->Children[I] = GuiBuildVariableRepresentation(TypeOffset, Address, VarNameWI, 0, Arena);
                 }
+
+                Variable->ChildrenStale = false;
+            }
+            else if(Variable->ChildrenStale)
+            {
+                size_t ElementSize = Variable->Underlaying.Type->ByteSize;
+                for(u32 I = 0; I < Variable->ChildrenCount; I++)
+                {
+                    GuiRebaseVariable(&Variable->Children[I], Variable->Address + ElementSize * I);
+                }
+
+                Variable->ChildrenStale = false;
             }
 
             for(u32 I = 0; I < Variable->ChildrenCount; I++)
@@ -532,51 +961,560 @@ GuiShowVariable(variable_representation *Variable, arena *Arena, bool AllowNameE
     }
 }
 
+// NOTE(mateusz): Arrays of base types can be huge, only the rows that the clipper
+// asks for are decoded, elements of structs are still built as children.
 static void
-GuiShowVariables()
+GuiShowArrayWindow(variable_representation *Variable, arena *Arena)
 {
-    size_t PC = DebugeeGetProgramCounter(&Debugee);
-    if(Gui->Transient.LocalsBuildAddress != PC)
+    if(!Variable->Window)
     {
-        ArenaClear(&Gui->Transient.RepresentationArena);
-        Gui->Transient.LocalsBuildAddress = PC;
-        
-        di_compile_unit *CU = DwarfFindCompileUnitByAddress(PC);
-        di_function *Func = DwarfFindFunctionByAddress(PC);
+        array_window *Window = StructPush(Arena, array_window);
+        size_t ElementTypeOffset = Variable->Underlaying.Type->DIEOffset;
+        Window->ElementUnderlaying = DwarfFindUnderlayingType(ElementTypeOffset);
+        Window->ElementTypeString = DwarfGetTypeString(ElementTypeOffset, Arena);
 
-        size_t ToAllocate = CU ? CU->GlobalVariablesCount : 0;
-        if(Func)
+        Variable->Window = Window;
+    }
+
+    array_window *Window = Variable->Window;
+    u32 ElementCount = Variable->Underlaying.ArrayUpperBound + 1;
+
+    array_summary *Summary = &Window->Summary;
+    if(!Summary->Computed || Summary->StopSequence != Tracer.SnapshotConsumed)
+    {
+        GuiArraySummaryCompute(Variable, Summary);
+    }
+
+    ImGui::TextDisabled("summary"); ImGui::NextColumn();
+    ImGui::Text(Summary->String); ImGui::NextColumn();
+    ImGui::NextColumn();
+
+    ImGuiListClipper Clipper = {};
+    Clipper.Begin(ElementCount, ImGui::GetTextLineHeightWithSpacing());
+    while(Clipper.Step())
+    {
+        GuiArrayWindowFetch(Variable, Clipper.DisplayStart, Clipper.DisplayEnd, Arena);
+
+        for(i32 I = Clipper.DisplayStart; I < Clipper.DisplayEnd; I++)
         {
-            ToAllocate += Func->ParamCount + Func->FuncLexScope.VariablesCount;
-            for(u32 I = 0; I < Func->LexScopesCount; I++)
-            {
-                ToAllocate += Func->LexScopes[I].VariablesCount;
-            }
+            GuiShowVariable(&Window->Rows[I - Window->First], Arena);
         }
+    }
+}
 
-        Gui->Transient.Variables = ArrayPush(&Gui->Transient.RepresentationArena, variable_representation, ToAllocate);
-        Gui->Transient.VariableCnt = 0;
+static void
+GuiArrayWindowFetch(variable_representation *Variable, u32 Start, u32 End, arena *Arena)
+{
+    array_window *Window = Variable->Window;
 
-        if(Gui->Flags.VarShowGlobals)
-        {
+    bool Covered = Window->Rows && Window->StopSequence == Tracer.SnapshotConsumed &&
+                   Window->Address == Variable->Address &&
+                   Start >= Window->First && End <= Window->First + Window->Count;
+
+    // The row that is being edited has to stay where it is
+    variable_representation *InEdit = Gui->Transient.VarInEdit;
+    bool Editing = InEdit && Window->Rows && InEdit >= Window->Rows && InEdit < Window->Rows + Window->Count;
+    if(Covered || Editing)
+    {
+        return;
+    }
+
+    // Some rows above and below so that scrolling does not read on every frame
+    u32 ElementCount = Variable->Underlaying.ArrayUpperBound + 1;
+    u32 Margin = End - Start;
+    u32 First = Start > Margin ? Start - Margin : 0;
+    u32 Count = MIN(End + Margin, ElementCount) - First;
+
+    size_t ElementSize = Window->ElementUnderlaying.Type->ByteSize;
+    size_t StartAddress = Variable->Address + First * ElementSize;
+
+    u32 OldCount = Window->Rows ? Window->Count : 0;
+    scratch_arena Scratch(Count * ElementSize + OldCount * sizeof(variable_representation) + 64);
+    u8 *Memory = ArrayPush(Scratch, u8, Count * ElementSize);
+    DebugeeReadMemory(&Debugee, StartAddress, Memory, Count * ElementSize);
+
+    // Rows that were decoded at an earlier stop are compared with the new bytes,
+    // the buffer is reused so they are copied out first
+    variable_representation *OldRows = ArrayPush(Scratch, variable_representation, OldCount);
+    if(OldCount)
+    {
+        memcpy(OldRows, Window->Rows, OldCount * sizeof(variable_representation));
+    }
+    u32 OldFirst = Window->First;
+    bool SameStop = Window->StopSequence == Tracer.SnapshotConsumed && Window->Address == Variable->Address;
+
+    // NOTE(mateusz): The rows, with their names and value strings, are allocated once
+    // and only again when the list gets taller than it ever was, fetching at every
+    // stop and scroll does not grow the arena.
+    u32 NameSize = StringLength(Variable->Name) + 16;
+    if(Count > Window->RowsCapacity)
+    {
+        Window->RowsCapacity = MIN(Count * 2, ElementCount);
+        Window->Rows = ArrayPush(Arena, variable_representation, Window->RowsCapacity);
+
+        char *Names = ArrayPush(Arena, char, Window->RowsCapacity * NameSize);
+        char *Values = ArrayPush(Arena, char, Window->RowsCapacity * VAR_VALUE_STRING_SIZE);
+        for(u32 I = 0; I < Window->RowsCapacity; I++)
+        {
+            Window->Rows[I].Name = &Names[I * NameSize];
+            Window->Rows[I].ValueString = &Values[I * VAR_VALUE_STRING_SIZE];
+        }
+    }
+
+    Window->StopSequence = Tracer.SnapshotConsumed;
+    Window->Address = Variable->Address;
+    Window->First = First;
+    Window->Count = Count;
+    
+    for(u32 I = 0; I < Count; I++)
+    {
+        variable_representation *Row = &Window->Rows[I];
+        Row->Underlaying = Window->ElementUnderlaying;
+        Row->TypeString = Window->ElementTypeString;
+        Row->Address = StartAddress + I * ElementSize;
+        Row->Changed = false;
+
+        sprintf(Row->Name, "%s[%u]", Variable->Name, First + I);
+
+        memset(Row->ValueString, 0, VAR_VALUE_STRING_SIZE);
+        GuiBaseValueToString(Row->Underlaying.Type, &Memory[I * ElementSize], Row->ValueString);
+
+        Row->RefreshSequence = Gui->Transient.VarsSequence;
+        u32 ValueBytes = MIN(ElementSize, sizeof(Row->ValueBytes));
+        memcpy(Row->ValueBytes, &Memory[I * ElementSize], ValueBytes);
+
+        u32 Index = First + I;
+        if(Index >= OldFirst && Index < OldFirst + OldCount)
+        {
+            variable_representation *OldRow = &OldRows[Index - OldFirst];
+            Row->Changed = SameStop ? OldRow->Changed : memcmp(OldRow->ValueBytes, Row->ValueBytes, ValueBytes) != 0;
+        }
+    }
+}
+
+// NOTE(mateusz): The whole array is read once in chunks of ARRAY_SUMMARY_CHUNK_SIZE
+// so a big buffer does not need a matching allocation. Floats go through the
+// vector kernels, SSE2 is always there on x86-64 and AVX is picked when the
+// check in DebugerCreate found it. Other base types take the scalar path.
+static void
+GuiArraySummaryCompute(variable_representation *Variable, array_summary *Summary)
+{
+    di_base_type *Type = Variable->Window->ElementUnderlaying.Type;
+    size_t ElementSize = Type->ByteSize;
+    u64 ElementCount = Variable->Underlaying.ArrayUpperBound + 1;
+
+    memset(Summary, 0, sizeof(*Summary));
+    Summary->Computed = true;
+    Summary->StopSequence = Tracer.SnapshotConsumed;
+    Summary->FirstNonZero = -1;
+    Summary->Min = INFINITY;
+    Summary->Max = -INFINITY;
+
+    if(ElementSize == 0)
+    {
+        sprintf(Summary->String, "-");
+        return;
+    }
+
+    bool IsFloat = Type->Encoding == DW_ATE_float;
+    bool UseAVX = Debuger.RegsFlags.HasAVX;
+
+    scratch_arena Scratch(ARRAY_SUMMARY_CHUNK_SIZE + 64);
+    u8 *Chunk = ArrayPush(Scratch, u8, ARRAY_SUMMARY_CHUNK_SIZE);
+    u64 ElementsPerChunk = ARRAY_SUMMARY_CHUNK_SIZE / ElementSize;
+
+    for(u64 First = 0; First < ElementCount; First += ElementsPerChunk)
+    {
+        u64 InChunk = MIN(ElementsPerChunk, ElementCount - First);
+        size_t Address = Variable->Address + First * ElementSize;
+        size_t Read = DebugeeReadMemory(&Debugee, Address, Chunk, InChunk * ElementSize);
+
+        bool Partial = Read != InChunk * ElementSize;
+        InChunk = Read / ElementSize;
+
+        if(IsFloat && ElementSize == sizeof(f32))
+        {
+            if(UseAVX) { GuiArraySummaryF32AVX((f32 *)Chunk, InChunk, First, Summary); }
+            else { GuiArraySummaryF32SSE2((f32 *)Chunk, InChunk, First, Summary); }
+        }
+        else if(IsFloat && ElementSize == sizeof(f64))
+        {
+            if(UseAVX) { GuiArraySummaryF64AVX((f64 *)Chunk, InChunk, First, Summary); }
+            else { GuiArraySummaryF64SSE2((f64 *)Chunk, InChunk, First, Summary); }
+        }
+        else
+        {
+            GuiArraySummaryScalar(Type, Chunk, InChunk, First, Summary);
+        }
+
+        if(Partial)
+        {
+            break;
+        }
+    }
+
+    u64 Numbers = Summary->Count - Summary->NaNCount;
+    if(Numbers == 0)
+    {
+        sprintf(Summary->String, "no values, NaN %lu", Summary->NaNCount);
+        return;
+    }
+
+    f64 Mean = Summary->Sum / (f64)Numbers;
+    char *Cursor = Summary->String;
+    Cursor += sprintf(Cursor, "min %g, max %g, mean %g", Summary->Min, Summary->Max, Mean);
+    if(IsFloat)
+    {
+        Cursor += sprintf(Cursor, ", NaN %lu", Summary->NaNCount);
+    }
+
+    if(Summary->FirstNonZero >= 0)
+    {
+        sprintf(Cursor, ", first nonzero [%ld]", Summary->FirstNonZero);
+    }
+    else
+    {
+        sprintf(Cursor, ", all zero");
+    }
+
+    if(Summary->Count != ElementCount)
+    {
+        LOG_GUI("Summary read only %lu out of %lu elements", Summary->Count, ElementCount);
+    }
+}
+
+static void
+GuiArraySummaryAddValue(array_summary *Summary, f64 Value, u64 Index)
+{
+    Summary->Count += 1;
+
+    if(Value != Value)
+    {
+        Summary->NaNCount += 1;
+        if(Summary->FirstNonZero < 0)
+        {
+            Summary->FirstNonZero = Index;
+        }
+
+        return;
+    }
+
+    Summary->Min = MIN(Summary->Min, Value);
+    Summary->Max = MAX(Summary->Max, Value);
+    Summary->Sum += Value;
+
+    if(Summary->FirstNonZero < 0 && Value != 0.0)
+    {
+        Summary->FirstNonZero = Index;
+    }
+}
+
+static void
+GuiArraySummaryScalar(di_base_type *Type, u8 *Bytes, u64 Count, u64 BaseIndex, array_summary *Summary)
+{
+    bool Signed = Type->Encoding == DW_ATE_signed || Type->Encoding == DW_ATE_signed_char;
+    
+    for(u64 I = 0; I < Count; I++)
+    {
+        u8 *Element = &Bytes[I * Type->ByteSize];
+        f64 Value = 0.0;
+
+        switch(Type->ByteSize)
+        {
+        case 1:
+        {
+            Value = Signed ? (f64)*(i8 *)Element : (f64)*(u8 *)Element;
+        }break;
+        case 2:
+        {
+            Value = Signed ? (f64)*(i16 *)Element : (f64)*(u16 *)Element;
+        }break;
+        case 4:
+        {
+            Value = Signed ? (f64)*(i32 *)Element : (f64)*(u32 *)Element;
+        }break;
+        case 8:
+        {
+            Value = Signed ? (f64)*(i64 *)Element : (f64)*(u64 *)Element;
+        }break;
+        default:
+        {
+            LOG_GUI("Unsupported byte size = %d", Type->ByteSize);
+            return;
+        }break;
+        }
+
+        GuiArraySummaryAddValue(Summary, Value, BaseIndex + I);
+    }
+}
+
+// NOTE(mateusz): In all of the kernels NaN lanes are replaced with +inf for the
+// min, -inf for the max and 0 for the sum, so the vector min/max never see them.
+// NaN is != 0 so it counts as the first nonzero just like in the scalar path.
+static void
+GuiArraySummaryF32SSE2(f32 *Values, u64 Count, u64 BaseIndex, array_summary *Summary)
+{
+    __m128 Zero = _mm_setzero_ps();
+    __m128 PosInf = _mm_set1_ps(INFINITY);
+    __m128 NegInf = _mm_set1_ps(-INFINITY);
+    __m128 Min = PosInf;
+    __m128 Max = NegInf;
+    __m128d SumLo = _mm_setzero_pd();
+    __m128d SumHi = _mm_setzero_pd();
+    u64 NaNCount = 0;
+
+    u64 I = 0;
+    for(; I + 4 <= Count; I += 4)
+    {
+        __m128 X = _mm_loadu_ps(&Values[I]);
+        __m128 Ordered = _mm_cmpord_ps(X, X);
+        __m128 Clean = _mm_and_ps(Ordered, X);
+
+        NaNCount += 4 - __builtin_popcount(_mm_movemask_ps(Ordered));
+        Min = _mm_min_ps(Min, _mm_or_ps(Clean, _mm_andnot_ps(Ordered, PosInf)));
+        Max = _mm_max_ps(Max, _mm_or_ps(Clean, _mm_andnot_ps(Ordered, NegInf)));
+        SumLo = _mm_add_pd(SumLo, _mm_cvtps_pd(Clean));
+        SumHi = _mm_add_pd(SumHi, _mm_cvtps_pd(_mm_movehl_ps(Clean, Clean)));
+
+        if(Summary->FirstNonZero < 0)
+        {
+            i32 NonZero = _mm_movemask_ps(_mm_cmpneq_ps(X, Zero));
+            if(NonZero)
+            {
+                Summary->FirstNonZero = BaseIndex + I + __builtin_ctz(NonZero);
+            }
+        }
+    }
+
+    f32 MinLanes[4], MaxLanes[4];
+    f64 SumLanes[4];
+    _mm_storeu_ps(MinLanes, Min);
+    _mm_storeu_ps(MaxLanes, Max);
+    _mm_storeu_pd(&SumLanes[0], SumLo);
+    _mm_storeu_pd(&SumLanes[2], SumHi);
+    for(u32 L = 0; L < 4; L++)
+    {
+        Summary->Min = MIN(Summary->Min, MinLanes[L]);
+        Summary->Max = MAX(Summary->Max, MaxLanes[L]);
+        Summary->Sum += SumLanes[L];
+    }
+
+    Summary->Count += I;
+    Summary->NaNCount += NaNCount;
+
+    for(; I < Count; I++)
+    {
+        GuiArraySummaryAddValue(Summary, Values[I], BaseIndex + I);
+    }
+}
+
+static void
+GuiArraySummaryF64SSE2(f64 *Values, u64 Count, u64 BaseIndex, array_summary *Summary)
+{
+    __m128d Zero = _mm_setzero_pd();
+    __m128d PosInf = _mm_set1_pd(INFINITY);
+    __m128d NegInf = _mm_set1_pd(-INFINITY);
+    __m128d Min = PosInf;
+    __m128d Max = NegInf;
+    __m128d Sum = _mm_setzero_pd();
+    u64 NaNCount = 0;
+
+    u64 I = 0;
+    for(; I + 2 <= Count; I += 2)
+    {
+        __m128d X = _mm_loadu_pd(&Values[I]);
+        __m128d Ordered = _mm_cmpord_pd(X, X);
+        __m128d Clean = _mm_and_pd(Ordered, X);
+
+        NaNCount += 2 - __builtin_popcount(_mm_movemask_pd(Ordered));
+        Min = _mm_min_pd(Min, _mm_or_pd(Clean, _mm_andnot_pd(Ordered, PosInf)));
+        Max = _mm_max_pd(Max, _mm_or_pd(Clean, _mm_andnot_pd(Ordered, NegInf)));
+        Sum = _mm_add_pd(Sum, Clean);
+
+        if(Summary->FirstNonZero < 0)
+        {
+            i32 NonZero = _mm_movemask_pd(_mm_cmpneq_pd(X, Zero));
+            if(NonZero)
+            {
+                Summary->FirstNonZero = BaseIndex + I + __builtin_ctz(NonZero);
+            }
+        }
+    }
+
+    f64 MinLanes[2], MaxLanes[2], SumLanes[2];
+    _mm_storeu_pd(MinLanes, Min);
+    _mm_storeu_pd(MaxLanes, Max);
+    _mm_storeu_pd(SumLanes, Sum);
+    for(u32 L = 0; L < 2; L++)
+    {
+        Summary->Min = MIN(Summary->Min, MinLanes[L]);
+        Summary->Max = MAX(Summary->Max, MaxLanes[L]);
+        Summary->Sum += SumLanes[L];
+    }
+
+    Summary->Count += I;
+    Summary->NaNCount += NaNCount;
+
+    for(; I < Count; I++)
+    {
+        GuiArraySummaryAddValue(Summary, Values[I], BaseIndex + I);
+    }
+}
+
+__attribute__((target("avx"))) static void
+GuiArraySummaryF32AVX(f32 *Values, u64 Count, u64 BaseIndex, array_summary *Summary)
+{
+    __m256 Zero = _mm256_setzero_ps();
+    __m256 PosInf = _mm256_set1_ps(INFINITY);
+    __m256 NegInf = _mm256_set1_ps(-INFINITY);
+    __m256 Min = PosInf;
+    __m256 Max = NegInf;
+    __m256d SumLo = _mm256_setzero_pd();
+    __m256d SumHi = _mm256_setzero_pd();
+    u64 NaNCount = 0;
+
+    u64 I = 0;
+    for(; I + 8 <= Count; I += 8)
+    {
+        __m256 X = _mm256_loadu_ps(&Values[I]);
+        __m256 Ordered = _mm256_cmp_ps(X, X, _CMP_ORD_Q);
+        __m256 Clean = _mm256_and_ps(Ordered, X);
+
+        NaNCount += 8 - __builtin_popcount(_mm256_movemask_ps(Ordered));
+        Min = _mm256_min_ps(Min, _mm256_or_ps(Clean, _mm256_andnot_ps(Ordered, PosInf)));
+        Max = _mm256_max_ps(Max, _mm256_or_ps(Clean, _mm256_andnot_ps(Ordered, NegInf)));
+        SumLo = _mm256_add_pd(SumLo, _mm256_cvtps_pd(_mm256_castps256_ps128(Clean)));
+        SumHi = _mm256_add_pd(SumHi, _mm256_cvtps_pd(_mm256_extractf128_ps(Clean, 1)));
+
+        if(Summary->FirstNonZero < 0)
+        {
+            i32 NonZero = _mm256_movemask_ps(_mm256_cmp_ps(X, Zero, _CMP_NEQ_UQ));
+            if(NonZero)
+            {
+                Summary->FirstNonZero = BaseIndex + I + __builtin_ctz(NonZero);
+            }
+        }
+    }
+
+    f32 MinLanes[8], MaxLanes[8];
+    f64 SumLanes[8];
+    _mm256_storeu_ps(MinLanes, Min);
+    _mm256_storeu_ps(MaxLanes, Max);
+    _mm256_storeu_pd(&SumLanes[0], SumLo);
+    _mm256_storeu_pd(&SumLanes[4], SumHi);
+    for(u32 L = 0; L < 8; L++)
+    {
+        Summary->Min = MIN(Summary->Min, MinLanes[L]);
+        Summary->Max = MAX(Summary->Max, MaxLanes[L]);
+        Summary->Sum += SumLanes[L];
+    }
+
+    Summary->Count += I;
+    Summary->NaNCount += NaNCount;
+
+    for(; I < Count; I++)
+    {
+        GuiArraySummaryAddValue(Summary, Values[I], BaseIndex + I);
+    }
+}
+
+__attribute__((target("avx"))) static void
+GuiArraySummaryF64AVX(f64 *Values, u64 Count, u64 BaseIndex, array_summary *Summary)
+{
+    __m256d Zero = _mm256_setzero_pd();
+    __m256d PosInf = _mm256_set1_pd(INFINITY);
+    __m256d NegInf = _mm256_set1_pd(-INFINITY);
+    __m256d Min = PosInf;
+    __m256d Max = NegInf;
+    __m256d Sum = _mm256_setzero_pd();
+    u64 NaNCount = 0;
+
+    u64 I = 0;
+    for(; I + 4 <= Count; I += 4)
+    {
+        __m256d X = _mm256_loadu_pd(&Values[I]);
+        __m256d Ordered = _mm256_cmp_pd(X, X, _CMP_ORD_Q);
+        __m256d Clean = _mm256_and_pd(Ordered, X);
+
+        NaNCount += 4 - __builtin_popcount(_mm256_movemask_pd(Ordered));
+        Min = _mm256_min_pd(Min, _mm256_or_pd(Clean, _mm256_andnot_pd(Ordered, PosInf)));
+        Max = _mm256_max_pd(Max, _mm256_or_pd(Clean, _mm256_andnot_pd(Ordered, NegInf)));
+        Sum = _mm256_add_pd(Sum, Clean);
+
+        if(Summary->FirstNonZero < 0)
+        {
+            i32 NonZero = _mm256_movemask_pd(_mm256_cmp_pd(X, Zero, _CMP_NEQ_UQ));
+            if(NonZero)
+            {
+                Summary->FirstNonZero = BaseIndex + I + __builtin_ctz(NonZero);
+            }
+        }
+    }
+
+    f64 MinLanes[4], MaxLanes[4], SumLanes[4];
+    _mm256_storeu_pd(MinLanes, Min);
+    _mm256_storeu_pd(MaxLanes, Max);
+    _mm256_storeu_pd(SumLanes, Sum);
+    for(u32 L = 0; L < 4; L++)
+    {
+        Summary->Min = MIN(Summary->Min, MinLanes[L]);
+        Summary->Max = MAX(Summary->Max, MaxLanes[L]);
+        Summary->Sum += SumLanes[L];
+    }
+
+    Summary->Count += I;
+    Summary->NaNCount += NaNCount;
+
+    for(; I < Count; I++)
+    {
+        GuiArraySummaryAddValue(Summary, Values[I], BaseIndex + I);
+    }
+}
+
+static void
+GuiShowVariables()
+{
+    size_t PC = DebugeeGetProgramCounter(&Debugee);
+    if(Gui->Transient.LocalsBuildAddress != PC)
+    {
+        Gui->Transient.LocalsBuildAddress = PC;
+        
+        di_compile_unit *CU = DwarfFindCompileUnitByAddress(PC);
+        di_function *Func = DwarfFindFunctionByAddress(PC);
+
+        size_t ToAllocate = CU ? CU->GlobalVariablesCount : 0;
+        if(Func)
+        {
+            ToAllocate += Func->ParamCount + Func->FuncLexScope.VariablesCount;
+            for(u32 I = 0; I < Func->LexScopesCount; I++)
+            {
+                ToAllocate += Func->LexScopes[I].VariablesCount;
+            }
+        }
+
+        scratch_arena Scratch(ToAllocate * sizeof(di_variable *) + 64);
+        di_variable **InScope = ArrayPush(Scratch, di_variable *, ToAllocate);
+        u32 InScopeCount = 0;
+
+        if(Gui->Flags.VarShowGlobals)
+        {
             for(u32 I = 0; CU && I < CU->GlobalVariablesCount; I++)
             {
                 di_variable *Var = &CU->GlobalVariables[I];
-                if(Var->LocationAtom)
+                if(Var->Location.EntriesCount)
                 {
-                    Gui->Transient.Variables[Gui->Transient.VariableCnt++] = GuiBuildVariableRepresentation(Var, 0, &Gui->Transient.RepresentationArena);
+                    InScope[InScopeCount++] = Var;
                 }
             }
         }
 
-        if(Func && Func->FrameBaseIsCFA)
+        if(Func)
         {
             if(Gui->Flags.VarShowParams)
             {
                 for(u32 I = 0; I < Func->ParamCount; I++)
                 {
-                    di_variable *Param = &Func->Params[I];
-                    Gui->Transient.Variables[Gui->Transient.VariableCnt++] = GuiBuildVariableRepresentation(Param, 0, &Gui->Transient.RepresentationArena);
+                    InScope[InScopeCount++] = &Func->Params[I];
                 }
             }
 
@@ -584,8 +1522,7 @@ GuiShowVariables()
             {
                 for(u32 I = 0; I < Func->FuncLexScope.VariablesCount; I++)
                 {
-                    di_variable *Var = &Func->FuncLexScope.Variables[I];
-                    Gui->Transient.Variables[Gui->Transient.VariableCnt++] = GuiBuildVariableRepresentation(Var, 0, &Gui->Transient.RepresentationArena);
+                    InScope[InScopeCount++] = &Func->FuncLexScope.Variables[I];
                 }
 
                 for(u32 LexScopeIndex = 0;
@@ -593,20 +1530,36 @@ GuiShowVariables()
                     LexScopeIndex++)
                 {
                     di_lexical_scope *LexScope = &Func->LexScopes[LexScopeIndex];
-                    if(DwarfAddressConfinedByLexicalScope(LexScope, DebugeeGetProgramCounter(&Debugee)))
+                    if(DwarfAddressConfinedByLexicalScope(LexScope, PC))
                     {
                         for(u32 I = 0; I < LexScope->VariablesCount; I++)
                         {
-                            di_variable *Var = &LexScope->Variables[I];
-                            Gui->Transient.Variables[Gui->Transient.VariableCnt++] = GuiBuildVariableRepresentation(Var, 0, &Gui->Transient.RepresentationArena);
+                            InScope[InScopeCount++] = &LexScope->Variables[I];
                         }
                     }
                 }
             }
         }
-        else if(Func)
+
+        // NOTE(mateusz): Stepping inside of the same scope keeps the tree, with the
+        // expanded nodes, and the values are refreshed when they are drawn.
+        bool SameVariables = InScopeCount == Gui->Transient.VariableCnt;
+        for(u32 I = 0; SameVariables && I < InScopeCount; I++)
+        {
+            SameVariables = Gui->Transient.Variables[I].ActualVariable == InScope[I];
+        }
+
+        if(!SameVariables)
         {
-            assert(false);
+            ArenaClear(&Gui->Transient.RepresentationArena);
+            
+            Gui->Transient.Variables = ArrayPush(&Gui->Transient.RepresentationArena, variable_representation, InScopeCount);
+            Gui->Transient.VariableCnt = InScopeCount;
+
+            for(u32 I = 0; I < InScopeCount; I++)
+            {
+                Gui->Transient.Variables[I] = GuiBuildVariableRepresentation(InScope[I], 0, &Gui->Transient.RepresentationArena);
+            }
         }
     }
 
@@ -660,7 +1613,20 @@ _GuiShowBreakAtFunctionWindow()
     bool EnterAvaiable = !Gui->Transient.EnterCaptured && KeyboardButtons[GLFW_KEY_ENTER].Pressed;
     if(EnterAvaiable)
     {
-        BreakAtFunctionName(Gui->BreakFuncName);
+        tracer_command Cmd = {};
+        Cmd.Type = TRACER_CMD_BREAK_AT_FUNCTION;
+        StringCopy(Cmd.Text, Gui->BreakFuncName);
+        TracerPush(Cmd);
+        TracerWaitIdle();
+
+        if(Tracer.BreakpointsDropped)
+        {
+            char Buff[256] = {};
+            snprintf(Buff, sizeof(Buff), "%u places of %s got no breakpoint, all %d are in use",
+                     Tracer.BreakpointsDropped, Gui->BreakFuncName, MAX_BREAKPOINT_COUNT);
+            GuiSetStatusText(Buff);
+        }
+
         memset(Gui->BreakFuncName, 0, sizeof(Gui->BreakFuncName));
         Gui->ModalFuncShow = 0x0;
         Gui->Transient.EnterCaptured = true;
@@ -704,8 +1670,12 @@ _GuiShowBreakAtFunctionWindow()
                 {
                     Gui->ModalFuncShow = 0x0;
                     memset(Gui->BreakFuncName, 0, sizeof(Gui->BreakFuncName));
-                    BreakAtAddress(Repr->ActualFunction->FuncLexScope.LowPC);
-                    DebugerUpdateTransient(&Debuger);
+
+                    tracer_command Cmd = {};
+                    Cmd.Type = TRACER_CMD_BREAK_AT_ADDRESS;
+                    Cmd.Address = Repr->ActualFunction->FuncLexScope.LowPC;
+                    TracerPush(Cmd);
+                    TracerWaitIdle();
 
                     goto END;
                     return;
@@ -714,6 +1684,37 @@ _GuiShowBreakAtFunctionWindow()
         }
     }
 
+    // Other modules only give exact matches
+    if(!StringEmpty(Gui->BreakFuncName))
+    {
+        if(!StringMatches(Gui->BreakFuncName, Gui->Transient.FuncLookupName))
+        {
+            GuiLookupFunctionInModules(Gui->BreakFuncName);
+        }
+
+        for(u32 I = 0; I < Gui->Transient.FuncLookupCount; I++)
+        {
+            di_module *Module = &Modules[Gui->Transient.FuncLookupModules[I]];
+            char *ModuleName = StringFindLastChar(Module->Path, '/') + 1;
+
+            char Label[PATH_MAX + 160] = {};
+            snprintf(Label, sizeof(Label), "%s in %s###func_lookup%u", Gui->BreakFuncName, ModuleName, I);
+            if(ImGui::Selectable(Label))
+            {
+                Gui->ModalFuncShow = 0x0;
+                memset(Gui->BreakFuncName, 0, sizeof(Gui->BreakFuncName));
+
+                tracer_command Cmd = {};
+                Cmd.Type = TRACER_CMD_BREAK_AT_ADDRESS;
+                Cmd.Address = Gui->Transient.FuncLookupAddresses[I];
+                TracerPush(Cmd);
+                TracerWaitIdle();
+
+                goto END;
+            }
+        }
+    }
+
 END:;
         
     ImGui::EndChild();
@@ -730,6 +1731,9 @@ GuiShowBreakAtFunction()
     ImVec2 Center(ImGui::GetIO().DisplaySize.x * 0.5f, ImGui::GetIO().DisplaySize.y * 0.5f);
     ImGui::SetNextWindowPos(Center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
     Gui->ModalFuncShow = _GuiShowBreakAtFunctionWindow;
+
+    // Libraries could have been loaded since the last lookup
+    memset(Gui->Transient.FuncLookupName, 0, sizeof(Gui->Transient.FuncLookupName));
 }
 
 static void 
@@ -771,8 +1775,11 @@ _GuiShowBreakAtAddressModalWindow()
         
         if(ImGui::Button("OK", ImVec2(120, 0)))
         {
-            BreakAtAddress(Gui->BreakAddress);
-            DebugerUpdateTransient(&Debuger);
+            tracer_command Cmd = {};
+            Cmd.Type = TRACER_CMD_BREAK_AT_ADDRESS;
+            StringCopy(Cmd.Text, Gui->BreakAddress);
+            TracerPush(Cmd);
+            TracerWaitIdle();
             
             ImGui::CloseCurrentPopup(); 
             memset(Gui->BreakAddress, 0, sizeof(Gui->BreakAddress));
@@ -802,36 +1809,231 @@ GuiShowBreakAtAddress()
     Gui->ModalFuncShow = _GuiShowBreakAtAddressModalWindow;
 }
 
-static void
-_GuiShowOpenFileModalWindow()
+static u64
+_GuiParseAddress(char *AddressStr)
 {
-    if(KeyboardButtons[GLFW_KEY_ESCAPE].Pressed)
-    {
-        Gui->ModalFuncShow = 0x0;
-        return;
-    }
-    
-    ImGuiWindowFlags WinFlags = ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoCollapse;
-    ImGui::Begin("File to open", 0x0, WinFlags);
-
-    f32 FourFifths = 4.0f / 5.0f;
-    ImVec2 WinSize(FourFifths * Gui->WindowWidth, FourFifths * Gui->WindowHeight);
-    ImVec2 Center(ImGui::GetIO().DisplaySize.x * 0.5f, ImGui::GetIO().DisplaySize.y * 0.5f);
-    Center.x -= WinSize.x * 0.5f;
-    Center.y -= WinSize.y * 0.5f;
-
-    ImGui::SetWindowSize(WinSize);
-    ImGui::SetWindowPos(Center);
-    
-    ImGui::Text("Select the file's name you wish to open");
-    ImGui::Separator();
+    return StringHasChar(AddressStr, 'x') ? StringHexToInt(AddressStr) : atol(AddressStr);
+}
 
-    ImGui::BeginChild("options");
+static void
+_GuiShowDisassembleRangeModalWindow()
+{
+    char *DisassembleRangeLabel = "Range to disassemble";
     
-    for(auto Bucket = DI->ExecSrcFileList.Head; Bucket != 0x0; Bucket = Bucket->Next)
+    if(ImGui::BeginPopupModal(DisassembleRangeLabel))
     {
-        for(u32 I = 0; I < Bucket->Count; I++)
-        {
+        bool Close = KeyboardButtons[GLFW_KEY_ESCAPE].Pressed;
+        
+        struct AddressTextFilter
+        {
+            // Return 0 when we pass and 1 when we don't.
+            static int
+            LettersWithX(ImGuiInputTextCallbackData* Data)
+            {
+                if(Data->EventChar < 256 && strchr("0123456789abcdefxABCDEFX", (char)Data->EventChar))
+                {
+                    return 0; // pass
+                }
+
+                return 1; // no pass
+            }
+        };
+        
+        ImGui::Text("Enter the start and the end of the range, hex or decimal");
+        ImGui::Separator();
+        
+        ImGui::InputText("Start", Gui->DisasmRangeStart, sizeof(Gui->DisasmRangeStart),
+                         ImGuiInputTextFlags_CallbackCharFilter, AddressTextFilter::LettersWithX);
+        ImGui::InputText("End", Gui->DisasmRangeEnd, sizeof(Gui->DisasmRangeEnd),
+                         ImGuiInputTextFlags_CallbackCharFilter, AddressTextFilter::LettersWithX);
+        
+        if(ImGui::Button("OK", ImVec2(120, 0)))
+        {
+            address_range Range = {};
+            Range.Start = _GuiParseAddress(Gui->DisasmRangeStart);
+            Range.End = _GuiParseAddress(Gui->DisasmRangeEnd);
+            DisasmStreamOpen(Range);
+            DisasmStream.ScrollToAddress = Range.Start;
+            Close = true;
+        }
+        
+        ImGui::SetItemDefaultFocus();
+        ImGui::SameLine();
+        if(ImGui::Button("Cancel", ImVec2(120, 0)))
+        {
+            Close = true;
+        }
+        
+        if(Close)
+        {
+            ImGui::CloseCurrentPopup();
+            memset(Gui->DisasmRangeStart, 0, sizeof(Gui->DisasmRangeStart));
+            memset(Gui->DisasmRangeEnd, 0, sizeof(Gui->DisasmRangeEnd));
+            Gui->ModalFuncShow = 0x0;
+        }
+        ImGui::EndPopup();
+    }
+}
+
+static void
+GuiShowDisassembleRange()
+{
+    char *DisassembleRangeLabel = "Range to disassemble";
+    ImGui::OpenPopup(DisassembleRangeLabel);
+    ImVec2 Center(ImGui::GetIO().DisplaySize.x * 0.5f, ImGui::GetIO().DisplaySize.y * 0.5f);
+    ImGui::SetNextWindowPos(Center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
+    
+    Gui->ModalFuncShow = _GuiShowDisassembleRangeModalWindow;
+}
+
+static void
+_GuiShowStepLinesModalWindow()
+{
+    char *StepLinesLabel = "Lines to step over";
+    
+    if(ImGui::BeginPopupModal(StepLinesLabel))
+    {
+        bool Close = KeyboardButtons[GLFW_KEY_ESCAPE].Pressed;
+        
+        ImGui::Text("Step over lines until a breakpoint or until the condition is not zero");
+        ImGui::Separator();
+        
+        ImGui::InputInt("Lines", &Gui->StepLinesCount);
+        Gui->StepLinesCount = MAX(Gui->StepLinesCount, 1);
+        ImGui::InputText("Condition", Gui->StepCondition, sizeof(Gui->StepCondition));
+        
+        if(!StringEmpty(Gui->StepConditionError))
+        {
+            ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", Gui->StepConditionError);
+        }
+        
+        if(ImGui::Button("OK", ImVec2(120, 0)))
+        {
+            // NOTE(mateusz): Only the syntax is checked here so that a typo shows right
+            // away. The names can be locals of a function the debugee steps into, the
+            // tracer compiles it in every one of them.
+            scratch_arena Scratch;
+            char *Error = 0x0;
+            if(!StringEmpty(Gui->StepCondition))
+            {
+                WLangCheckSyntax(Gui->StepCondition, &Error, Scratch);
+            }
+            
+            memset(Gui->StepConditionError, 0, sizeof(Gui->StepConditionError));
+            if(Error)
+            {
+                strncpy(Gui->StepConditionError, Error, sizeof(Gui->StepConditionError) - 1);
+            }
+            else
+            {
+                tracer_command Cmd = {};
+                Cmd.Type = TRACER_CMD_STEP_LINES;
+                Cmd.Count = Gui->StepLinesCount;
+                StringCopy(Cmd.Text, Gui->StepCondition);
+                TracerPush(Cmd);
+                Close = true;
+            }
+        }
+        
+        ImGui::SetItemDefaultFocus();
+        ImGui::SameLine();
+        if(ImGui::Button("Cancel", ImVec2(120, 0)))
+        {
+            Close = true;
+        }
+        
+        if(Close)
+        {
+            ImGui::CloseCurrentPopup();
+            memset(Gui->StepConditionError, 0, sizeof(Gui->StepConditionError));
+            Gui->ModalFuncShow = 0x0;
+        }
+        ImGui::EndPopup();
+    }
+}
+
+static void
+GuiShowStepLines()
+{
+    char *StepLinesLabel = "Lines to step over";
+    ImGui::OpenPopup(StepLinesLabel);
+    ImVec2 Center(ImGui::GetIO().DisplaySize.x * 0.5f, ImGui::GetIO().DisplaySize.y * 0.5f);
+    ImGui::SetNextWindowPos(Center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
+    
+    Gui->ModalFuncShow = _GuiShowStepLinesModalWindow;
+}
+
+// NOTE(mateusz): Right click menu of the last drawn source line or instruction,
+// the next statement can only be moved inside of the function the debugee is in.
+// Source lines also pass their line to be found in the disassembly.
+static void
+GuiShowCodeContextMenu(size_t Address, size_t PC, di_src_line *Line)
+{
+    ImGui::PushID((void *)Address);
+    if(ImGui::BeginPopupContextItem("Code context"))
+    {
+        if(ImGui::MenuItem("Run to cursor", 0x0, false, Address != PC))
+        {
+            tracer_command Cmd = {};
+            Cmd.Type = TRACER_CMD_RUN_TO_ADDRESS;
+            Cmd.Address = Address;
+            TracerPush(Cmd);
+        }
+        
+        di_function *Func = DwarfFindFunctionByAddress(PC);
+        bool SameFunction = Func && DwarfAddressConfinedByFunction(Func, Address);
+        if(ImGui::MenuItem("Set next statement", 0x0, false, SameFunction && Address != PC))
+        {
+            tracer_command Cmd = {};
+            Cmd.Type = TRACER_CMD_SET_NEXT_STATEMENT;
+            Cmd.Address = Address;
+            TracerPush(Cmd);
+        }
+
+        disasm_line_run *Run = Line ? DisasmFindLineRun(Line->SrcFileIndex, Line->LineNum) : 0x0;
+        if(Line && ImGui::MenuItem("Show in disassembly", 0x0, false, Run != 0x0))
+        {
+            Gui->DisasmShowLine = true;
+            Gui->DisasmScrollToLine = true;
+            Gui->DisasmShowFileIndex = Line->SrcFileIndex;
+            Gui->DisasmShowLineNum = Line->LineNum;
+        }
+        
+        ImGui::EndPopup();
+    }
+    ImGui::PopID();
+}
+
+static void
+_GuiShowOpenFileModalWindow()
+{
+    if(KeyboardButtons[GLFW_KEY_ESCAPE].Pressed)
+    {
+        Gui->ModalFuncShow = 0x0;
+        return;
+    }
+    
+    ImGuiWindowFlags WinFlags = ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoCollapse;
+    ImGui::Begin("File to open", 0x0, WinFlags);
+
+    f32 FourFifths = 4.0f / 5.0f;
+    ImVec2 WinSize(FourFifths * Gui->WindowWidth, FourFifths * Gui->WindowHeight);
+    ImVec2 Center(ImGui::GetIO().DisplaySize.x * 0.5f, ImGui::GetIO().DisplaySize.y * 0.5f);
+    Center.x -= WinSize.x * 0.5f;
+    Center.y -= WinSize.y * 0.5f;
+
+    ImGui::SetWindowSize(WinSize);
+    ImGui::SetWindowPos(Center);
+    
+    ImGui::Text("Select the file's name you wish to open");
+    ImGui::Separator();
+
+    ImGui::BeginChild("options");
+    
+    for(auto Bucket = DI->ExecSrcFileList.Head; Bucket != 0x0; Bucket = Bucket->Next)
+    {
+        for(u32 I = 0; I < Bucket->Count; I++)
+        {
             di_exec_src_file *File = &Bucket->Files[I];
             
             bool NotInternal = File->Name[0] != '_'; // Generally files with '_' at the start are internal
@@ -867,6 +2069,76 @@ GuiClearStatusText()
 {
     Gui->StatusText = 0x0;
 }
+
+static void
+GuiSetStatusFromStop(stop_snapshot *Stop)
+{
+    switch(Stop->Reason)
+    {
+        case STOP_REASON_EXITED:
+        {
+            GuiSetStatusText("Program finished it's execution");
+        }break;
+        case STOP_REASON_SEGFAULT:
+        {
+            GuiSetStatusText("Program seg faulted");
+        }break;
+        case STOP_REASON_ABORTED:
+        {
+            GuiSetStatusText("Program aborted");
+        }break;
+        case STOP_REASON_INTERRUPTED:
+        {
+            GuiSetStatusText("Program interrupted");
+        }break;
+        case STOP_REASON_SIGNAL:
+        {
+            char Buff[128] = {};
+            sprintf(Buff, "Program received signal [%s]", strsignal(Stop->Signal));
+            GuiSetStatusText(Buff);
+        }break;
+        case STOP_REASON_NO_PROGRAM_PATH:
+        {
+            GuiSetStatusText("No program path given");
+        }break;
+        case STOP_REASON_NO_PROGRAM_FILE:
+        {
+            char Buff[2*PATH_MAX] = {};
+            sprintf(Buff, "File at [%s] does not exist", Debugee.ProgramPath);
+            GuiSetStatusText(Buff);
+        }break;
+        case STOP_REASON_ATTACHED:
+        {
+            char Buff[2*PATH_MAX] = {};
+            sprintf(Buff, "Attached to process [%d] running [%s]", Debugee.PID, Debugee.ProgramPath);
+            GuiSetStatusText(Buff);
+        }break;
+        case STOP_REASON_ATTACH_FAILED:
+        {
+            char Buff[128] = {};
+            sprintf(Buff, "Could not attach to process [%d]", Debuger.AttachPID);
+            GuiSetStatusText(Buff);
+        }break;
+        case STOP_REASON_DETACHED:
+        {
+            GuiSetStatusText("Detached from process");
+        }break;
+        case STOP_REASON_STEPPED:
+        {
+            char Buff[128] = {};
+            sprintf(Buff, "Stepped over %u lines, %.0f steps/s", Stop->Steps, Stop->StepsPerSecond);
+            GuiSetStatusText(Buff);
+        }break;
+        case STOP_REASON_NO_FRAME_INFO:
+        {
+            GuiSetStatusText("Can't step out, there is no frame information for this code");
+        }break;
+        default:
+        {
+            GuiClearStatusText();
+        }break;
+    }
+}
     
 static void
 GuiCreateBreakpointTexture()
@@ -946,37 +2218,150 @@ GuiBuildFunctionRepresentation()
     }
 }
 
+// NOTE(mateusz): The picker lists the functions of the executable, already read,
+// the libraries are only asked through their name index so none of them is read
+// in full to fill the list.
 static void
-GuiShowBacktrace()
+GuiLookupFunctionInModules(char *Name)
 {
-    if(Debugee.Flags.Running)
+    StringCopy(Gui->Transient.FuncLookupName, Name);
+    Gui->Transient.FuncLookupCount = 0;
+
+    for(u32 I = 0; I < ModulesCount && Gui->Transient.FuncLookupCount < MAX_NAME_ENTRIES; I++)
     {
-        size_t PC = DebugeeGetProgramCounter(&Debugee);
+        if(&Modules[I].DI == DI)
+        {
+            continue;
+        }
 
-        // We know our cache is stale
-        if(Debuger.Unwind.Address != PC)
+        u32 Count = Gui->Transient.FuncLookupCount;
+        u32 Found = DwarfFindFunctionsByName(&Modules[I], Name, &Gui->Transient.FuncLookupAddresses[Count],
+                                             MAX_NAME_ENTRIES - Count);
+        for(u32 F = 0; F < Found; F++)
         {
-            DebugeeBuildBacktrace(&Debugee);
+            Gui->Transient.FuncLookupModules[Count + F] = I;
         }
 
+        Gui->Transient.FuncLookupCount += Found;
+    }
+}
+
+static void
+GuiShowBacktrace()
+{
+    // NOTE(mateusz): The backtrace is built from the frames the tracer unwound on the last stop
+    if(Debugee.Flags.Running)
+    {
         u32 Cnt = 1;
         for(unwind_functions_bucket *Bucket = Debuger.Unwind.FuncList.Head; Bucket != 0x0; Bucket = Bucket->Next)
         {
             for(u32 I = 0; I < Bucket->Count; I++)
             {
-                unwind_function Function = Bucket->Functions[I];
-
-                ImGui::Text("%02d: %s", Cnt++, Function->Label);
+                unwind_frame *Frame = &Bucket->Frames[I];
+                if(Frame->Inlined)
+                {
+                    ImGui::Text("%02d: %s [inlined, called at line %u]", Cnt++,
+                                Frame->Inlined->Name ? Frame->Inlined->Name : "EMPTY_FUNC_NAME",
+                                Frame->Inlined->CallLine);
+                }
+                else if(Frame->Symbol)
+                {
+                    ImGui::Text("%02d: %s+0x%lx", Cnt++, Frame->Symbol, Frame->SymbolOffset);
+                }
+                else
+                {
+                    ImGui::Text("%02d: %s", Cnt++, Frame->Function->Label);
+                }
             }
         }
     }
 }
 
-static char *
-GuiBuildVarsValueAsString(di_underlaying_type *Underlaying, size_t Address, u32 DerefCount, arena *Arena)
+static void
+GuiBaseValueToString(di_base_type *Type, void *Bytes, char *Result)
 {
-    u32 ResultSize = 64;
-    char *Result = ArrayPush(Arena, char, ResultSize);
+    union types_ptrs
+    {
+        void *Void;
+        float *Float;
+        double *Double;
+        char *Char;
+        short *Short;
+        int *Int;
+        long long *Long;
+    } TypesPtrs;
+    TypesPtrs.Void = Bytes;
+
+    switch(Type->ByteSize)
+    {
+    case 1:
+    {
+        if(Type->Encoding == DW_ATE_signed_char)
+        {
+            sprintf(Result, "%c (%x)", *TypesPtrs.Char, *TypesPtrs.Char);
+        }
+        else
+        {
+            sprintf(Result, "%u", (unsigned int)*TypesPtrs.Char);
+        }
+    }
+    break;
+    case 2:
+    {
+        if(Type->Encoding == DW_ATE_signed)
+        {
+            sprintf(Result, "%d", *TypesPtrs.Short);
+        }
+        else
+        {
+            sprintf(Result, "%u", (unsigned int)*TypesPtrs.Short);
+        }
+    }
+    break;
+    case 4:
+    {
+        if(Type->Encoding == DW_ATE_unsigned)
+        {
+            sprintf(Result, "%u", (unsigned int)*TypesPtrs.Int);
+        }
+        else if(Type->Encoding == DW_ATE_float)
+        {
+            sprintf(Result, "%f", *TypesPtrs.Float);
+        }
+        else
+        {
+            sprintf(Result, "%d", *TypesPtrs.Int);
+        }
+    }
+    break;
+    case 8:
+    {
+        if(Type->Encoding == DW_ATE_unsigned)
+        {
+            sprintf(Result, "%llu", (unsigned long long)*TypesPtrs.Long);
+        }
+        else if(Type->Encoding == DW_ATE_float)
+        {
+            sprintf(Result, "%f", *TypesPtrs.Double);
+        }
+        else
+        {
+            sprintf(Result, "%lld", *TypesPtrs.Long);
+        }
+    }
+    break;
+    default:
+    {
+        LOG_GUI("Unsupported byte size = %d", Type->ByteSize);
+    }
+    break;
+    }
+}
+
+static void
+GuiFormatVarsValue(di_underlaying_type *Underlaying, size_t Address, u32 DerefCount, char *Result, u32 ResultSize)
+{
+    memset(Result, 0, ResultSize);
 
     if(Underlaying->Flags.IsBase && !Underlaying->Flags.IsArray)
     {
@@ -1047,70 +2432,7 @@ GuiBuildVarsValueAsString(di_underlaying_type *Underlaying, size_t Address, u32
         }
         else
         {
-            switch(Underlaying->Type->ByteSize)
-            {
-            case 1:
-            {
-                if(Underlaying->Type->Encoding == DW_ATE_signed_char)
-                {
-                    sprintf(Result, "%c (%x)", *TypesPtrs.Char, *TypesPtrs.Char);
-                }
-                else
-                {
-                    sprintf(Result, "%u", (unsigned int)*TypesPtrs.Char);
-                }
-            }
-            break;
-            case 2:
-            {
-                if(Underlaying->Type->Encoding == DW_ATE_signed)
-                {
-                    sprintf(Result, "%d", *TypesPtrs.Short);
-                }
-                else
-                {
-                    sprintf(Result, "%u", (unsigned int)*TypesPtrs.Short);
-                }
-            }
-            break;
-            case 4:
-            {
-                if(Underlaying->Type->Encoding == DW_ATE_unsigned)
-                {
-                    sprintf(Result, "%u", (unsigned int)*TypesPtrs.Int);
-                }
-                else if(Underlaying->Type->Encoding == DW_ATE_float)
-                {
-                    sprintf(Result, "%f", *TypesPtrs.Float);
-                }
-                else
-                {
-                    sprintf(Result, "%d", *TypesPtrs.Int);
-                }
-            }
-            break;
-            case 8:
-            {
-                if(Underlaying->Type->Encoding == DW_ATE_unsigned)
-                {
-                    sprintf(Result, "%llu", (unsigned long long)*TypesPtrs.Long);
-                }
-                else if(Underlaying->Type->Encoding == DW_ATE_float)
-                {
-                    sprintf(Result, "%f", *TypesPtrs.Double);
-                }
-                else
-                {
-                    sprintf(Result, "%lld", *TypesPtrs.Long);
-                }
-            }
-            break;
-            default:
-            {
-                LOG_GUI("Unsupported byte size = %d", Underlaying->Type->ByteSize);
-            }
-            break;
-            }
+            GuiBaseValueToString(Underlaying->Type, &InMemory, Result);
         }
     }
     else if((Underlaying->Flags.IsStruct || Underlaying->Flags.IsUnion) && !Underlaying->Flags.IsArray)
@@ -1135,10 +2457,179 @@ GuiBuildVarsValueAsString(di_underlaying_type *Underlaying, size_t Address, u32
     {
         sprintf(Result, "Unknown thingee");
     }
+}
+
+static char *
+GuiBuildVarsValueAsString(di_underlaying_type *Underlaying, size_t Address, u32 DerefCount, arena *Arena)
+{
+    char *Result = ArrayPush(Arena, char, VAR_VALUE_STRING_SIZE);
+    GuiFormatVarsValue(Underlaying, Address, DerefCount, Result, VAR_VALUE_STRING_SIZE);
 
     return Result;
 }
 
+static u32
+GuiReadVariableValueBytes(variable_representation *Variable, u8 *Bytes)
+{
+    di_underlaying_type *Underlaying = &Variable->Underlaying;
+
+    // Structs and arrays only show a placeholder, their members refresh on their own
+    u32 Result = 0;
+    if(Underlaying->Flags.IsPointer)
+    {
+        Result = sizeof(size_t);
+    }
+    else if(Underlaying->Flags.IsBase && !Underlaying->Flags.IsArray && Underlaying->Type)
+    {
+        Result = MIN(Underlaying->Type->ByteSize, sizeof(size_t));
+    }
+
+    if(Result)
+    {
+        size_t InMemory = DebugeePeekMemory(&Debugee, Variable->Address);
+        for(u32 I = 0; I < Variable->DerefCount; I++)
+        {
+            InMemory = DebugeePeekMemory(&Debugee, InMemory);
+        }
+
+        memcpy(Bytes, &InMemory, Result);
+    }
+
+    return Result;
+}
+
+// NOTE(mateusz): Called from GuiShowVariable, so only the nodes that are drawn
+// (and the children of the expanded ones) read the debugee memory after a stop.
+static void
+GuiRefreshVariable(variable_representation *Variable)
+{
+    Variable->RefreshSequence = Gui->Transient.VarsSequence;
+
+    // Watches are evaluated by their plan, members cut out of pieces by the parent
+    if(Variable->Plan || (Variable->NotInMemory && !Variable->ActualVariable))
+    {
+        return;
+    }
+
+    if(Variable->ActualVariable)
+    {
+        di_location Location = DwarfGetVariableLocation(Variable->ActualVariable);
+        if(!DwarfLocationIsMemory(&Location))
+        {
+            u8 Previous[sizeof(Variable->ValueBytes)] = {};
+            memcpy(Previous, Variable->ValueBytes, sizeof(Previous));
+
+            Variable->NotInMemory = true;
+            Variable->Address = 0x0;
+            GuiFormatLocationValue(Variable, &Location);
+
+            // Structs in pieces have no value bytes of their own to compare
+            Variable->Changed = memcmp(Previous, Variable->ValueBytes, sizeof(Previous)) != 0;
+            if(Variable->Changed || Variable->Underlaying.Flags.IsStruct || Variable->Underlaying.Flags.IsUnion)
+            {
+                Variable->ChildrenStale = true;
+            }
+
+            return;
+        }
+
+        size_t Address = Location.Pieces[0].Value;
+        if(Address != Variable->Address || Variable->NotInMemory)
+        {
+            Variable->NotInMemory = false;
+            Variable->Address = Address;
+            Variable->ChildrenStale = true;
+            if(Variable->Window)
+            {
+                // Rows are fetched again from the new address
+                Variable->Window->Summary.Computed = false;
+            }
+        }
+    }
+
+    u8 Bytes[sizeof(Variable->ValueBytes)] = {};
+    u32 BytesCount = GuiReadVariableValueBytes(Variable, Bytes);
+    
+    Variable->Changed = memcmp(Bytes, Variable->ValueBytes, BytesCount) != 0;
+    memcpy(Variable->ValueBytes, Bytes, BytesCount);
+
+    di_underlaying_type *Underlaying = &Variable->Underlaying;
+    if(Variable->Changed && Underlaying->Flags.IsPointer)
+    {
+        // Members were read through the old pointer
+        Variable->ChildrenStale = true;
+    }
+
+    // The characters can change even if the pointer to them did not
+    bool IsString = Underlaying->Flags.IsBase && Underlaying->Flags.IsPointer && Underlaying->Type &&
+                    Underlaying->Type->Encoding == DW_ATE_signed_char && Underlaying->PointerCount == 1;
+    if(Variable->Changed || IsString)
+    {
+        GuiFormatVarsValue(Underlaying, Variable->Address, Variable->DerefCount,
+                           Variable->ValueString, VAR_VALUE_STRING_SIZE);
+    }
+}
+
+// NOTE(mateusz): Children keep their names, types and value strings when the parent
+// moves, only the address is new and the value is read again when it is drawn.
+static void
+GuiRebaseVariable(variable_representation *Variable, size_t Address)
+{
+    if(Variable->Address != Address || Variable->NotInMemory)
+    {
+        Variable->Address = Address;
+        Variable->NotInMemory = false;
+        Variable->ChildrenStale = true;
+        if(Variable->Window)
+        {
+            Variable->Window->Summary.Computed = false;
+        }
+    }
+
+    Variable->RefreshSequence = Gui->Transient.VarsSequence - 1;
+}
+
+static size_t
+GuiMemberAddress(variable_representation *Variable, di_member *Member)
+{
+    size_t Address = 0x0;
+
+    if(Variable->NotInMemory)
+    {
+        memcpy(&Address, Variable->ValueBytes, sizeof(Address));
+        Address += Member->ByteLocation;
+    }
+    else if(Variable->Underlaying.Flags.IsPointer)
+    {
+        Address = DebugeePeekMemory(&Debugee, Variable->Address);
+        for(u32 I = 0; I < Variable->Underlaying.PointerCount; I++)
+        {
+            Address = DebugeePeekMemory(&Debugee, Variable->Address);
+        }
+
+        Address += Member->ByteLocation;
+    }
+    else
+    {
+        Address = Variable->Address + Member->ByteLocation;
+    }
+
+    return Address;
+}
+
+static void
+GuiShowVariableValue(variable_representation *Variable)
+{
+    if(Variable->Changed)
+    {
+        ImGui::TextColored(ChangedValueColor, Variable->ValueString);
+    }
+    else
+    {
+        ImGui::Text(Variable->ValueString);
+    }
+}
+
 static variable_representation
 GuiRebuildVariableRepresentation(variable_representation *Var, arena *Arena)
 {
@@ -1155,15 +2646,166 @@ GuiRebuildVariableRepresentation(variable_representation *Var, arena *Arena)
     }
 }
 
+// NOTE(mateusz): Variables the location expression puts in registers, pieces or
+// computes outright have no address, their value is read from the location instead.
+static void
+GuiFormatLocationValue(variable_representation *Variable, di_location *Location)
+{
+    di_underlaying_type *Underlaying = &Variable->Underlaying;
+    char *Result = Variable->ValueString;
+    memset(Result, 0, VAR_VALUE_STRING_SIZE);
+
+    u32 Size = 0;
+    if(Underlaying->Flags.IsPointer)
+    {
+        Size = sizeof(size_t);
+    }
+    else if(Underlaying->Flags.IsBase && !Underlaying->Flags.IsArray && Underlaying->Type)
+    {
+        Size = MIN(Underlaying->Type->ByteSize, 16);
+    }
+
+    u8 Bytes[16] = {};
+    if(Location->PiecesCount == 0 || (Size && !DwarfReadLocationBytes(Location, Bytes, Size)))
+    {
+        snprintf(Result, VAR_VALUE_STRING_SIZE, "<optimized out>");
+    }
+    else if(Size == 0)
+    {
+        // Members of a struct are shown as its children, same as in memory
+        bool IsAggregate = (Underlaying->Flags.IsStruct || Underlaying->Flags.IsUnion) && !Underlaying->Flags.IsArray;
+        if(!IsAggregate)
+        {
+            snprintf(Result, VAR_VALUE_STRING_SIZE, "<not in memory>");
+        }
+    }
+    else if(Underlaying->Flags.IsPointer)
+    {
+        size_t Pointer = 0x0;
+        memcpy(&Pointer, Bytes, sizeof(Pointer));
+        snprintf(Result, VAR_VALUE_STRING_SIZE, "%p", (void *)Pointer);
+    }
+    else
+    {
+        GuiBaseValueToString(Underlaying->Type, Bytes, Result);
+    }
+
+    memcpy(Variable->ValueBytes, Bytes, sizeof(Variable->ValueBytes));
+}
+
+// NOTE(mateusz): A struct that DW_OP_piece splits between registers has no address,
+// its bytes are put together from the pieces and every member is formatted from its
+// part of them. Members that are aggregates themselves are not followed any deeper.
+static void
+GuiBuildMembersFromPieces(variable_representation *Variable, arena *Arena)
+{
+    di_aggregate_type *Struct = Variable->Underlaying.Struct;
+    di_location Location = DwarfGetVariableLocation(Variable->ActualVariable);
+
+    u8 Bytes[MAX_PIECES_STRUCT_SIZE] = {};
+    u32 Size = MIN(Struct->ByteSize, sizeof(Bytes));
+    bool Available = DwarfReadLocationBytes(&Location, Bytes, Size) != 0;
+
+    bool Rebuilt = Variable->Children != 0x0;
+    if(!Variable->Children)
+    {
+        Variable->ChildrenCount = Struct->MembersCount;
+        Variable->Children = ArrayPush(Arena, variable_representation, Variable->ChildrenCount);
+
+        for(u32 I = 0; I < Struct->MembersCount; I++)
+        {
+            di_member *Member = &Struct->Members[I];
+            variable_representation *Child = &Variable->Children[I];
+
+            Child->Name = Member->Name;
+            Child->Underlaying = DwarfFindUnderlayingType(Member->ActualTypeOffset);
+            Child->TypeString = DwarfGetTypeString(Member->ActualTypeOffset, Arena);
+            Child->ValueString = ArrayPush(Arena, char, VAR_VALUE_STRING_SIZE);
+        }
+    }
+
+    for(u32 I = 0; I < Variable->ChildrenCount; I++)
+    {
+        di_member *Member = &Struct->Members[I];
+        variable_representation *Child = &Variable->Children[I];
+        di_underlaying_type *Underlaying = &Child->Underlaying;
+        char *Result = Child->ValueString;
+        memset(Result, 0, VAR_VALUE_STRING_SIZE);
+
+        u32 MemberSize = 0;
+        if(Underlaying->Flags.IsPointer)
+        {
+            MemberSize = sizeof(size_t);
+        }
+        else if(Underlaying->Flags.IsBase && !Underlaying->Flags.IsArray && Underlaying->Type)
+        {
+            MemberSize = MIN(Underlaying->Type->ByteSize, 16);
+        }
+
+        u8 Value[16] = {};
+        if(!Available || Member->ByteLocation + MemberSize > Size)
+        {
+            snprintf(Result, VAR_VALUE_STRING_SIZE, "<optimized out>");
+        }
+        else if(MemberSize == 0)
+        {
+            snprintf(Result, VAR_VALUE_STRING_SIZE, "<not in memory>");
+        }
+        else
+        {
+            memcpy(Value, &Bytes[Member->ByteLocation], MemberSize);
+            if(Underlaying->Flags.IsPointer)
+            {
+                size_t Pointer = 0x0;
+                memcpy(&Pointer, Value, sizeof(Pointer));
+                snprintf(Result, VAR_VALUE_STRING_SIZE, "%p", (void *)Pointer);
+            }
+            else
+            {
+                GuiBaseValueToString(Underlaying->Type, Value, Result);
+            }
+        }
+
+        Child->Changed = Rebuilt && memcmp(Child->ValueBytes, Value, sizeof(Child->ValueBytes)) != 0;
+        memcpy(Child->ValueBytes, Value, sizeof(Child->ValueBytes));
+        if(Child->Changed)
+        {
+            // A pointer member that changed points to other members now
+            Child->ChildrenStale = true;
+        }
+
+        Child->Address = 0x0;
+        Child->NotInMemory = true;
+        Child->RefreshSequence = Gui->Transient.VarsSequence;
+    }
+}
+
 static variable_representation
 GuiBuildVariableRepresentation(di_variable *Var, u32 DerefCount, arena *Arena)
 {
     variable_representation Result = {};
 
     size_t TypeOffset = Var->TypeOffset;
-    size_t Address = DwarfGetVariableMemoryAddress(Var);
     char *Name = Var->Name;
-    Result = GuiBuildVariableRepresentation(TypeOffset, Address, Name, DerefCount, Arena);
+    
+    di_location Location = DwarfGetVariableLocation(Var);
+    if(DwarfLocationIsMemory(&Location))
+    {
+        size_t Address = Location.Pieces[0].Value;
+        Result = GuiBuildVariableRepresentation(TypeOffset, Address, Name, DerefCount, Arena);
+    }
+    else
+    {
+        Result.Underlaying = DwarfFindUnderlayingType(TypeOffset);
+        Result.Name = Name;
+        Result.DerefCount = DerefCount;
+        Result.TypeString = DwarfGetTypeString(TypeOffset, Arena);
+        Result.ValueString = ArrayPush(Arena, char, VAR_VALUE_STRING_SIZE);
+        Result.NotInMemory = true;
+
+        GuiFormatLocationValue(&Result, &Location);
+        Result.RefreshSequence = Gui->Transient.VarsSequence;
+    }
     
     Result.ActualVariable = Var;
 
@@ -1184,7 +2826,10 @@ GuiBuildVariableRepresentation(size_t TypeOffset, size_t Address, char *Name, u3
     Result.ValueString = GuiBuildVarsValueAsString(&Result.Underlaying, Result.Address, DerefCount, Arena);
     Result.DerefCount = DerefCount;
     
-    Result.TypeString = DwarfGetTypeStringRepresentation(Result.Underlaying, Arena);
+    Result.TypeString = DwarfGetTypeString(TypeOffset, Arena);
+
+    GuiReadVariableValueBytes(&Result, Result.ValueBytes);
+    Result.RefreshSequence = Gui->Transient.VarsSequence;
 
     return Result;
 }
@@ -1200,7 +2845,26 @@ GuiShowWatch()
             VarNode = VarNode->Next)
         {
             variable_representation *Var = &VarNode->Var;
-            (*Var) = GuiRebuildVariableRepresentation(Var, &Gui->Transient.WatchArena);
+            if(Var->Plan)
+            {
+                char Previous[256] = {};
+                if(Var->ValueString)
+                {
+                    snprintf(Previous, sizeof(Previous), "%s", Var->ValueString);
+                }
+
+                char *Error = 0x0;
+                if(!WLangEvalPlan(Var->Plan, Var, &Error, &Gui->Transient.WatchArena))
+                {
+                    Var->ValueString = Error;
+                }
+
+                Var->Changed = !StringMatches(Previous, Var->ValueString);
+            }
+            else
+            {
+                (*Var) = GuiRebuildVariableRepresentation(Var, &Gui->Transient.WatchArena);
+            }
         }
 
         Gui->Transient.WatchBuildAddress = PC;
@@ -3,6 +3,12 @@
 #ifndef GUI_H
 #define GUI_H
 
+#define VAR_VALUE_STRING_SIZE 64
+#define MAX_PIECES_STRUCT_SIZE 64
+
+struct watch_plan;
+struct array_window;
+
 struct function_representation
 {
     char *Label;
@@ -18,9 +24,53 @@ struct variable_representation
     di_underlaying_type Underlaying;
     di_variable *ActualVariable;
     u32 DerefCount;
+    watch_plan *Plan;
+    array_window *Window;
+
+    // NOTE(mateusz): The raw bytes the ValueString was formatted from, the value
+    // is only formatted again when a refresh reads different ones.
+    u8 ValueBytes[8];
+    u32 RefreshSequence;
+    bool Changed;
+    // NOTE(mateusz): Set when the location of the variable is a register, a
+    // computed value or a set of pieces, Address is meaningless then.
+    bool NotInMemory;
     
+    // NOTE(mateusz): Set when the parent moved or its pointer changed, the children
+    // are kept and rebased in place so a long session does not grow the arena.
     variable_representation *Children;
     u32 ChildrenCount;
+    bool ChildrenStale;
+};
+
+struct array_summary
+{
+    u32 StopSequence;
+    bool Computed;
+    u64 Count;
+    u64 NaNCount;
+    i64 FirstNonZero;
+    f64 Min;
+    f64 Max;
+    f64 Sum;
+    char String[160];
+};
+
+#define ARRAY_SUMMARY_CHUNK_SIZE Megabytes(1)
+
+// NOTE(mateusz): Rows of an expanded array around the part that is on the screen,
+// decoded from a single read of the debugee memory and kept until the next stop.
+struct array_window
+{
+    u32 StopSequence;
+    size_t Address;
+    u32 First;
+    u32 Count;
+    u32 RowsCapacity;
+    di_underlaying_type ElementUnderlaying;
+    char *ElementTypeString;
+    variable_representation *Rows;
+    array_summary Summary;
 };
 
 struct variable_representation_node
@@ -75,10 +125,18 @@ struct gui_transient
     function_representation *FuncRepresentation;
     u32 FuncRepresentationCount;
 
+    // NOTE(mateusz): Functions of the other modules are not listed up front, the
+    // typed name is looked up in their name indexes every time it changes.
+    char FuncLookupName[128];
+    size_t FuncLookupAddresses[MAX_NAME_ENTRIES];
+    u32 FuncLookupModules[MAX_NAME_ENTRIES];
+    u32 FuncLookupCount;
+
     bool EnterCaptured;
     variable_representation *Variables;
     u32 VariableCnt;
     size_t LocalsBuildAddress;
+    u32 VarsSequence;
     variable_representation *VarInEdit;
     var_edit_kind VarEditKind;
     char VarValueEditBuffer[128];
@@ -93,20 +151,81 @@ struct gui_transient
     bool CloseNextTree;
 };
 
+#define MEMORY_VIEW_ROW_BYTES 16
+#define MEMORY_VIEW_SPAN Megabytes(16)
+#define MEMORY_PAGE_SIZE 4096
+#define MEMORY_PAGE_CACHE_COUNT 64
+#define MEMORY_SEARCH_CHUNK_SIZE Megabytes(1)
+#define MEMORY_SEARCH_FRAME_BYTES Megabytes(16)
+#define MAX_MEMORY_SEARCH_RESULTS 256
+
+// NOTE(mateusz): Pages are read with a single pread each and stay valid until
+// the debugee is resumed, the cache is direct mapped on the page number.
+struct memory_page
+{
+    size_t Address;
+    u32 StopSequence;
+    u32 ReadBytes;
+    bool Valid;
+    u8 Bytes[MEMORY_PAGE_SIZE];
+};
+
+struct memory_view
+{
+    char AddressBuffer[32];
+    size_t Start;
+    size_t End;
+    bool ScrollReset;
+
+    char SearchBuffer[128];
+    bool SearchHex;
+    size_t SearchResults[MAX_MEMORY_SEARCH_RESULTS];
+    u32 SearchResultsCount;
+    size_t SearchedBytes;
+    size_t SearchSkippedBytes;
+    char *SearchError;
+
+    // NOTE(mateusz): State of a search that is still being scanned, see GuiMemorySearchStep
+    bool Searching;
+    bool SearchTruncated;
+    u8 SearchPattern[64];
+    u32 SearchPatternLength;
+    u32 SearchStopSequence;
+    memory_region SearchRegions[MAX_MEMORY_REGIONS];
+    u32 SearchRegionsCount;
+    u32 SearchRegion;
+    size_t SearchAddress;
+
+    memory_page Pages[MEMORY_PAGE_CACHE_COUNT];
+};
+
 struct gui_data
 {
     arena Arena;
     char *StatusText;
     char BreakFuncName[128];
     char BreakAddress[32];
+    char DisasmRangeStart[32];
+    char DisasmRangeEnd[32];
+    char StepCondition[128];
+    char StepConditionError[128];
+    i32 StepLinesCount = 1000;
     void (* ModalFuncShow)();
     ImTextureID BreakpointTextureActive;
     ImTextureID BreakpointTextureBlank;
     ImFont *BiggerFont;
 
     gui_transient Transient;
+    memory_view Memory;
 
     char *SpacesArray[10];
+    bool DisasmInterleaved;
+    // NOTE(mateusz): Source line picked with "Show in disassembly", its instructions
+    // are highlighted until another one is picked.
+    bool DisasmShowLine;
+    bool DisasmScrollToLine;
+    u32 DisasmShowFileIndex;
+    u32 DisasmShowLineNum;
     u32 WindowWidth = 1024;
     u32 WindowHeight = 768;
     gui_flags Flags;
@@ -130,6 +249,8 @@ struct gui_data
 
 ImVec4 CurrentLineColor = ImVec4(1.0f, 1.0f, 0.0f, 1.0f);
 ImVec4 BreakpointLineColor = ImVec4(1.0f, 0.0f, 0.0f, 1.0f);
+ImVec4 ChangedValueColor = ImVec4(1.0f, 0.5f, 0.0f, 1.0f);
+ImVec4 ShownLineColor = ImVec4(0.4f, 0.8f, 1.0f, 1.0f);
 
 gui_data _Gui = {};
 gui_data *Gui = &_Gui;
@@ -146,23 +267,54 @@ const u32 PNG_CHANNEL = 4;
 
 static void GuiInit();
 static void GuiEndFrame();
-static void GuiShowArrayType(di_underlaying_type Underlaying, size_t VarAddress, char *VarName);
+static void GuiShowArrayWindow(variable_representation *Variable, arena *Arena);
+static void GuiArrayWindowFetch(variable_representation *Variable, u32 Start, u32 End, arena *Arena);
+static void GuiBaseValueToString(di_base_type *Type, void *Bytes, char *Result);
+static void GuiArraySummaryCompute(variable_representation *Variable, array_summary *Summary);
+static void GuiArraySummaryAddValue(array_summary *Summary, f64 Value, u64 Index);
+static void GuiArraySummaryScalar(di_base_type *Type, u8 *Bytes, u64 Count, u64 BaseIndex, array_summary *Summary);
+static void GuiArraySummaryF32SSE2(f32 *Values, u64 Count, u64 BaseIndex, array_summary *Summary);
+static void GuiArraySummaryF64SSE2(f64 *Values, u64 Count, u64 BaseIndex, array_summary *Summary);
+static void GuiArraySummaryF32AVX(f32 *Values, u64 Count, u64 BaseIndex, array_summary *Summary);
+static void GuiArraySummaryF64AVX(f64 *Values, u64 Count, u64 BaseIndex, array_summary *Summary);
 static void GuiShowBreakAtAddress();
 static void GuiShowBreakAtFunction();
+static void GuiShowDisassembleRange();
+static void GuiShowStepLines();
+static void GuiShowCodeContextMenu(size_t Address, size_t PC, di_src_line *Line = 0x0);
 static void GuiShowVarInputText(char *Label, char *Buffer, u32 BufferSize);
 static void GuiShowRegisters(x64_registers Regs);
 static void GuiStartFrame();
 static void _GuiShowBreakAtAddressModalWindow();
 static void _GuiShowBreakAtFunctionWindow();
+static void _GuiShowDisassembleRangeModalWindow();
+static void _GuiShowStepLinesModalWindow();
+static u64  _GuiParseAddress(char *AddressStr);
 static void GuiSetStatusText(char *Str);
 static void GuiClearStatusText();
+static void GuiSetStatusFromStop(stop_snapshot *Stop);
 static void GuiCreateBreakpointTexture();
 static variable_representation GuiCopyVariableRepresentation(variable_representation *Var, arena *Arena);
 static variable_representation GuiRebuildVariableRepresentation(variable_representation *Var, arena *Arena);
+static void GuiRefreshVariable(variable_representation *Variable);
+static void GuiRebaseVariable(variable_representation *Variable, size_t Address);
+static size_t GuiMemberAddress(variable_representation *Variable, di_member *Member);
+static u32 GuiReadVariableValueBytes(variable_representation *Variable, u8 *Bytes);
+static void GuiShowVariableValue(variable_representation *Variable);
+static void GuiFormatLocationValue(variable_representation *Variable, di_location *Location);
+static void GuiBuildMembersFromPieces(variable_representation *Variable, arena *Arena);
 static variable_representation GuiBuildVariableRepresentation(di_variable *Var, u32 DerefCount, arena *Arena);
 static variable_representation GuiBuildVariableRepresentation(size_t TypeOffset, size_t Address, char *Name, u32 DerefCount, arena *Arena);
 static void GuiBuildFunctionRepresentation();
+static void GuiLookupFunctionInModules(char *Name);
 static void GuiShowBacktrace();
+static void GuiShowThreads();
+static void GuiShowMemory();
+static void GuiMemoryViewGoTo(memory_view *View, size_t Address);
+static memory_page *GuiMemoryGetPage(memory_view *View, size_t Address);
+static u32 GuiMemoryParsePattern(memory_view *View, u8 *Pattern, u32 PatternSize);
+static void GuiMemorySearchBegin(memory_view *View);
+static void GuiMemorySearchStep(memory_view *View);
 static void GuiShowWatch();
 
 /*
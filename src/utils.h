@@ -20,6 +20,7 @@ typedef double f64;
 #define IS_PRINTABLE(C) ((C) >= ' ' && (C) <= '~')
 
 #define Kilobytes(x) ((x) * 1024)
+#define Megabytes(x) (Kilobytes(x) * 1024)
 
 #define MIN(a,b) (((a)<(b))?(a):(b))
 #define MAX(a,b) (((a)>(b))?(a):(b))
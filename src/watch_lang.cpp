@@ -578,42 +578,135 @@ ExpressionResultKindToString(eval_result_kind Kind)
         return "EvalResultKind_NumberInt";
     case EvalResultKind_Ident:
         return "EvalResultKind_Ident";
-    case EvalResultKind_Repr:
-        return "EvalResultKind_Repr";
+    case EvalResultKind_Location:
+        return "EvalResultKind_Location";
     default:
         return "Unexpected expression kind";
     }
 }
 
-static evaluator
-EvaluatorCreate(ast AST, scoped_vars Scope, arena *Arena)
+static compiler
+CompilerCreate(ast AST, scoped_vars Scope, watch_plan *Plan, arena *Arena)
 {
-    evaluator Result = {};
+    compiler Result = {};
 
     Result.Scope = Scope;
     Result.Arena = Arena;
     Result.AST = AST;
+    Result.Plan = Plan;
 
     return Result;
 }
 
 static void
-EvaluatorDestroy(evaluator *Eval)
+CompilerDestroy(compiler *Comp)
 {
-    (void)Eval;
+    (void)Comp;
+}
+
+static void
+CompilerEmit(compiler *Comp, watch_op_kind Kind, size_t Imm, di_variable *Var, bool Signed)
+{
+    watch_plan *Plan = Comp->Plan;
+    if(Plan->OpsCount >= MAX_WATCH_OPS)
+    {
+        Comp->ErrorStr = (char *)"Expression is too complex";
+        return;
+    }
+
+    watch_op *Op = &Plan->Ops[Plan->OpsCount++];
+    Op->Kind = Kind;
+    Op->Imm = Imm;
+    Op->Var = Var;
+    Op->Signed = Signed;
+}
+
+// NOTE(mateusz): Turns the result of a subexpression into a location, the name
+// of a variable is resolved here and only once, what is left for the run time
+// is reading its address.
+static bool
+CompilerMaterialize(compiler *Comp, eval_result *Value)
+{
+    if(Value->Kind == EvalResultKind_Ident)
+    {
+        di_variable *Var = DwarfFindVariableByNameInScope(Comp->Scope, Value->Ident);
+        if(!Var)
+        {
+            Comp->ErrorStr = ArrayPush(Comp->Arena, char, 256);
+            sprintf(Comp->ErrorStr, "Variable [%s] not found in current scope\n", Value->Ident);
+
+            return false;
+        }
+
+        // The ops only follow addresses, a value in registers or pieces can't be one
+        if(!DwarfGetVariableMemoryAddress(Var))
+        {
+            Comp->ErrorStr = ArrayPush(Comp->Arena, char, 256);
+            sprintf(Comp->ErrorStr, "Variable [%s] is not in memory\n", Var->Name);
+
+            return false;
+        }
+
+        CompilerEmit(Comp, WatchOpKind_VarAddress, 0, Var, false);
+
+        Value->Kind = EvalResultKind_Location;
+        Value->Var = Var;
+        Value->Name = Var->Name;
+        Value->TypeOffset = Var->TypeOffset;
+        Value->Underlaying = DwarfGetVariablesUnderlayingType(Var);
+        Value->DerefCount = 0;
+    }
+    else if(Value->Kind == EvalResultKind_Location)
+    {
+        // A dereference used as an operand, the pointer has to be followed
+        for(u32 I = 0; I < Value->DerefCount; I++)
+        {
+            CompilerEmit(Comp, WatchOpKind_Deref, 0, 0x0, false);
+        }
+
+        Value->Var = 0x0;
+        Value->DerefCount = 0;
+    }
+
+    return Value->Kind == EvalResultKind_Location && !Comp->ErrorStr;
+}
+
+static bool
+CompilerEmitIndexLoad(compiler *Comp, eval_result *Index, char *Name)
+{
+    if(!CompilerMaterialize(Comp, Index))
+    {
+        return false;
+    }
+
+    di_underlaying_type *Underlaying = &Index->Underlaying;
+    if(!(Underlaying->Flags.IsBase && !Underlaying->Flags.IsPointer &&
+         Underlaying->Type->Encoding != DW_ATE_float))
+    {
+        Comp->ErrorStr = ArrayPush(Comp->Arena, char, 256);
+        sprintf(Comp->ErrorStr, "Cannot index with (%s) that is a non int type\n", Name);
+
+        return false;
+    }
+
+    bool Signed = Underlaying->Type->Encoding == DW_ATE_signed ||
+                  Underlaying->Type->Encoding == DW_ATE_signed_char;
+    CompilerEmit(Comp, WatchOpKind_LoadInt, Underlaying->Type->ByteSize, 0x0, Signed);
+
+    return !Comp->ErrorStr;
 }
 
 static eval_result
-EvaluatorEvalExpression(evaluator *Eval, ast_node *Expr)
+CompilerCompileExpression(compiler *Comp, ast_node *Expr)
 {
-    if(Eval->ErrorStr)
+    if(Comp->ErrorStr)
     {
         return {};
     }
 
     if(!Expr)
     {
-        Eval->ErrorStr = (char *)"Unexpected lack of expression";
+        Comp->ErrorStr = (char *)"Unexpected lack of expression";
         return {};
     }
 
@@ -621,111 +714,69 @@ EvaluatorEvalExpression(evaluator *Eval, ast_node *Expr)
     {
         if(!(Expr->Lhs && Expr->Rhs))
         {
-            Eval->ErrorStr = (char *)"Unexpected lack of AST node children";
+            Comp->ErrorStr = (char *)"Unexpected lack of AST node children";
             return {};
         }
 
-        eval_result LeftSide = EvaluatorEvalExpression(Eval, Expr->Lhs);
-        eval_result RightSide = EvaluatorEvalExpression(Eval, Expr->Rhs);
-
-        if(!(LeftSide.Kind == EvalResultKind_Ident || LeftSide.Kind == EvalResultKind_Repr))
+        eval_result LeftSide = CompilerCompileExpression(Comp, Expr->Lhs);
+        if(!(LeftSide.Kind == EvalResultKind_Ident || LeftSide.Kind == EvalResultKind_Location))
         {
-            Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
-            sprintf(Eval->ErrorStr, "Unexpected expression kind %s\n", ExpressionResultKindToString(LeftSide.Kind));
+            Comp->ErrorStr = ArrayPush(Comp->Arena, char, 256);
+            sprintf(Comp->ErrorStr, "Unexpected expression kind %s\n", ExpressionResultKindToString(LeftSide.Kind));
 
             return {};
         }
 
-        size_t VarAddress = 0x0;
-        size_t TypeSize = 0x0;
-        size_t TypeOffset = 0x0;
-        char *VarName = 0x0;
-
-        di_underlaying_type Underlaying = {};
-        if(LeftSide.Kind == EvalResultKind_Ident)
+        // The base address has to be on the stack before the index is
+        if(!CompilerMaterialize(Comp, &LeftSide))
         {
-            di_variable *Var = DwarfFindVariableByNameInScope(Eval->Scope, LeftSide.Ident);
-            if(!Var)
-            {
-                Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
-                sprintf(Eval->ErrorStr, "Variable [%s] not found in current scope\n", LeftSide.Ident);
-
-                return {};
-            }
-            
-            VarAddress = DwarfGetVariableMemoryAddress(Var);
-            VarName = Var->Name;
-            Underlaying = DwarfGetVariablesUnderlayingType(Var);
+            return {};
         }
-        else if(LeftSide.Kind == EvalResultKind_Repr)
-        {
-            auto VarRepr = LeftSide.Repr;
-            assert(VarRepr);
 
-            VarAddress = VarRepr->Address;
-            VarName = VarRepr->Name;
-            Underlaying = VarRepr->Underlaying;
+        di_underlaying_type Underlaying = LeftSide.Underlaying;
+        if(Underlaying.Flags.IsPointer)
+        {
+            CompilerEmit(Comp, WatchOpKind_Deref, 0, 0x0, false);
         }
 
-        static_assert((offsetof(di_base_type, ByteSize) == offsetof(di_struct_type, ByteSize)) &&
-                      (offsetof(di_base_type, ByteSize) == offsetof(di_union_type, ByteSize)),
+        static_assert(offsetof(di_base_type, ByteSize) == offsetof(di_aggregate_type, ByteSize),
                       "ByteSize arguments need to have the same offset between the checked types");
         // This is true only if the above assert passes 
-        VarAddress = Underlaying.Flags.IsPointer ? DebugeePeekMemory(&Debugee, VarAddress) : VarAddress;
-        TypeSize = Underlaying.Type->ByteSize;
-        TypeOffset = Underlaying.Type->DIEOffset;
+        size_t TypeSize = Underlaying.Type->ByteSize;
+        size_t TypeOffset = Underlaying.Type->DIEOffset;
 
-        if(!(RightSide.Kind == EvalResultKind_Ident ||
-           RightSide.Kind == EvalResultKind_NumberInt ||
-           RightSide.Kind == EvalResultKind_Repr))
+        eval_result RightSide = CompilerCompileExpression(Comp, Expr->Rhs);
+        if(RightSide.Kind == EvalResultKind_NumberInt)
         {
-            Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
-            sprintf(Eval->ErrorStr, "Cannot index with %s with %s ast node kind\n", RightSide.Ident, ExpressionResultKindToString(RightSide.Kind));
-
-            return {};
-        }
-
-        i64 Index = 0;
-        if(RightSide.Kind == EvalResultKind_Ident)
-        {
-            di_variable *Var = DwarfFindVariableByNameInScope(Eval->Scope, RightSide.Ident);
-            if(!Var)
+            // Constant indices are folded into a single offset
+            if(RightSide.Int != 0)
             {
-                Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
-                sprintf(Eval->ErrorStr, "Variable [%s] not found in current scope\n", RightSide.Ident);
-
-                return {};
+                CompilerEmit(Comp, WatchOpKind_Add, RightSide.Int * TypeSize, 0x0, false);
             }
-            
-            scratch_arena Scratch;
-            variable_representation Repr = GuiBuildVariableRepresentation(Var, 0, Scratch);
-            if(!(Repr.Underlaying.Flags.IsBase && Repr.Underlaying.Type->Encoding != DW_ATE_float))
+        }
+        else if(RightSide.Kind == EvalResultKind_Ident || RightSide.Kind == EvalResultKind_Location)
+        {
+            char *IndexName = RightSide.Kind == EvalResultKind_Ident ? RightSide.Ident : RightSide.Name;
+            if(!CompilerEmitIndexLoad(Comp, &RightSide, IndexName))
             {
-                Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
-                sprintf(Eval->ErrorStr, "Cannot index with (%s) that is a non int type\n", RightSide.Ident);
-
                 return {};
             }
 
-            Index = atoll(Repr.ValueString);
-        }
-        else if(RightSide.Kind == EvalResultKind_NumberInt)
-        {
-            Index = RightSide.Int;
+            CompilerEmit(Comp, WatchOpKind_Index, TypeSize, 0x0, false);
         }
-        else if(RightSide.Kind == EvalResultKind_Repr)
+        else
         {
-            Index = atoll(RightSide.Repr->ValueString);
-        }
+            Comp->ErrorStr = ArrayPush(Comp->Arena, char, 256);
+            sprintf(Comp->ErrorStr, "Cannot index with %s ast node kind\n", ExpressionResultKindToString(RightSide.Kind));
 
-        size_t ResultAddress = VarAddress + Index * TypeSize;
+            return {};
+        }
 
         eval_result Result = {};
-        size_t Address = ResultAddress;
-
-        Result.Kind = EvalResultKind_Repr;
-        Result.Repr = StructPush(Eval->Arena, variable_representation);
-        (*Result.Repr) = GuiBuildVariableRepresentation(TypeOffset, Address, VarName, 0, Eval->Arena);
+        Result.Kind = EvalResultKind_Location;
+        Result.Name = LeftSide.Name;
+        Result.TypeOffset = TypeOffset;
+        Result.Underlaying = DwarfFindUnderlayingType(TypeOffset);
 
         return Result;
     }
@@ -733,96 +784,63 @@ EvaluatorEvalExpression(evaluator *Eval, ast_node *Expr)
     {
         if(!(Expr->Lhs && Expr->Rhs))
         {
-            Eval->ErrorStr = (char *)"Unexpected lack of AST node children";
+            Comp->ErrorStr = (char *)"Unexpected lack of AST node children";
             return {};
         }
 
-        eval_result LeftSide = EvaluatorEvalExpression(Eval, Expr->Lhs);
-        eval_result RightSide = EvaluatorEvalExpression(Eval, Expr->Rhs);
+        eval_result LeftSide = CompilerCompileExpression(Comp, Expr->Lhs);
+        eval_result RightSide = CompilerCompileExpression(Comp, Expr->Rhs);
 
         if(RightSide.Kind != EvalResultKind_Ident)
         {
-            Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
-            sprintf(Eval->ErrorStr, "Cannot access a struct/union member with %s ast node kind.", ExpressionResultKindToString(RightSide.Kind));
+            Comp->ErrorStr = ArrayPush(Comp->Arena, char, 256);
+            sprintf(Comp->ErrorStr, "Cannot access a struct/union member with %s ast node kind.", ExpressionResultKindToString(RightSide.Kind));
             return {};
         }
 
-        if(!(LeftSide.Kind == EvalResultKind_Repr || LeftSide.Kind == EvalResultKind_Ident))
+        if(!(LeftSide.Kind == EvalResultKind_Location || LeftSide.Kind == EvalResultKind_Ident))
         {
-            Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
-            sprintf(Eval->ErrorStr, "Cannot access %s ast node kind as a struct/union.", ExpressionResultKindToString(LeftSide.Kind));
+            Comp->ErrorStr = ArrayPush(Comp->Arena, char, 256);
+            sprintf(Comp->ErrorStr, "Cannot access %s ast node kind as a struct/union.", ExpressionResultKindToString(LeftSide.Kind));
             return {};
         }
 
-        size_t VarAddress = 0x0;
-        size_t ByteLocation = 0x0;
-        size_t TypeOffset = 0x0;
-
-        di_underlaying_type Underlaying = {};
-        if(LeftSide.Kind == EvalResultKind_Repr)
+        if(!CompilerMaterialize(Comp, &LeftSide))
         {
-            auto VarRepr = LeftSide.Repr;
-            assert(VarRepr);
-            
-            if(!(VarRepr->Underlaying.Flags.IsStruct || VarRepr->Underlaying.Flags.IsUnion))
-            {
-                Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
-                sprintf(Eval->ErrorStr, "Variable [%s] is not a struct/union type.", VarRepr->Name);
-                return {};
-            }
-
-            VarAddress = VarRepr->Address;
-            Underlaying = VarRepr->Underlaying;
+            return {};
         }
-        else if(LeftSide.Kind == EvalResultKind_Ident)
-        {
-            di_variable *Var = DwarfFindVariableByNameInScope(Eval->Scope, LeftSide.Ident);
-            if(!Var)
-            {
-                Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
-                sprintf(Eval->ErrorStr, "Variable [%s] not found in current scope\n", LeftSide.Ident);
 
-                return {};
-            }
-
-            VarAddress = DwarfGetVariableMemoryAddress(Var);
-			Underlaying = DwarfGetVariablesUnderlayingType(Var);
+        di_underlaying_type Underlaying = LeftSide.Underlaying;
+        if(!(Underlaying.Flags.IsStruct || Underlaying.Flags.IsUnion))
+        {
+            Comp->ErrorStr = ArrayPush(Comp->Arena, char, 256);
+            sprintf(Comp->ErrorStr, "Variable [%s] is not a struct/union type.", LeftSide.Name);
+            return {};
         }
 
-        if(Underlaying.Flags.IsStruct)
+        di_member *Member = DwarfGetMemberByName(Underlaying.Struct, RightSide.Ident);
+        if(!Member)
         {
-            di_struct_member *Member = DwarfStructGetMemberByName(Underlaying.Struct, RightSide.Ident);
-            if(!Member)
+            char *KindName = "Union";
+            if(Underlaying.Flags.IsStruct)
             {
-                Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
-                sprintf(Eval->ErrorStr, "Struct [%s] does not contain [%s] as a member\n", Underlaying.Name, RightSide.Ident);
-
-                return {};
+                KindName = "Struct";
             }
 
-            ByteLocation = Member->ByteLocation;
-            TypeOffset = Member->ActualTypeOffset;
-        }
-        else if(Underlaying.Flags.IsUnion)
-        {
-            di_union_member *Member = DwarfUnionGetMemberByName(Underlaying.Union, RightSide.Ident);
-            if(!Member)
-            {
-                Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
-                sprintf(Eval->ErrorStr, "Union [%s] does not contain [%s] as a member\n", Underlaying.Name, RightSide.Ident);
-
-                return {};
-            }
+            Comp->ErrorStr = ArrayPush(Comp->Arena, char, 256);
+            sprintf(Comp->ErrorStr, "%s [%s] does not contain [%s] as a member\n", KindName, Underlaying.Name, RightSide.Ident);
 
-            ByteLocation = Member->ByteLocation;
-            TypeOffset = Member->ActualTypeOffset;
+            return {};
         }
 
-        eval_result Result = {};
+        size_t ByteLocation = Member->ByteLocation;
+        size_t TypeOffset = Member->ActualTypeOffset;
+        char *MemberName = Member->Name;
+
 		if(Expr->Kind == ASTNodeKind_DotAccess && Underlaying.Flags.IsArray)
 		{
-			Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
-			sprintf(Eval->ErrorStr, "Cannot access [%s] member inside a non-struct type\n", RightSide.Ident);
+			Comp->ErrorStr = ArrayPush(Comp->Arena, char, 256);
+			sprintf(Comp->ErrorStr, "Cannot access [%s] member inside a non-struct type\n", RightSide.Ident);
 
 			return {};
 		}
@@ -831,18 +849,25 @@ EvaluatorEvalExpression(evaluator *Eval, ast_node *Expr)
         {
 			if(!Underlaying.Flags.IsPointer)
 			{
-				Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
-				sprintf(Eval->ErrorStr, "Cannot dereference [%s] variable type with the arrow operator\n", RightSide.Ident);
+				Comp->ErrorStr = ArrayPush(Comp->Arena, char, 256);
+				sprintf(Comp->ErrorStr, "Cannot dereference [%s] variable type with the arrow operator\n", RightSide.Ident);
 
 				return {};
 			}
-            VarAddress = DebugeePeekMemory(&Debugee, VarAddress);
+            CompilerEmit(Comp, WatchOpKind_Deref, 0, 0x0, false);
+        }
+
+        // Member offsets are known now, only the sum is left for the run time
+        if(ByteLocation)
+        {
+            CompilerEmit(Comp, WatchOpKind_Add, ByteLocation, 0x0, false);
         }
 
-        size_t Address = VarAddress + ByteLocation;
-        Result.Kind = EvalResultKind_Repr;
-        Result.Repr = StructPush(Eval->Arena, variable_representation);
-        (*Result.Repr) = GuiBuildVariableRepresentation(TypeOffset, Address, StringDuplicate(Eval->Arena, RightSide.Ident), 0, Eval->Arena);
+        eval_result Result = {};
+        Result.Kind = EvalResultKind_Location;
+        Result.Name = MemberName;
+        Result.TypeOffset = TypeOffset;
+        Result.Underlaying = DwarfFindUnderlayingType(TypeOffset);
 
         return Result;
     }
@@ -850,66 +875,43 @@ EvaluatorEvalExpression(evaluator *Eval, ast_node *Expr)
     {
         if(!Expr->Rhs)
         {
-            Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
-            sprintf(Eval->ErrorStr, "Unexpected lack of right node child in pointer deref\n");
+            Comp->ErrorStr = ArrayPush(Comp->Arena, char, 256);
+            sprintf(Comp->ErrorStr, "Unexpected lack of right node child in pointer deref\n");
 
             return {};
         }
 
-        eval_result RightSide = EvaluatorEvalExpression(Eval, Expr->Rhs);
-        if(RightSide.Kind != EvalResultKind_Ident && RightSide.Kind != EvalResultKind_Repr)
+        eval_result RightSide = CompilerCompileExpression(Comp, Expr->Rhs);
+        if(RightSide.Kind != EvalResultKind_Ident && RightSide.Kind != EvalResultKind_Location)
         {
-            Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
+            Comp->ErrorStr = ArrayPush(Comp->Arena, char, 256);
             char *KindStr = ExpressionResultKindToString(RightSide.Kind);
-            sprintf(Eval->ErrorStr, "Cannot dereference [%s] eval kind result\n", KindStr);
+            sprintf(Comp->ErrorStr, "Cannot dereference [%s] eval kind result\n", KindStr);
 
             return {};
         }
 
-        size_t VarAddress = 0x0;
-        size_t TypeOffset = 0x0;
-        di_underlaying_type Underlaying = {};
-        char *VarName = 0x0;
-
-        if(RightSide.Kind == EvalResultKind_Repr)
+        if(!CompilerMaterialize(Comp, &RightSide))
         {
-            auto VarRepr = RightSide.Repr;
-            assert(VarRepr);
-
-            VarName = VarRepr->Name;
-            VarAddress = VarRepr->Address;
-            Underlaying = VarRepr->Underlaying;
-        }
-        else if(RightSide.Kind == EvalResultKind_Ident)
-        {
-            di_variable *Var = DwarfFindVariableByNameInScope(Eval->Scope, RightSide.Ident);
-            if(!Var)
-            {
-                Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
-                sprintf(Eval->ErrorStr, "Variable [%s] not found in current scope\n", RightSide.Ident);
-
-                return {};
-            }
-
-            VarName = Var->Name;
-            VarAddress = DwarfGetVariableMemoryAddress(Var);
-			Underlaying = DwarfGetVariablesUnderlayingType(Var);
+            return {};
         }
 
+        di_underlaying_type Underlaying = RightSide.Underlaying;
         if(!Underlaying.Flags.IsPointer)
         {
-            Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
-            sprintf(Eval->ErrorStr, "Variable [%s] is not a pointer type.", VarName);
+            Comp->ErrorStr = ArrayPush(Comp->Arena, char, 256);
+            sprintf(Comp->ErrorStr, "Variable [%s] is not a pointer type.", RightSide.Name);
             return {};
         }
 
-        TypeOffset = Underlaying.Type->DIEOffset;
-        
+        // NOTE(mateusz): The pointer itself stays on the stack, the value string
+        // follows it, the same way the locals show dereferenced pointers.
         eval_result Result = {};
-        Result.Kind = EvalResultKind_Repr;
-        Result.Repr = StructPush(Eval->Arena, variable_representation);
-        (*Result.Repr) = GuiBuildVariableRepresentation(TypeOffset, VarAddress, StringDuplicate(Eval->Arena, RightSide.Ident), 1, Eval->Arena);
-        Result.Repr->DerefCount = 1;
+        Result.Kind = EvalResultKind_Location;
+        Result.Name = RightSide.Name;
+        Result.TypeOffset = Underlaying.Type->DIEOffset;
+        Result.Underlaying = DwarfFindUnderlayingType(Result.TypeOffset);
+        Result.DerefCount = 1;
 
         return Result;
     }
@@ -940,50 +942,47 @@ EvaluatorEvalExpression(evaluator *Eval, ast_node *Expr)
 }
 
 static void
-EvaluatorRun(evaluator *Eval)
+CompilerRun(compiler *Comp)
 {
-    eval_result EvalResult = EvaluatorEvalExpression(Eval, Eval->AST.Root);
+    eval_result Root = CompilerCompileExpression(Comp, Comp->AST.Root);
 
-    if(Eval->ErrorStr)
+    if(Comp->ErrorStr)
     {
         return;
     }
     
-    if(EvalResult.Kind == EvalResultKind_Ident)
+    if(Root.Kind != EvalResultKind_Ident && Root.Kind != EvalResultKind_Location)
     {
-        di_variable *Var = DwarfFindVariableByNameInScope(Eval->Scope, EvalResult.Ident);
-        if(!Var)
-        {
-            Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
-            sprintf(Eval->ErrorStr, "Variable [%s] not found in current scope\n", EvalResult.Ident);
+        Comp->ErrorStr = ArrayPush(Comp->Arena, char, 256);
+        sprintf(Comp->ErrorStr, "Can't convert [%s] result kind to a showable representation\n", ExpressionResultKindToString(Root.Kind));
 
-            return;
-        }
-
-        Eval->Result = StructPush(Eval->Arena, variable_representation);
-        (*Eval->Result) = GuiBuildVariableRepresentation(Var, 0, Eval->Arena);
-    }
-    else if(EvalResult.Kind == EvalResultKind_Repr)
-    {
-        Eval->Result = EvalResult.Repr;
+        return;
     }
-    else
-    {
-        Eval->ErrorStr = ArrayPush(Eval->Arena, char, 256);
-        sprintf(Eval->ErrorStr, "Can't convert [%s] result kind to a showable representation\n", ExpressionResultKindToString(EvalResult.Kind));
 
+    bool PlainVariable = Root.Kind == EvalResultKind_Ident;
+    u32 DerefCount = Root.DerefCount;
+    Root.DerefCount = 0;
+    if(!CompilerMaterialize(Comp, &Root))
+    {
         return;
     }
+
+    watch_plan *Plan = Comp->Plan;
+    Plan->ActualVariable = PlainVariable ? Root.Var : 0x0;
+    Plan->Underlaying = Root.Underlaying;
+    Plan->TypeOffset = Root.TypeOffset;
+    Plan->DerefCount = DerefCount;
 }
 
 static wlang_interp
-WLangInterpCreate(char *Src, scoped_vars Scope, arena *Arena)
+WLangInterpCreate(char *Src, scoped_vars Scope, watch_plan *Plan, arena *Arena)
 {
 	wlang_interp Result = {};
 
 	Result.Arena = Arena;
 	Result.Src = StringDuplicate(Result.Arena, Src);
     Result.Scope = Scope;
+    Result.Plan = Plan;
 
 	return Result;
 }
@@ -993,7 +992,7 @@ WLangInterpDestroy(wlang_interp *Interp)
 {
 	LexerDestroy(&Interp->Lexer);
 	ParserDestroy(&Interp->Parser);
-	EvaluatorDestroy(&Interp->Eval);
+	CompilerDestroy(&Interp->Comp);
 }
 
 static void
@@ -1019,43 +1018,257 @@ WLangInterpRun(wlang_interp *Interp)
         return;
     }
 
-	Interp->Eval = EvaluatorCreate(Interp->Parser.AST, Interp->Scope, Interp->Arena);
-	EvaluatorRun(&Interp->Eval);
+	Interp->Comp = CompilerCreate(Interp->Parser.AST, Interp->Scope, Interp->Plan, Interp->Arena);
+	CompilerRun(&Interp->Comp);
     
-    if(Interp->Eval.ErrorStr)
+    if(Interp->Comp.ErrorStr)
     {
-        LOG_LANG("[Evaluator Error]: %s\n", Interp->Eval.ErrorStr);
-        Interp->ErrorStr = Interp->Eval.ErrorStr;
+        LOG_LANG("[Compiler Error]: %s\n", Interp->Comp.ErrorStr);
+        Interp->ErrorStr = Interp->Comp.ErrorStr;
         return;
     }
-
-	Interp->Result = Interp->Eval.Result;
 }
 
 static bool
-WLangEvalSrc(char *Src, variable_representation *Result, char **Error, arena *Arena)
+WLangCompilePlan(watch_plan *Plan, char **Error, arena *Arena)
 {
     size_t PC = DebugeeGetProgramCounter(&Debugee);
     scoped_vars Scope = DwarfGetScopedVars(PC);
-    wlang_interp Interp = WLangInterpCreate(Src, Scope, Arena);
+
+    Plan->Compiled = false;
+    Plan->CompileFailed = false;
+    Plan->OpsCount = 0;
+    Plan->Func = DwarfFindFunctionByAddress(PC);
+    Plan->Scope = Plan->Func ? DwarfFindInnermostLexicalScope(Plan->Func, PC) : 0x0;
+
+    // The tokens and the AST are only needed until the plan is built
+    scratch_arena Scratch;
+    wlang_interp Interp = WLangInterpCreate(Plan->Src, Scope, Plan, Scratch);
 
     WLangInterpRun(&Interp);
 
-    bool Success = false;
     if(Interp.ErrorStr)
     {
         *Error = StringDuplicate(Arena, Interp.ErrorStr);
-        Success = false;
+        Plan->CompileFailed = true;
+        memset(Plan->CompileError, 0, sizeof(Plan->CompileError));
+        strncpy(Plan->CompileError, Interp.ErrorStr, sizeof(Plan->CompileError) - 1);
     }
     else
     {
-        *Result = GuiCopyVariableRepresentation(Interp.Result, Arena);
-		Result->Name = StringDuplicate(Arena, Src);
-
-        Success = true;
+        Plan->TypeString = DwarfGetTypeStringRepresentation(Plan->Underlaying, Arena);
+        Plan->Compiled = true;
     }
 	
     WLangInterpDestroy(&Interp);
 
-    return Success;
+    return Plan->Compiled;
+}
+
+// NOTE(mateusz): A location list can move a variable from memory to a register
+// inside of the scope the plan was compiled in, so the address is checked again.
+static bool
+WLangRunPlanOps(watch_plan *Plan, size_t *Result, char **Error, arena *Arena)
+{
+    size_t Stack[MAX_WATCH_OPS] = {};
+    u32 Top = 0;
+
+    for(u32 I = 0; I < Plan->OpsCount; I++)
+    {
+        watch_op *Op = &Plan->Ops[I];
+        switch(Op->Kind)
+        {
+            case WatchOpKind_VarAddress:
+            {
+                size_t Address = DwarfGetVariableMemoryAddress(Op->Var);
+                if(!Address)
+                {
+                    *Error = ArrayPush(Arena, char, 256);
+                    sprintf(*Error, "Variable [%s] is not in memory", Op->Var->Name);
+
+                    return false;
+                }
+
+                Stack[Top++] = Address;
+            }break;
+            case WatchOpKind_Deref:
+            {
+                Stack[Top - 1] = DebugeePeekMemory(&Debugee, Stack[Top - 1]);
+            }break;
+            case WatchOpKind_Add:
+            {
+                Stack[Top - 1] += Op->Imm;
+            }break;
+            case WatchOpKind_LoadInt:
+            {
+                size_t Value = DebugeePeekMemory(&Debugee, Stack[Top - 1]);
+                u32 Bits = Op->Imm * 8;
+                if(Bits < 64)
+                {
+                    size_t Mask = (1ull << Bits) - 1;
+                    Value &= Mask;
+                    if(Op->Signed && (Value >> (Bits - 1)) & 1)
+                    {
+                        Value |= ~Mask;
+                    }
+                }
+
+                Stack[Top - 1] = Value;
+            }break;
+            case WatchOpKind_Index:
+            {
+                Top -= 1;
+                Stack[Top - 1] += (i64)Stack[Top] * Op->Imm;
+            }break;
+            default:
+            {
+                assert(false && "Unknown watch op");
+            }break;
+        }
+    }
+
+    assert(Top == 1);
+    *Result = Stack[0];
+
+    return true;
+}
+
+static bool
+WLangRunPlan(watch_plan *Plan, variable_representation *Result, char **Error, arena *Arena)
+{
+    size_t Address = 0x0;
+    if(!WLangRunPlanOps(Plan, &Address, Error, Arena))
+    {
+        return false;
+    }
+
+    *Result = {};
+    Result->Name = Plan->Src;
+    Result->Address = Address;
+    Result->Underlaying = Plan->Underlaying;
+    Result->ActualVariable = Plan->ActualVariable;
+    Result->DerefCount = Plan->DerefCount;
+    Result->TypeString = Plan->TypeString;
+    Result->ValueString = GuiBuildVarsValueAsString(&Result->Underlaying, Result->Address, Result->DerefCount, Arena);
+    Result->Plan = Plan;
+
+    return true;
+}
+
+// NOTE(mateusz): The plan is bound to the variables of the scope it was compiled
+// in, a name can be shadowed in a nested block so it is compiled again once the
+// program counter is in a different innermost scope.
+static bool
+WLangPlanStale(watch_plan *Plan, size_t PC)
+{
+    di_function *Func = DwarfFindFunctionByAddress(PC);
+    di_lexical_scope *Scope = Func ? DwarfFindInnermostLexicalScope(Func, PC) : 0x0;
+    
+    bool Attempted = Plan->Compiled || Plan->CompileFailed;
+    return !Attempted || Plan->Func != Func || Plan->Scope != Scope;
+}
+
+static bool
+WLangEvalPlan(watch_plan *Plan, variable_representation *Result, char **Error, arena *Arena)
+{
+    size_t PC = DebugeeGetProgramCounter(&Debugee);
+    if(WLangPlanStale(Plan, PC))
+    {
+        if(!WLangCompilePlan(Plan, Error, Arena))
+        {
+            return false;
+        }
+    }
+    else if(Plan->CompileFailed)
+    {
+        *Error = StringDuplicate(Arena, Plan->CompileError);
+        return false;
+    }
+
+    return WLangRunPlan(Plan, Result, Error, Arena);
+}
+
+// NOTE(mateusz): Conditions of the batched stepping only have to be compared with
+// zero, the value is neither formatted nor kept. Only scalars can be conditions.
+static bool
+WLangEvalCondition(watch_plan *Plan, bool *Result, char **Error, arena *Arena)
+{
+    size_t PC = DebugeeGetProgramCounter(&Debugee);
+    if(WLangPlanStale(Plan, PC))
+    {
+        if(!WLangCompilePlan(Plan, Error, Arena))
+        {
+            return false;
+        }
+        
+        // NOTE(mateusz): The arena can live for a single evaluation, conditions are
+        // not formatted so nothing in the plan has to point into it.
+        Plan->TypeString = 0x0;
+    }
+    else if(Plan->CompileFailed)
+    {
+        *Error = StringDuplicate(Arena, Plan->CompileError);
+        return false;
+    }
+    
+    variable_representation Value = {};
+    if(!WLangRunPlanOps(Plan, &Value.Address, Error, Arena))
+    {
+        return false;
+    }
+
+    Value.Underlaying = Plan->Underlaying;
+    Value.DerefCount = Plan->DerefCount;
+    
+    u8 Bytes[sizeof(size_t)] = {};
+    u32 Size = GuiReadVariableValueBytes(&Value, Bytes);
+    if(!Size)
+    {
+        *Error = "Condition has to be a scalar";
+        return false;
+    }
+    
+    *Result = false;
+    for(u32 I = 0; I < Size; I++)
+    {
+        *Result = *Result || Bytes[I];
+    }
+    
+    return true;
+}
+
+// NOTE(mateusz): Only the lexer and the parser, the names are resolved later when
+// the source is compiled in the scope it is evaluated in.
+static bool
+WLangCheckSyntax(char *Src, char **Error, arena *Arena)
+{
+    scratch_arena Scratch;
+    lexer Lexer = LexerCreate(Src, Scratch);
+    LexerBuildTokens(&Lexer);
+    char *ErrorStr = Lexer.ErrorStr;
+    
+    if(!ErrorStr)
+    {
+        parser Parser = ParserCreate(&Lexer.Tokens, Scratch);
+        ParserBuildAST(&Parser);
+        ErrorStr = Parser.ErrorStr;
+        ParserDestroy(&Parser);
+    }
+    LexerDestroy(&Lexer);
+    
+    if(ErrorStr)
+    {
+        *Error = StringDuplicate(Arena, ErrorStr);
+    }
+    
+    return ErrorStr == 0x0;
+}
+
+static bool
+WLangEvalSrc(char *Src, variable_representation *Result, char **Error, arena *Arena)
+{
+    watch_plan *Plan = StructPush(Arena, watch_plan);
+    Plan->Src = StringDuplicate(Arena, Src);
+
+    return WLangEvalPlan(Plan, Result, Error, Arena);
 }
@@ -89,23 +89,74 @@ enum
 {
     EvalResultKind_NumberInt,
     EvalResultKind_Ident,
-    EvalResultKind_Repr,
+    EvalResultKind_Location,
 };
 
 typedef u32 eval_result_kind;
 
+// NOTE(mateusz): A location was already lowered into the plan, when the plan is
+// run its address is at the top of the stack.
 struct eval_result
 {
     eval_result_kind Kind;
     i64 Int;
     char *Ident;
-    variable_representation *Repr;
+
+    char *Name;
+    di_variable *Var;
+    size_t TypeOffset;
+    di_underlaying_type Underlaying;
+    u32 DerefCount;
+};
+
+enum
+{
+    WatchOpKind_VarAddress,
+    WatchOpKind_Deref,
+    WatchOpKind_Add,
+    WatchOpKind_LoadInt,
+    WatchOpKind_Index,
+};
+
+typedef u8 watch_op_kind;
+
+struct watch_op
+{
+    watch_op_kind Kind;
+    bool Signed;
+    di_variable *Var;
+    size_t Imm;
 };
 
-struct evaluator
+#define MAX_WATCH_OPS 32
+
+// NOTE(mateusz): A watch expression compiled against the innermost lexical scope
+// of a function, evaluating it again only walks the ops and reads the debugee memory.
+struct watch_plan
+{
+    char *Src;
+    bool Compiled;
+    // NOTE(mateusz): A plan that failed is not compiled again until the scope changes,
+    // the evaluations in the same scope fail with the same error.
+    bool CompileFailed;
+    char CompileError[128];
+    di_function *Func;
+    di_lexical_scope *Scope;
+
+    watch_op Ops[MAX_WATCH_OPS];
+    u32 OpsCount;
+
+    di_variable *ActualVariable;
+    di_underlaying_type Underlaying;
+    size_t TypeOffset;
+    char *TypeString;
+    u32 DerefCount;
+};
+
+struct compiler
 {
     arena *Arena;
-    variable_representation *Result;
+    watch_plan *Plan;
     char *ErrorStr;
     scoped_vars Scope;
     ast AST;
@@ -116,14 +167,13 @@ struct wlang_interp
 	arena *Arena;
 	lexer Lexer;
 	parser Parser;
-	evaluator Eval;
+	compiler Comp;
 
 	char *Src;
     scoped_vars Scope;
+    watch_plan *Plan;
 
     char *ErrorStr;
-
-    variable_representation *Result;
 };
 
 #define FILE_WRITE_STR(str, file) (fwrite(str, sizeof(str) - 1, 1, file))
@@ -156,15 +206,25 @@ static void			ParserReasonAboutNode(parser *Parser, FILE *FileHandle, ast_node *
 
 static char *       ExpressionResultKindToString(eval_result_kind Kind);
 
-static evaluator    EvaluatorCreate(ast AST, scoped_vars Scope, arena *Arena);
-static void         EvaluatorDestroy(evaluator *Eval);
-static eval_result	EvaluatorEvalExpression(evaluator *Eval, ast_node *Expr);
-static void    		EvaluatorRun(evaluator *Eval);
+static compiler     CompilerCreate(ast AST, scoped_vars Scope, watch_plan *Plan, arena *Arena);
+static void         CompilerDestroy(compiler *Comp);
+static void         CompilerEmit(compiler *Comp, watch_op_kind Kind, size_t Imm, di_variable *Var, bool Signed);
+static bool         CompilerMaterialize(compiler *Comp, eval_result *Value);
+static bool         CompilerEmitIndexLoad(compiler *Comp, eval_result *Index, char *Name);
+static eval_result  CompilerCompileExpression(compiler *Comp, ast_node *Expr);
+static void         CompilerRun(compiler *Comp);
 
-static wlang_interp	WLangInterpCreate(char *Src, scoped_vars Scope, arena *Arena);
+static wlang_interp	WLangInterpCreate(char *Src, scoped_vars Scope, watch_plan *Plan, arena *Arena);
 static void 		WLangInterpDestroy(wlang_interp *Interp);
 static void			WLangInterpRun(wlang_interp *Interp);
 
+static bool         WLangPlanStale(watch_plan *Plan, size_t PC);
+static bool         WLangCompilePlan(watch_plan *Plan, char **Error, arena *Arena);
+static bool         WLangRunPlanOps(watch_plan *Plan, size_t *Result, char **Error, arena *Arena);
+static bool         WLangRunPlan(watch_plan *Plan, variable_representation *Result, char **Error, arena *Arena);
+static bool         WLangEvalPlan(watch_plan *Plan, variable_representation *Result, char **Error, arena *Arena);
+static bool         WLangEvalCondition(watch_plan *Plan, bool *Result, char **Error, arena *Arena);
+static bool         WLangCheckSyntax(char *Src, char **Error, arena *Arena);
 static bool         WLangEvalSrc(char *Src, variable_representation *Result, char **Error, arena *Arena);
 
 #endif //WATCH_LANG_H
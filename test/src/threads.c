@@ -0,0 +1,45 @@
+#include <pthread.h>
+
+#define THREAD_COUNT 8
+
+int worker_sums[THREAD_COUNT];
+
+void *worker(void *arg)
+{
+    int index = *(int *)arg;
+    int sum = 0;
+    
+    for(int i = 0; i < 100000; i++)
+    {
+        sum += i % (index + 1);
+    }
+    
+    worker_sums[index] = sum;
+    
+    return 0;
+}
+
+int main(void)
+{
+    pthread_t threads[THREAD_COUNT];
+    int indices[THREAD_COUNT];
+    
+    for(int i = 0; i < THREAD_COUNT; i++)
+    {
+        indices[i] = i;
+        pthread_create(&threads[i], 0, worker, &indices[i]);
+    }
+    
+    for(int i = 0; i < THREAD_COUNT; i++)
+    {
+        pthread_join(threads[i], 0);
+    }
+    
+    int total = 0;
+    for(int i = 0; i < THREAD_COUNT; i++)
+    {
+        total += worker_sums[i];
+    }
+    
+    return total == 0;
+}
\ No newline at end of file